@@ -0,0 +1,128 @@
+#include "aes.h"
+
+#include <cstring>
+
+static const uint8_t SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16};
+
+static uint8_t xtime(uint8_t x) {
+    return (x << 1) ^ ((x & 0x80) ? 0x1b : 0x00);
+}
+
+void aes256_expand_key(const uint8_t key[AES256_KEY_SIZE], uint8_t round_keys[AES256_ROUND_KEYS_SIZE]) {
+    memcpy(round_keys, key, AES256_KEY_SIZE);
+    uint8_t rcon = 0x01;
+    for (int i = AES256_KEY_SIZE / 4; i < AES256_ROUND_KEYS_SIZE / 4; i++) {
+        uint8_t t[4];
+        memcpy(t, round_keys + 4 * (i - 1), 4);
+        if (i % 8 == 0) {
+            // RotWord, SubWord, Rcon
+            uint8_t first = t[0];
+            t[0] = SBOX[t[1]] ^ rcon;
+            t[1] = SBOX[t[2]];
+            t[2] = SBOX[t[3]];
+            t[3] = SBOX[first];
+            rcon = xtime(rcon);
+        } else if (i % 8 == 4) {
+            for (int j = 0; j < 4; j++) t[j] = SBOX[t[j]];
+        }
+        for (int j = 0; j < 4; j++) round_keys[4 * i + j] = round_keys[4 * (i - 8) + j] ^ t[j];
+    }
+}
+
+void aes256_encrypt_block(const uint8_t round_keys[AES256_ROUND_KEYS_SIZE], const uint8_t in[AES_BLOCK_SIZE], uint8_t out[AES_BLOCK_SIZE]) {
+    // Column major state, state[4 * c + r]
+    uint8_t state[AES_BLOCK_SIZE];
+    for (int i = 0; i < AES_BLOCK_SIZE; i++) state[i] = in[i] ^ round_keys[i];
+
+    for (int round = 1; round <= AES256_ROUNDS; round++) {
+        // SubBytes and ShiftRows
+        uint8_t tmp[AES_BLOCK_SIZE];
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) tmp[4 * c + r] = SBOX[state[4 * ((c + r) % 4) + r]];
+        }
+
+        // MixColumns, except in the last round
+        if (round != AES256_ROUNDS) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t *col = tmp + 4 * c;
+                uint8_t all = col[0] ^ col[1] ^ col[2] ^ col[3];
+                uint8_t first = col[0];
+                col[0] ^= all ^ xtime(col[0] ^ col[1]);
+                col[1] ^= all ^ xtime(col[1] ^ col[2]);
+                col[2] ^= all ^ xtime(col[2] ^ col[3]);
+                col[3] ^= all ^ xtime(col[3] ^ first);
+            }
+        }
+
+        const uint8_t *key = round_keys + AES_BLOCK_SIZE * round;
+        for (int i = 0; i < AES_BLOCK_SIZE; i++) state[i] = tmp[i] ^ key[i];
+    }
+    memcpy(out, state, AES_BLOCK_SIZE);
+}
+
+void aes256_ctr(const uint8_t round_keys[AES256_ROUND_KEYS_SIZE], const uint8_t iv[AES_BLOCK_SIZE], uint64_t first_block,
+                const uint8_t *in, uint8_t *out, size_t size) {
+    uint8_t counter[AES_BLOCK_SIZE];
+    memcpy(counter, iv, AES_BLOCK_SIZE);
+
+    // counter = iv + first_block, 128-bit big-endian
+    uint64_t carry = first_block;
+    for (int i = AES_BLOCK_SIZE - 1; i >= 0 && carry; i--) {
+        uint64_t sum = counter[i] + (carry & 0xFF);
+        counter[i] = sum & 0xFF;
+        carry = (carry >> 8) + (sum >> 8);
+    }
+
+    uint8_t stream[AES_BLOCK_SIZE];
+    for (size_t pos = 0; pos < size; pos += AES_BLOCK_SIZE) {
+        aes256_encrypt_block(round_keys, counter, stream);
+        size_t n = size - pos < AES_BLOCK_SIZE ? size - pos : AES_BLOCK_SIZE;
+        for (size_t i = 0; i < n; i++) out[pos + i] = in[pos + i] ^ stream[i];
+        for (int i = AES_BLOCK_SIZE - 1; i >= 0 && ++counter[i] == 0; i--) {}
+    }
+}
+
+bool aes256_ctr_self_test() {
+    static const uint8_t key[AES256_KEY_SIZE] = {
+        0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+        0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4};
+    static const uint8_t iv[AES_BLOCK_SIZE] = {
+        0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff};
+    static const uint8_t plaintext[4 * AES_BLOCK_SIZE] = {
+        0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+        0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+        0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+        0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+    static const uint8_t ciphertext[4 * AES_BLOCK_SIZE] = {
+        0x60, 0x1e, 0xc3, 0x13, 0x77, 0x57, 0x89, 0xa5, 0xb7, 0xa7, 0xf5, 0x04, 0xbb, 0xf3, 0xd2, 0x28,
+        0xf4, 0x43, 0xe3, 0xca, 0x4d, 0x62, 0xb5, 0x9a, 0xca, 0x84, 0xe9, 0x90, 0xca, 0xca, 0xf5, 0xc5,
+        0x2b, 0x09, 0x30, 0xda, 0xa2, 0x3d, 0xe9, 0x4c, 0xe8, 0x70, 0x17, 0xba, 0x2d, 0x84, 0x98, 0x8d,
+        0xdf, 0xc9, 0xc5, 0x8d, 0xb6, 0x7a, 0xad, 0xa6, 0x13, 0xc2, 0xdd, 0x08, 0x45, 0x79, 0x41, 0xa6};
+
+    uint8_t round_keys[AES256_ROUND_KEYS_SIZE];
+    aes256_expand_key(key, round_keys);
+
+    uint8_t out[4 * AES_BLOCK_SIZE];
+    aes256_ctr(round_keys, iv, 0, plaintext, out, sizeof(out));
+    if (memcmp(out, ciphertext, sizeof(out)) != 0) return false;
+
+    // Random access : the third block on its own
+    aes256_ctr(round_keys, iv, 2, plaintext + 2 * AES_BLOCK_SIZE, out, AES_BLOCK_SIZE);
+    return memcmp(out, ciphertext + 2 * AES_BLOCK_SIZE, AES_BLOCK_SIZE) == 0;
+}
@@ -0,0 +1,35 @@
+/**
+ * @brief Reference AES-256 in CTR mode (NIST SP 800-38A) for the inline encryption
+ *        kernel : key schedule for the host, and a plain byte oriented implementation
+ *        used to check the kernel output and in emulation.
+ *
+ * The counter block of the 16-byte block at byte offset `16 * n` of a file is the IV
+ * plus n as a 128-bit big-endian integer, so any aligned range can be processed on its own.
+ */
+#ifndef AES_H_
+#define AES_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#define AES256_KEY_SIZE 32
+#define AES_BLOCK_SIZE 16
+#define AES256_ROUNDS 14
+#define AES256_ROUND_KEYS_SIZE (AES_BLOCK_SIZE * (AES256_ROUNDS + 1))
+
+// Key buffer of the kernel : the round keys followed by the IV
+#define AES256_KERNEL_KEYS_SIZE (AES256_ROUND_KEYS_SIZE + AES_BLOCK_SIZE)
+
+// Expand a 256-bit key in the 15 round keys (240 bytes) used by the kernel
+void aes256_expand_key(const uint8_t key[AES256_KEY_SIZE], uint8_t round_keys[AES256_ROUND_KEYS_SIZE]);
+
+void aes256_encrypt_block(const uint8_t round_keys[AES256_ROUND_KEYS_SIZE], const uint8_t in[AES_BLOCK_SIZE], uint8_t out[AES_BLOCK_SIZE]);
+
+// Encrypt or decrypt (the same operation in CTR mode) `size` bytes starting at block `first_block`
+void aes256_ctr(const uint8_t round_keys[AES256_ROUND_KEYS_SIZE], const uint8_t iv[AES_BLOCK_SIZE], uint64_t first_block,
+                const uint8_t *in, uint8_t *out, size_t size);
+
+// Known answer test against the SP 800-38A F.5.5 vectors, returns true when it passes
+bool aes256_ctr_self_test();
+
+#endif /* AES_H_ */
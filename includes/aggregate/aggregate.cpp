@@ -0,0 +1,92 @@
+#include "aggregate.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Chunk streamed through the p2p bo per kernel run
+static const size_t AGG_CHUNK = 256 << 20;
+static const size_t AGG_ALIGN = 4096;
+
+static int64_t load_integer(const uint8_t *field, FilterType type) {
+    if (type == FILTER_INT32) {
+        int32_t v;
+        memcpy(&v, field, sizeof(v));
+        return v;
+    }
+    int64_t v;
+    memcpy(&v, field, sizeof(v));
+    return v;
+}
+
+void aggregate_records(const uint8_t *records, size_t size, const Schema& schema, const Column& key, const Column& value,
+                       std::unordered_map<int64_t, AggEntry>& groups) {
+    for (size_t pos = 0; pos + schema.record_size <= size; pos += schema.record_size) {
+        int64_t k = load_integer(records + pos + key.offset, key.type);
+        int64_t v = load_integer(records + pos + value.offset, value.type);
+        AggEntry& entry = groups[k];
+        if (entry.count == 0) {
+            entry.key = k;
+            entry.min = entry.max = v;
+        }
+        entry.count++;
+        entry.sum += v;
+        entry.min = std::min(entry.min, v);
+        entry.max = std::max(entry.max, v);
+    }
+}
+
+std::vector<AggEntry> sorted_groups(const std::unordered_map<int64_t, AggEntry>& groups) {
+    std::vector<AggEntry> sorted;
+    for (const auto& group : groups) sorted.push_back(group.second);
+    std::sort(sorted.begin(), sorted.end(), [](const AggEntry& a, const AggEntry& b) { return a.key < b.key; });
+    return sorted;
+}
+
+Aggregator::Aggregator(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map, size_t max_groups)
+    : mKernel(device, uuid, "aggregate_kernel"), mBo(p2p_bo), mMap((char*)p2p_map), mSlots(1), mMaxGroups(max_groups) {
+    while (mSlots < 2 * max_groups) mSlots <<= 1;
+    mTableBo = xrt::bo(device, mSlots * sizeof(AggEntry), mKernel.group_id(1));
+    mStatusBo = xrt::bo(device, 2 * sizeof(uint32_t), mKernel.group_id(2));
+}
+
+AggResult Aggregator::aggregate(const std::string& file, const Schema& schema, const std::string& key,
+                                const std::string& value, size_t size) {
+    AggResult result = AggResult();
+    const Column& key_column = schema.column(key);
+    const Column& value_column = schema.column(value);
+    if (key_column.type == FILTER_FLOAT64 || value_column.type == FILTER_FLOAT64) {
+        std::cerr << "ERROR: aggregation needs integer key and value columns" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Chunks hold whole records and keep the P2P reads 4 KiB aligned
+    size_t record_size = schema.record_size;
+    ChunkReader input(file, record_chunk(record_size, std::min(AGG_CHUNK, mBo.size()), AGG_ALIGN), size, AGG_ALIGN);
+
+    uint32_t *status = mStatusBo.map<uint32_t*>();
+    // One kernel run per chunk, the first resets the table and the last compacts it
+    for (size_t offset = 0;; offset += input.chunk()) {
+        size_t len = input.read_chunk(mMap, offset);
+        unsigned int flags = (offset == 0 ? AGG_RESET : 0) | (input.last(offset) ? AGG_FINISH : 0);
+        auto run = mKernel(mBo, mTableBo, mStatusBo, (unsigned int)record_size, key_column.offset, (unsigned int)key_column.type,
+                           value_column.offset, (unsigned int)value_column.type, (unsigned int)(len / record_size),
+                           (unsigned int)mSlots, (unsigned int)mMaxGroups, flags);
+        run.wait();
+        result.records += len / record_size;
+        result.bytes_scanned += len;
+        if (input.last(offset)) break;
+    }
+
+    // Only the compacted groups cross PCIe
+    mStatusBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+    size_t groups = status[AGG_STATUS_GROUPS];
+    result.overflow = status[AGG_STATUS_OVERFLOW];
+    if (groups > 0) mTableBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, groups * sizeof(AggEntry), 0);
+    const AggEntry *table = mTableBo.map<AggEntry*>();
+    result.groups.assign(table, table + groups);
+    std::sort(result.groups.begin(), result.groups.end(), [](const AggEntry& a, const AggEntry& b) { return a.key < b.key; });
+    result.bytes_to_host = 2 * sizeof(uint32_t) + groups * sizeof(AggEntry);
+    return result;
+}
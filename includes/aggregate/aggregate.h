@@ -0,0 +1,64 @@
+/**
+ * @brief Group-by aggregation (count, sum, min, max) of a value column by an integer key
+ *        column of fixed-width records, next to the drive.
+ *
+ * aggregate() streams the file through the p2p bo with P2P preads and aggregate_kernel
+ * updates a hash table in device memory, only the final groups are synced to the host.
+ */
+#ifndef AGGREGATE_H_
+#define AGGREGATE_H_
+
+#include "aggregate_table.h"
+#include "scan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "experimental/xrt_bo.h"
+#include "experimental/xrt_device.h"
+#include "experimental/xrt_kernel.h"
+
+struct AggResult {
+    uint64_t records;
+    uint64_t bytes_scanned;
+    uint64_t bytes_to_host;
+    uint64_t overflow;            // records left out, of the keys first seen after max_groups groups
+    std::vector<AggEntry> groups; // sorted by key
+};
+
+// Host aggregation of `size` bytes of records into groups, the reference of aggregate_kernel
+void aggregate_records(const uint8_t *records, size_t size, const Schema& schema, const Column& key, const Column& value,
+                       std::unordered_map<int64_t, AggEntry>& groups);
+
+// Groups of the map sorted by key
+std::vector<AggEntry> sorted_groups(const std::unordered_map<int64_t, AggEntry>& groups);
+
+class Aggregator {
+public:
+    /**
+     * Hash table of at least twice max_groups slots. The kernel stops adding groups at
+     * max_groups, so the table is never more than half full and probes stay short, the
+     * records of the keys it has no group for are counted as overflow.
+     */
+    Aggregator(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map, size_t max_groups);
+
+    // Aggregate `size` bytes of `file` (the whole file when 0) grouped by `key`
+    AggResult aggregate(const std::string& file, const Schema& schema, const std::string& key,
+                        const std::string& value, size_t size = 0);
+
+    size_t table_slots() const { return mSlots; }
+
+private:
+    xrt::kernel mKernel;
+    xrt::bo mBo;
+    char *mMap;
+    size_t mSlots;
+    size_t mMaxGroups;
+    xrt::bo mTableBo;
+    xrt::bo mStatusBo;
+};
+
+#endif /* AGGREGATE_H_ */
@@ -0,0 +1,37 @@
+/**
+ * @brief Group-by hash table shared by the host aggregation API and aggregate_kernel.
+ *
+ * The table lives in device memory, one AggEntry per slot with linear probing, and is
+ * compacted in place by the kernel once the last chunk is aggregated. Keys and values
+ * are int32 or int64 columns (FilterType) of fixed-width records.
+ */
+#ifndef AGGREGATE_TABLE_H_
+#define AGGREGATE_TABLE_H_
+
+#include <stdint.h>
+
+#define AGG_RESET 1  // clear the table before the chunk
+#define AGG_FINISH 2 // compact the groups to the front of the table after the chunk
+
+struct AggEntry {
+    int64_t key;
+    uint64_t count; // 0 for an empty slot
+    int64_t sum;
+    int64_t min;
+    int64_t max;
+};
+
+// Status words written by the kernel
+#define AGG_STATUS_GROUPS 0   // groups in the table, at its front after AGG_FINISH
+#define AGG_STATUS_OVERFLOW 1 // records of keys first seen once the table held max_groups groups
+
+// Home slot of a key, table_slots is a power of two
+static inline uint32_t agg_slot(int64_t key, uint32_t table_slots) {
+    uint64_t h = (uint64_t)key;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    return (uint32_t)h & (table_slots - 1);
+}
+
+#endif /* AGGREGATE_TABLE_H_ */
@@ -0,0 +1,113 @@
+#include "bloom.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+BloomIndex::BloomIndex() {
+    memset(&mHeader, 0, sizeof(mHeader));
+    mHeader.magic = BLOOM_MAGIC;
+}
+
+BloomIndex::BloomIndex(uint32_t record_size, uint32_t key_offset, uint32_t key_width, uint32_t segment_records, double fpr)
+    : BloomIndex() {
+    mHeader.record_size = record_size;
+    mHeader.key_offset = key_offset;
+    mHeader.key_width = key_width;
+    mHeader.segment_records = segment_records;
+
+    // m = -n ln(p) / ln(2)^2 rounded up to whole words, k = m / n ln(2)
+    double bits = -(double)segment_records * std::log(fpr) / (M_LN2 * M_LN2);
+    mHeader.filter_bits = std::max(1.0, std::ceil(bits / 32)) * 32;
+    double k = std::round((double)mHeader.filter_bits / segment_records * M_LN2);
+    mHeader.num_hashes = std::min(std::max(k, 1.0), (double)BLOOM_MAX_HASHES);
+}
+
+void BloomIndex::append(const uint32_t *filters, size_t count) {
+    mFilters.insert(mFilters.end(), filters, filters + count * filter_words());
+    mHeader.count += count;
+}
+
+void BloomIndex::add_records(const uint8_t *records, size_t size) {
+    size_t records_count = size / mHeader.record_size;
+    size_t count = (records_count + mHeader.segment_records - 1) / mHeader.segment_records;
+    size_t first = mFilters.size();
+    mFilters.resize(first + count * filter_words(), 0);
+    for (size_t r = 0; r < records_count; r++) {
+        uint64_t key = 0;
+        memcpy(&key, records + r * mHeader.record_size + mHeader.key_offset, mHeader.key_width);
+        uint64_t h = bloom_hash(key);
+        uint32_t h1 = h, h2 = (h >> 32) | 1;
+        uint32_t *filter = mFilters.data() + first + r / mHeader.segment_records * filter_words();
+        for (uint32_t i = 0; i < mHeader.num_hashes; i++) {
+            uint32_t bit = bloom_bit(h1, h2, i, mHeader.filter_bits);
+            filter[bit / 32] |= 1u << (bit % 32);
+        }
+    }
+    mHeader.count += count;
+}
+
+bool BloomIndex::may_contain(size_t segment, uint64_t key) const {
+    if (segment >= mHeader.count) return false;
+    if (mHeader.key_width == 4) key &= 0xFFFFFFFFull;
+    uint64_t h = bloom_hash(key);
+    uint32_t h1 = h, h2 = (h >> 32) | 1;
+    const uint32_t *filter = mFilters.data() + segment * filter_words();
+    for (uint32_t i = 0; i < mHeader.num_hashes; i++) {
+        uint32_t bit = bloom_bit(h1, h2, i, mHeader.filter_bits);
+        if (!(filter[bit / 32] & (1u << (bit % 32)))) return false;
+    }
+    return true;
+}
+
+std::vector<size_t> BloomIndex::candidates(uint64_t key) const {
+    std::vector<size_t> segments;
+    for (size_t s = 0; s < mHeader.count; s++) {
+        if (may_contain(s, key)) segments.push_back(s);
+    }
+    return segments;
+}
+
+double BloomIndex::expected_fpr() const {
+    double m = mHeader.filter_bits, k = mHeader.num_hashes;
+    return std::pow(1 - std::exp(-k * mHeader.segment_records / m), k);
+}
+
+void BloomIndex::clear() {
+    mFilters.clear();
+    mHeader.count = 0;
+}
+
+int BloomIndex::save(const std::string& path) const {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) return -errno;
+    int ret = 0;
+    if (fwrite(&mHeader, sizeof(mHeader), 1, file) != 1 ||
+        fwrite(mFilters.data(), sizeof(uint32_t), mFilters.size(), file) != mFilters.size()) {
+        ret = -errno;
+    }
+    if (fclose(file) != 0 && ret == 0) ret = -errno;
+    return ret;
+}
+
+int BloomIndex::load(const std::string& path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) return -errno;
+    BloomHeader header;
+    int ret = 0;
+    if (fread(&header, sizeof(header), 1, file) != 1) {
+        ret = -EINVAL;
+    } else if (header.magic != BLOOM_MAGIC || header.filter_bits == 0 || header.filter_bits % 32 != 0 ||
+               header.num_hashes == 0 || header.num_hashes > BLOOM_MAX_HASHES || header.segment_records == 0 ||
+               (header.key_width != 4 && header.key_width != 8)) {
+        ret = -EINVAL;
+    } else {
+        mHeader = header;
+        mFilters.resize(header.count * filter_words());
+        if (fread(mFilters.data(), sizeof(uint32_t), mFilters.size(), file) != mFilters.size()) ret = -EINVAL;
+    }
+    fclose(file);
+    return ret;
+}
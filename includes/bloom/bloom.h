@@ -0,0 +1,90 @@
+/**
+ * @brief Per-segment Bloom filters over a key column of a record file, kept in a sidecar
+ *        index so point lookups only P2P read the segments that may hold the key.
+ *
+ * The file is cut in segments of segment_records records, each with a filter of
+ * filter_bits bits. A key sets num_hashes bits, the 32-bit h1 + i * h2 from the two halves
+ * of bloom_hash() mapped to [0, filter_bits) by bloom_bit() without a division. bloom_build_kernel builds the filters on the data in the p2p bo before it
+ * is P2P written. The definitions are plain C so they can be included by the kernels.
+ */
+#ifndef BLOOM_H_
+#define BLOOM_H_
+
+#include <stdint.h>
+
+#define BLOOM_MAGIC 0x4D4F4C42 // "BLOM"
+#define BLOOM_MAX_HASHES 16
+
+struct BloomHeader {
+    uint32_t magic;
+    uint32_t num_hashes;
+    uint32_t filter_bits; // multiple of 32
+    uint32_t segment_records;
+    uint32_t record_size;
+    uint32_t key_offset;
+    uint32_t key_width; // 4 or 8 bytes, little-endian
+    uint32_t reserved;
+    uint64_t count;     // segments
+};
+
+// 64-bit finalizer of MurmurHash3
+static inline uint64_t bloom_hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ull;
+    key ^= key >> 33;
+    return key;
+}
+
+static inline uint32_t bloom_bit(uint32_t h1, uint32_t h2, uint32_t i, uint32_t filter_bits) {
+    return (uint32_t)(((uint64_t)(h1 + i * h2) * filter_bits) >> 32);
+}
+
+#if defined(__cplusplus) && !defined(__SYNTHESIS__)
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class BloomIndex {
+public:
+    BloomIndex();
+
+    // Filters sized for a false positive rate of about `fpr` with full segments
+    BloomIndex(uint32_t record_size, uint32_t key_offset, uint32_t key_width, uint32_t segment_records, double fpr);
+
+    // Filters of the next segments, as built by bloom_build_kernel
+    void append(const uint32_t *filters, size_t count);
+
+    // Host construction of the filters of the next segments of `size` bytes of records
+    void add_records(const uint8_t *records, size_t size);
+
+    // Probe, false when `key` is certainly not in `segment`
+    bool may_contain(size_t segment, uint64_t key) const;
+
+    // Segments to read for `key`, empty for most absent keys
+    std::vector<size_t> candidates(uint64_t key) const;
+
+    // False positive rate of one full segment filter
+    double expected_fpr() const;
+
+    // Sidecar file, return 0 or -errno (-EINVAL on a bad header)
+    int save(const std::string& path) const;
+    int load(const std::string& path);
+
+    uint32_t num_hashes() const { return mHeader.num_hashes; }
+    uint32_t filter_bits() const { return mHeader.filter_bits; }
+    uint32_t filter_words() const { return mHeader.filter_bits / 32; }
+    uint32_t segment_records() const { return mHeader.segment_records; }
+    size_t segment_bytes() const { return (size_t)mHeader.segment_records * mHeader.record_size; }
+    size_t segments() const { return mHeader.count; }
+    const std::vector<uint32_t>& filters() const { return mFilters; }
+    void clear();
+
+private:
+    BloomHeader mHeader;
+    std::vector<uint32_t> mFilters;
+};
+#endif
+
+#endif /* BLOOM_H_ */
@@ -0,0 +1,70 @@
+#include "cmdring.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+static const size_t SLOTS_OFFSET = offsetof(CommandRingLayout, slots);
+static const size_t TAIL_LINE = offsetof(RingControl, tail);
+
+CommandRing::CommandRing(xrt::device& device, const xrt::uuid& uuid, xrt::bo in, xrt::bo out)
+    : mEmulated(false), mStopped(false), mKernel(device, uuid, "ring_kernel"), mHead(0), mTail(0), mPolls(0) {
+    mRingBo = xrt::bo(device, sizeof(CommandRingLayout), mKernel.group_id(0));
+    mRing = mRingBo.map<CommandRingLayout*>();
+    memset(mRing, 0, sizeof(CommandRingLayout));
+    mRingBo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    mRun = mKernel(mRingBo, in, out);
+}
+
+CommandRing::CommandRing(const char *in, char *out) : mEmulated(true), mStopped(false), mHead(0), mTail(0), mPolls(0) {
+    mRing = (CommandRingLayout*)aligned_alloc(RING_LINE, sizeof(CommandRingLayout));
+    memset(mRing, 0, sizeof(CommandRingLayout));
+    mThread = std::thread(ring_serve, mRing, (const unsigned char*)in, (unsigned char*)out);
+}
+
+CommandRing::~CommandRing() {
+    if (!mStopped) stop();
+    if (mEmulated) free(mRing);
+}
+
+uint32_t CommandRing::completed() {
+    mPolls++;
+    if (!mEmulated) mRingBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, RING_LINE, TAIL_LINE);
+    uint32_t tail = ((volatile RingControl*)&mRing->control)->tail;
+    if (mEmulated && tail == mTail) RING_IDLE();
+    mTail = tail;
+    return mTail;
+}
+
+uint32_t CommandRing::submit(uint32_t op, uint64_t offset, uint32_t length) {
+    while (mHead - mTail >= RING_SLOTS) completed();
+
+    uint32_t slot = mHead % RING_SLOTS;
+    volatile RingCommand *command = &mRing->slots[slot];
+    command->offset = offset;
+    command->length = length;
+    command->op = op;
+    RING_FENCE();
+    command->seq = mHead + 1;
+    RING_FENCE();
+    mHead++;
+    ((volatile RingControl*)&mRing->control)->head = mHead;
+    if (!mEmulated) {
+        // The line of the slot, then the head line, syncs are done in order
+        size_t line = (SLOTS_OFFSET + slot * sizeof(RingCommand)) / RING_LINE * RING_LINE;
+        mRingBo.sync(XCL_BO_SYNC_BO_TO_DEVICE, RING_LINE, line);
+        mRingBo.sync(XCL_BO_SYNC_BO_TO_DEVICE, RING_LINE, 0);
+    }
+    return mHead;
+}
+
+void CommandRing::wait(uint32_t seq) {
+    while ((int32_t)(mTail - seq) < 0) completed();
+}
+
+void CommandRing::stop() {
+    wait(submit(RING_STOP, 0, 0));
+    if (mEmulated) mThread.join();
+    else mRun.wait();
+    mStopped = true;
+}
@@ -0,0 +1,61 @@
+/**
+ * @brief Host side of the command ring of the persistent ring_kernel (see ring_layout.h).
+ *
+ * The kernel is started once with the ring bo and the input and output bos, then each chunk
+ * is a command written in a slot and published by syncing the slot and the head line to the
+ * device. Completion is polled by syncing the tail line back. The emulated ring runs
+ * ring_serve() on a host thread over host buffers with the same protocol, without XRT.
+ */
+#ifndef CMDRING_H_
+#define CMDRING_H_
+
+#include "ring_layout.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "experimental/xrt_bo.h"
+#include "experimental/xrt_device.h"
+#include "experimental/xrt_kernel.h"
+
+class CommandRing {
+public:
+    // Starts ring_kernel serving copies from `in` to `out` at the same offsets
+    CommandRing(xrt::device& device, const xrt::uuid& uuid, xrt::bo in, xrt::bo out);
+
+    // Software emulation between two host buffers
+    CommandRing(const char *in, char *out);
+
+    ~CommandRing();
+
+    // Publish a command, waiting while the ring is full. Returns its sequence number.
+    uint32_t submit(uint32_t op, uint64_t offset, uint32_t length);
+
+    // Until the command `seq` and all the ones before it completed
+    void wait(uint32_t seq);
+
+    // RING_STOP, then wait for the kernel or the emulation thread to return
+    void stop();
+
+    bool emulated() const { return mEmulated; }
+
+    // Reads of the tail by the host, a sync from the device each on the device
+    uint64_t polls() const { return mPolls; }
+
+private:
+    uint32_t completed();
+
+    bool mEmulated;
+    bool mStopped;
+    xrt::kernel mKernel;
+    xrt::run mRun;
+    xrt::bo mRingBo;
+    CommandRingLayout *mRing;
+    std::thread mThread;
+    uint32_t mHead;
+    uint32_t mTail;
+    uint64_t mPolls;
+};
+
+#endif /* CMDRING_H_ */
@@ -0,0 +1,87 @@
+/**
+ * @brief Command ring of the persistent kernel, shared by ring_kernel and the host.
+ *
+ * ring_kernel is started once and polls the ring in device memory instead of being launched
+ * per chunk. The host writes a RingCommand in the next slot, then bumps `head`; the kernel
+ * runs the commands in order and bumps `tail` after each one. The two counters live on their
+ * own 64-byte lines so each side only ever syncs the line the other one does not write.
+ * ring_serve() is the loop of the kernel, the software emulation runs it on a host thread.
+ */
+#ifndef RING_LAYOUT_H_
+#define RING_LAYOUT_H_
+
+#include <stdint.h>
+
+#if !defined(__SYNTHESIS__)
+#include <string.h>
+#endif
+
+#define RING_SLOTS 256 // power of two
+#define RING_LINE 64
+
+enum RingOp { RING_NOP = 0, RING_COPY = 1, RING_STOP = 2 };
+
+// A slot is valid once seq holds the 1-based position of the command in the stream
+struct RingCommand {
+    uint64_t offset; // in the input and output buffers
+    uint32_t length; // bytes
+    uint32_t op;     // RingOp
+    uint32_t seq;
+    uint32_t reserved[3];
+};
+
+struct RingControl {
+    uint32_t head; // commands published by the host
+    uint32_t pad0[RING_LINE / 4 - 1];
+    uint32_t tail; // commands completed by the kernel
+    uint32_t pad1[RING_LINE / 4 - 1];
+};
+
+struct CommandRingLayout {
+    struct RingControl control;
+    struct RingCommand slots[RING_SLOTS];
+};
+
+// Orders the polled accesses between host threads, the kernel sees them through volatile.
+// Emulated pollers give the CPU up when idle, the host may have fewer cores than pollers.
+#if defined(__SYNTHESIS__)
+#define RING_FENCE()
+#define RING_IDLE()
+#else
+#include <sched.h>
+#define RING_FENCE() __sync_synchronize()
+#define RING_IDLE() sched_yield()
+#endif
+
+static inline void ring_copy(unsigned char *out, const unsigned char *in, uint32_t length) {
+#if defined(__SYNTHESIS__)
+    for (uint32_t i = 0; i < length; i++) out[i] = in[i];
+#else
+    memcpy(out, in, length);
+#endif
+}
+
+/**
+ * Run the commands of `ring` as they are published until RING_STOP, which completes too.
+ * Returns the number of commands completed.
+ */
+static inline uint32_t ring_serve(volatile struct CommandRingLayout *ring, const unsigned char *in, unsigned char *out) {
+    uint32_t tail = ring->control.tail;
+    for (;;) {
+        volatile struct RingCommand *slot = &ring->slots[tail % RING_SLOTS];
+        // The head may be seen before the slot it covers
+        if (ring->control.head == tail || slot->seq != tail + 1) {
+            RING_IDLE();
+            continue;
+        }
+        RING_FENCE();
+        uint32_t op = slot->op;
+        if (op == RING_COPY) ring_copy(out + slot->offset, in + slot->offset, slot->length);
+        tail++;
+        RING_FENCE();
+        ring->control.tail = tail;
+        if (op == RING_STOP) return tail;
+    }
+}
+
+#endif /* RING_LAYOUT_H_ */
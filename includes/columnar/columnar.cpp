@@ -0,0 +1,213 @@
+#include "columnar.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ColfColumn colf_column(const std::string& name, FilterType type) {
+    ColfColumn column;
+    memset(&column, 0, sizeof(column));
+    strncpy(column.name, name.c_str(), COLF_NAME_SIZE - 1);
+    column.type = type;
+    column.width = colf_type_width(type);
+    return column;
+}
+
+ColumnarWriter::ColumnarWriter(const std::vector<ColfColumn>& columns)
+    : mColumns(columns), mFd(-1), mOffset(0), mRows(0), mBuf(nullptr), mBufSize(0) {}
+
+ColumnarWriter::~ColumnarWriter() {
+    if (mFd >= 0) close();
+    free(mBuf);
+}
+
+int ColumnarWriter::open(const std::string& path) {
+    mFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (mFd < 0) return -errno;
+    mChunks.clear();
+    mOffset = 0;
+    mRows = 0;
+    return 0;
+}
+
+// Aligned staging buffer of at least `size` bytes for the O_DIRECT writes
+int ColumnarWriter::reserve(size_t size) {
+    if (size <= mBufSize) return 0;
+    free(mBuf);
+    mBuf = (char*)aligned_alloc(COLF_ALIGN, size);
+    mBufSize = mBuf ? size : 0;
+    return mBuf ? 0 : -ENOMEM;
+}
+
+int ColumnarWriter::write_group(const std::vector<const void*>& columns, uint32_t rows) {
+    if (columns.size() != mColumns.size()) return -EINVAL;
+    size_t group_size = 0;
+    for (const ColfColumn& column : mColumns) group_size += colf_align((size_t)rows * column.width);
+    int ret = reserve(group_size);
+    if (ret != 0) return ret;
+
+    // The chunks of a group are contiguous, one pwrite per group
+    memset(mBuf, 0, group_size);
+    size_t pos = 0;
+    for (size_t c = 0; c < mColumns.size(); c++) {
+        ColfChunk chunk;
+        chunk.offset = mOffset + pos;
+        chunk.size = rows * mColumns[c].width;
+        chunk.rows = rows;
+        memcpy(mBuf + pos, columns[c], chunk.size);
+        mChunks.push_back(chunk);
+        pos += colf_align(chunk.size);
+    }
+    if (pwrite(mFd, mBuf, group_size, mOffset) != (ssize_t)group_size) return -errno;
+    mOffset += group_size;
+    mRows += rows;
+    return 0;
+}
+
+int ColumnarWriter::write_rows(const void *records, uint32_t record_size, const std::vector<uint32_t>& offsets, uint32_t rows) {
+    if (offsets.size() != mColumns.size()) return -EINVAL;
+    std::vector<std::vector<char>> data(mColumns.size());
+    std::vector<const void*> columns;
+    for (size_t c = 0; c < mColumns.size(); c++) {
+        uint32_t width = mColumns[c].width;
+        data[c].resize((size_t)rows * width);
+        const char *field = (const char*)records + offsets[c];
+        for (uint32_t r = 0; r < rows; r++, field += record_size) {
+            memcpy(data[c].data() + (size_t)r * width, field, width);
+        }
+        columns.push_back(data[c].data());
+    }
+    return write_group(columns, rows);
+}
+
+int ColumnarWriter::write_group_data(const void *group, uint32_t rows) {
+    size_t group_size = 0;
+    for (const ColfColumn& column : mColumns) {
+        ColfChunk chunk;
+        chunk.offset = mOffset + group_size;
+        chunk.size = rows * column.width;
+        chunk.rows = rows;
+        mChunks.push_back(chunk);
+        group_size += colf_align(chunk.size);
+    }
+    if (pwrite(mFd, group, group_size, mOffset) != (ssize_t)group_size) return -errno;
+    mOffset += group_size;
+    mRows += rows;
+    return 0;
+}
+
+int ColumnarWriter::close() {
+    ColfTrailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.magic = COLF_MAGIC;
+    trailer.version = COLF_VERSION;
+    trailer.num_columns = mColumns.size();
+    trailer.num_groups = mColumns.empty() ? 0 : mChunks.size() / mColumns.size();
+    trailer.num_rows = mRows;
+    trailer.footer_offset = mOffset;
+
+    size_t columns_bytes = mColumns.size() * sizeof(ColfColumn);
+    size_t chunks_bytes = mChunks.size() * sizeof(ColfChunk);
+    trailer.footer_size = colf_align(columns_bytes + chunks_bytes);
+
+    size_t size = trailer.footer_size + COLF_ALIGN;
+    int ret = reserve(size);
+    if (ret == 0) {
+        memset(mBuf, 0, size);
+        memcpy(mBuf, mColumns.data(), columns_bytes);
+        memcpy(mBuf + columns_bytes, mChunks.data(), chunks_bytes);
+        memcpy(mBuf + trailer.footer_size, &trailer, sizeof(trailer));
+        if (pwrite(mFd, mBuf, size, mOffset) != (ssize_t)size) ret = -errno;
+    }
+    if (::close(mFd) != 0 && ret == 0) ret = -errno;
+    mFd = -1;
+    return ret;
+}
+
+ColumnarReader::ColumnarReader() : mFd(-1) {
+    memset(&mTrailer, 0, sizeof(mTrailer));
+}
+
+ColumnarReader::~ColumnarReader() {
+    close();
+}
+
+int ColumnarReader::open(const std::string& path) {
+    close();
+    mFd = ::open(path.c_str(), O_RDONLY | O_DIRECT);
+    if (mFd < 0) return -errno;
+
+    struct stat st;
+    if (fstat(mFd, &st) != 0) return -errno;
+    if (st.st_size < COLF_ALIGN || st.st_size % COLF_ALIGN != 0) return -EINVAL;
+
+    char *buf = (char*)aligned_alloc(COLF_ALIGN, COLF_ALIGN);
+    if (!buf) return -ENOMEM;
+    int ret = 0;
+    if (pread(mFd, buf, COLF_ALIGN, st.st_size - COLF_ALIGN) != COLF_ALIGN) ret = -errno;
+    memcpy(&mTrailer, buf, sizeof(mTrailer));
+    free(buf);
+    if (ret != 0) return ret;
+    if (mTrailer.magic != COLF_MAGIC || mTrailer.version != COLF_VERSION ||
+        mTrailer.footer_offset + mTrailer.footer_size + COLF_ALIGN != (uint64_t)st.st_size) {
+        return -EINVAL;
+    }
+
+    size_t columns_bytes = mTrailer.num_columns * sizeof(ColfColumn);
+    size_t chunks_bytes = (size_t)mTrailer.num_groups * mTrailer.num_columns * sizeof(ColfChunk);
+    if (columns_bytes + chunks_bytes > mTrailer.footer_size) return -EINVAL;
+    buf = (char*)aligned_alloc(COLF_ALIGN, mTrailer.footer_size);
+    if (!buf) return -ENOMEM;
+    if (pread(mFd, buf, mTrailer.footer_size, mTrailer.footer_offset) != (ssize_t)mTrailer.footer_size) ret = -errno;
+    const ColfColumn *columns = (const ColfColumn*)buf;
+    const ColfChunk *chunks = (const ColfChunk*)(buf + columns_bytes);
+    mColumns.assign(columns, columns + mTrailer.num_columns);
+    mChunks.assign(chunks, chunks + (size_t)mTrailer.num_groups * mTrailer.num_columns);
+    free(buf);
+    return ret;
+}
+
+void ColumnarReader::close() {
+    if (mFd >= 0) (void)::close(mFd);
+    mFd = -1;
+    mColumns.clear();
+    mChunks.clear();
+    memset(&mTrailer, 0, sizeof(mTrailer));
+}
+
+int ColumnarReader::column_index(const std::string& name) const {
+    for (size_t c = 0; c < mColumns.size(); c++) {
+        if (name == mColumns[c].name) return c;
+    }
+    return -1;
+}
+
+ssize_t ColumnarReader::read_group(uint32_t group, const std::vector<int>& columns, void *dst, std::vector<size_t>& offsets) {
+    if (group >= mTrailer.num_groups) return -EINVAL;
+    offsets.clear();
+    size_t pos = 0;
+    for (int c : columns) {
+        if (c < 0 || c >= (int)mColumns.size()) return -EINVAL;
+        const ColfChunk& col = chunk(group, c);
+        size_t len = colf_align(col.size);
+        if (pread(mFd, (char*)dst + pos, len, col.offset) != (ssize_t)len) return -errno;
+        offsets.push_back(pos);
+        pos += len;
+    }
+    return pos;
+}
+
+size_t ColumnarReader::group_bytes(const std::vector<int>& columns) const {
+    size_t max = 0;
+    for (uint32_t g = 0; g < mTrailer.num_groups; g++) {
+        size_t bytes = 0;
+        for (int c : columns) bytes += colf_align(chunk(g, c).size);
+        max = std::max(max, bytes);
+    }
+    return max;
+}
@@ -0,0 +1,142 @@
+/**
+ * @brief Columnar on-disk format laid out for P2P scans, with its writer and reader.
+ *
+ * Rows are cut in groups and each column of a group is stored as one contiguous chunk
+ * of fixed-width little-endian values, so a scan only reads the columns it needs. On the SSD :
+ *
+ *   [0, footer_offset)              column chunks, group after group, each one starting
+ *                                   4 KiB aligned so it can be read with a P2P pread
+ *   [footer_offset, +footer_size)   ColfColumn per column then ColfChunk per group and
+ *                                   column, padded to 4 KiB
+ *   [file_size - 4 KiB, file_size)  ColfTrailer
+ *
+ * Column types are the ones of filter_kernel, a chunk read into a bo is a stream of
+ * records of one column at offset 0. The format definitions are plain C so they can be
+ * included by the kernels.
+ */
+#ifndef COLUMNAR_H_
+#define COLUMNAR_H_
+
+#include "filter.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define COLF_MAGIC 0x464C4F43 // "COLF"
+#define COLF_VERSION 1
+#define COLF_ALIGN 4096
+#define COLF_NAME_SIZE 24
+
+struct ColfColumn {
+    char name[COLF_NAME_SIZE]; // NUL terminated
+    uint32_t type;             // FilterType
+    uint32_t width;            // bytes per value
+};
+
+struct ColfChunk {
+    uint64_t offset; // multiple of COLF_ALIGN
+    uint32_t size;   // rows * width, the chunk is padded to COLF_ALIGN on disk
+    uint32_t rows;
+};
+
+struct ColfTrailer {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_columns;
+    uint32_t num_groups;
+    uint64_t num_rows;
+    uint64_t footer_offset;
+    uint64_t footer_size;
+};
+
+#if defined(__cplusplus) && !defined(__SYNTHESIS__)
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+inline size_t colf_align(size_t size) { return (size + COLF_ALIGN - 1) / COLF_ALIGN * COLF_ALIGN; }
+
+inline uint32_t colf_type_width(uint32_t type) { return type == FILTER_INT32 ? 4 : 8; }
+
+ColfColumn colf_column(const std::string& name, FilterType type);
+
+/**
+ * Writes a columnar file group by group with O_DIRECT. Every call to write_group(),
+ * write_rows() or write_group_data() adds one row group, close() writes the footer. Errors
+ * are returned as -errno.
+ */
+class ColumnarWriter {
+public:
+    ColumnarWriter(const std::vector<ColfColumn>& columns);
+    ~ColumnarWriter();
+
+    int open(const std::string& path);
+
+    // One row group, columns[i] holds the `rows` values of column i back to back
+    int write_group(const std::vector<const void*>& columns, uint32_t rows);
+
+    // One row group from fixed-width records, column i being at byte offsets[i] of each record
+    int write_rows(const void *records, uint32_t record_size, const std::vector<uint32_t>& offsets, uint32_t rows);
+
+    /**
+     * One row group already laid out in `group` as on disk : the chunks back to back, each
+     * padded to COLF_ALIGN. Written straight from it, so a p2p bo mapping makes a P2P write.
+     */
+    int write_group_data(const void *group, uint32_t rows);
+
+    int close();
+
+    uint64_t bytes_written() const { return mOffset; }
+
+private:
+    int reserve(size_t size);
+
+    std::vector<ColfColumn> mColumns;
+    std::vector<ColfChunk> mChunks;
+    int mFd;
+    uint64_t mOffset;
+    uint64_t mRows;
+    char *mBuf;
+    size_t mBufSize;
+};
+
+/**
+ * Reads the footer of a columnar file, then the chunks of the requested columns of a
+ * group straight into a p2p bo mapping. The file is opened with O_DIRECT.
+ */
+class ColumnarReader {
+public:
+    ColumnarReader();
+    ~ColumnarReader();
+
+    // Returns 0 or -errno, -EINVAL when the file is not in the format
+    int open(const std::string& path);
+    void close();
+
+    const std::vector<ColfColumn>& columns() const { return mColumns; }
+    uint32_t groups() const { return mTrailer.num_groups; }
+    uint64_t rows() const { return mTrailer.num_rows; }
+    const ColfChunk& chunk(uint32_t group, uint32_t column) const { return mChunks[group * mColumns.size() + column]; }
+
+    // Index of the column called `name`, -1 when there is none
+    int column_index(const std::string& name) const;
+
+    /**
+     * Read the chunks of `columns` of `group` back to back into dst, each one at a 4 KiB
+     * aligned offset stored in offsets. dst must hold group_bytes(). Returns the bytes
+     * read from the SSD or -errno.
+     */
+    ssize_t read_group(uint32_t group, const std::vector<int>& columns, void *dst, std::vector<size_t>& offsets);
+
+    // Bytes of dst needed by read_group() for the largest group
+    size_t group_bytes(const std::vector<int>& columns) const;
+
+private:
+    int mFd;
+    ColfTrailer mTrailer;
+    std::vector<ColfColumn> mColumns;
+    std::vector<ColfChunk> mChunks;
+};
+#endif
+
+#endif /* COLUMNAR_H_ */
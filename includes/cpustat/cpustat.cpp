@@ -0,0 +1,68 @@
+#include "cpustat.h"
+
+#include <chrono>
+#include <sys/resource.h>
+#include <time.h>
+
+static double to_seconds(const struct timeval& tv) {
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static CpuUsage now() {
+    CpuUsage usage;
+    usage.wall = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    usage.user = to_seconds(ru.ru_utime);
+    usage.sys = to_seconds(ru.ru_stime);
+    usage.ctx = ru.ru_nvcsw + ru.ru_nivcsw;
+    usage.minflt = ru.ru_minflt;
+    usage.majflt = ru.ru_majflt;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    usage.thread = ts.tv_sec + ts.tv_nsec / 1e9;
+    return usage;
+}
+
+void CpuMeter::start() {
+    mStart = now();
+}
+
+CpuUsage CpuMeter::stop() const {
+    CpuUsage end = now();
+    end.wall -= mStart.wall;
+    end.user -= mStart.user;
+    end.sys -= mStart.sys;
+    end.thread -= mStart.thread;
+    end.ctx -= mStart.ctx;
+    end.minflt -= mStart.minflt;
+    end.majflt -= mStart.majflt;
+    return end;
+}
+
+CpuStats::CpuStats() : mTotal(), mBytes(0) {}
+
+void CpuStats::add(const CpuUsage& usage, size_t bytes) {
+    mTotal.wall += usage.wall;
+    mTotal.user += usage.user;
+    mTotal.sys += usage.sys;
+    mTotal.thread += usage.thread;
+    mTotal.ctx += usage.ctx;
+    mTotal.minflt += usage.minflt;
+    mTotal.majflt += usage.majflt;
+    mBytes += bytes;
+}
+
+double CpuStats::cpu_seconds_per_gib() const {
+    if (mBytes == 0) return 0;
+    return (mTotal.user + mTotal.sys) / (mBytes / (1024.0 * 1024 * 1024));
+}
+
+void CpuStats::print(std::ostream& out) const {
+    double wall = mTotal.wall > 0 ? mTotal.wall : 1;
+    out << "cpu: usr=" << mTotal.user * 100 / wall << "% sys=" << mTotal.sys * 100 / wall
+        << "% ctx=" << mTotal.ctx << " majf=" << mTotal.majflt << " minf=" << mTotal.minflt
+        << ", thread=" << mTotal.thread << "s, " << cpu_seconds_per_gib() << " cpu-s/GiB";
+}
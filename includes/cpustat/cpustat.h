@@ -0,0 +1,52 @@
+/**
+ * @brief Host CPU cost accounting of a transfer, in the spirit of fio's
+ *        "cpu: usr= sys= ctx=" line.
+ *
+ * User and system time come from getrusage(RUSAGE_SELF) so the XRT helper threads
+ * are included, the calling thread's own time from CLOCK_THREAD_CPUTIME_ID.
+ */
+#ifndef CPUSTAT_H_
+#define CPUSTAT_H_
+
+#include <cstddef>
+#include <ostream>
+
+struct CpuUsage {
+    double wall;   // s
+    double user;   // s, whole process
+    double sys;    // s, whole process
+    double thread; // s, calling thread
+    long ctx;      // voluntary + involuntary context switches
+    long minflt;
+    long majflt;
+};
+
+// Measures the CPU usage between start() and stop()
+class CpuMeter {
+public:
+    CpuMeter() { start(); }
+    void start();
+    CpuUsage stop() const;
+
+private:
+    CpuUsage mStart;
+};
+
+// Accumulates the CPU usage of the runs of one transfer mode
+class CpuStats {
+public:
+    CpuStats();
+    void add(const CpuUsage& usage, size_t bytes);
+    void reset() { *this = CpuStats(); }
+
+    // "cpu: usr=..% sys=..% ctx=.. majf=.. minf=.., thread=..s, ..cpu-s/GiB"
+    void print(std::ostream& out) const;
+
+    double cpu_seconds_per_gib() const;
+
+private:
+    CpuUsage mTotal;
+    double mBytes;
+};
+
+#endif /* CPUSTAT_H_ */
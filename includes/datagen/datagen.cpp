@@ -0,0 +1,102 @@
+#include "datagen.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+void fill_log_lines(char *buf, size_t size, uint64_t seed) {
+    static const char *levels[] = {"INFO ", "INFO ", "INFO ", "INFO ", "INFO ", "INFO ", "DEBUG", "WARN ", "ERROR"};
+    static const char *methods[] = {"GET", "GET", "GET", "POST", "PUT", "DELETE"};
+    static const char *paths[] = {"/api/v1/items/", "/api/v1/users/", "/api/v1/orders/", "/static/img/", "/health/"};
+    static const int statuses[] = {200, 200, 200, 200, 201, 204, 304, 400, 404, 500};
+
+    std::mt19937_64 rng(seed);
+    long long millis = 0;
+    char line[256];
+    size_t pos = 0;
+    while (pos < size) {
+        millis += rng() % 50;
+        long long seconds = millis / 1000;
+        int len = snprintf(line, sizeof(line),
+                           "2026-10-18T%02lld:%02lld:%02lld.%03lldZ %s [worker-%02d] %s %s%llu status=%d latency_ms=%llu user=u%llu\n",
+                           (seconds / 3600) % 24, (seconds / 60) % 60, seconds % 60, millis % 1000,
+                           levels[rng() % 9], (int)(rng() % 32), methods[rng() % 6], paths[rng() % 5],
+                           (unsigned long long)(rng() % 100000), statuses[rng() % 10],
+                           (unsigned long long)(rng() % 1000), (unsigned long long)(rng() % 10000));
+        size_t n = std::min((size_t)len, size - pos);
+        memcpy(buf + pos, line, n);
+        pos += n;
+    }
+}
+
+void fill_records(char *buf, size_t size, uint64_t first_id, uint64_t seed) {
+    std::mt19937_64 rng(seed + first_id);
+    std::uniform_real_distribution<double> price(0, 1000);
+    OrderRecord record;
+    for (size_t pos = 0; pos < size; pos += sizeof(record)) {
+        record.id = first_id++;
+        record.key = rng() % ORDER_KEY_RANGE;
+        record.category = rng() % 100;
+        record.price = price(rng);
+        record.quantity = 1 + rng() % 100;
+        memcpy(buf + pos, &record, std::min(sizeof(record), size - pos));
+    }
+}
+
+size_t fill_order_lines(char *buf, size_t size, bool json, uint64_t first_id, uint64_t *rows, uint64_t seed) {
+    const size_t batch = 1024;
+    OrderRecord records[batch];
+    char line[160];
+    size_t pos = 0;
+    *rows = 0;
+    for (uint64_t id = first_id;; id += batch) {
+        fill_records((char*)records, sizeof(records), id, seed);
+        for (const OrderRecord& r : records) {
+            const char *format = json ? "{\"id\":%lld,\"key\":%d,\"category\":%d,\"price\":%.2f,\"quantity\":%lld}\n"
+                                      : "%lld,%d,%d,%.2f,%lld\n";
+            int len = snprintf(line, sizeof(line), format, (long long)r.id, r.key, r.category, r.price, (long long)r.quantity);
+            if (pos + len > size) return pos;
+            memcpy(buf + pos, line, len);
+            pos += len;
+            (*rows)++;
+        }
+    }
+}
+
+void order_keys(char *buf, size_t size, uint64_t first_id, uint64_t total, double disorder, uint64_t seed) {
+    std::mt19937_64 rng(seed + first_id);
+    std::uniform_real_distribution<double> jitter(-disorder, disorder);
+    for (size_t pos = 0; pos + sizeof(OrderRecord) <= size; pos += sizeof(OrderRecord)) {
+        OrderRecord *record = (OrderRecord*)(buf + pos);
+        double key = ((double)record->id / total + jitter(rng)) * ORDER_KEY_RANGE;
+        record->key = std::min(std::max(key, 0.0), (double)ORDER_KEY_RANGE - 1);
+    }
+}
+
+uint64_t scramble_id(uint64_t id) {
+    const uint64_t mask = (1ull << 48) - 1;
+    // xorshifts by half the width and odd multipliers are both invertible modulo 2^48
+    uint64_t x = id & mask;
+    x ^= x >> 24;
+    x = (x * 0x9E3779B97F4Bull) & mask;
+    x ^= x >> 24;
+    x = (x * 0xC2B2AE3D27D5ull) & mask;
+    x ^= x >> 24;
+    return x;
+}
+
+void scramble_ids(char *buf, size_t size) {
+    for (size_t pos = 0; pos + sizeof(OrderRecord) <= size; pos += sizeof(OrderRecord)) {
+        OrderRecord *record = (OrderRecord*)(buf + pos);
+        record->id = scramble_id(record->id);
+    }
+}
+
+void set_categories(char *buf, size_t size, uint32_t cardinality, uint64_t first_id, uint64_t seed) {
+    std::mt19937_64 rng(seed + first_id);
+    for (size_t pos = 0; pos + sizeof(OrderRecord) <= size; pos += sizeof(OrderRecord)) {
+        OrderRecord *record = (OrderRecord*)(buf + pos);
+        record->category = rng() % cardinality;
+    }
+}
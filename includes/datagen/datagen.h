@@ -0,0 +1,49 @@
+/**
+ * @brief Synthetic data sets for the offload benchmarks, all deterministic for a given seed.
+ */
+#ifndef DATAGEN_H_
+#define DATAGEN_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Web service style text log lines, compresses about 3-5x like our production logs
+void fill_log_lines(char *buf, size_t size, uint64_t seed = 42);
+
+// Fixed-width order records of the scan modes, the last record is truncated when size is not a multiple
+struct OrderRecord {
+    int64_t id;       // sequential from first_id
+    int32_t key;      // uniform in [0, ORDER_KEY_RANGE)
+    int32_t category; // uniform in [0, 100)
+    double price;     // uniform in [0, 1000)
+    int64_t quantity; // uniform in [1, 100]
+};
+
+static const int32_t ORDER_KEY_RANGE = 1000000;
+
+void fill_records(char *buf, size_t size, uint64_t first_id = 0, uint64_t seed = 42);
+
+/**
+ * Replace the keys of records filled by fill_records() so they grow with the id over `total`
+ * records, each one moved by up to `disorder` times the key range : 0 sorts the keys,
+ * small values give semi-sorted data such as late arrivals in an event log.
+ */
+void order_keys(char *buf, size_t size, uint64_t first_id, uint64_t total, double disorder, uint64_t seed = 42);
+
+// Replace the categories of records filled by fill_records() by uniform values in [0, cardinality)
+void set_categories(char *buf, size_t size, uint32_t cardinality, uint64_t first_id, uint64_t seed = 42);
+
+/**
+ * Order records as text lines, CSV "id,key,category,price,quantity" or JSON lines with the
+ * same keys, the price with two decimals. Writes the whole lines that fit in `size` and
+ * returns their bytes, the number of records is stored in *rows.
+ */
+size_t fill_order_lines(char *buf, size_t size, bool json, uint64_t first_id, uint64_t *rows, uint64_t seed = 42);
+
+// Bijection of 48-bit ids to scattered 48-bit values, which doubles still hold exactly
+uint64_t scramble_id(uint64_t id);
+
+// Replace the sequential ids of records filled by fill_records() by their scramble_id()
+void scramble_ids(char *buf, size_t size);
+
+#endif /* DATAGEN_H_ */
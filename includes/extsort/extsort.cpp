@@ -0,0 +1,240 @@
+#include "extsort.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Run size cap, the kernel needs twice as many SortPairs of scratch as records
+static const size_t SORT_CHUNK = 256 << 20;
+static const size_t SORT_ALIGN = 4096;
+// Read-ahead of each run and write-behind of the output during the merge
+static const size_t MERGE_READ = 4 << 20;
+static const size_t MERGE_WRITE = 64 << 20;
+
+void sort_model(const uint8_t *in, uint8_t *out, uint32_t record_size, uint32_t key_offset, FilterType key_type,
+                uint32_t num_records) {
+    std::vector<SortPair> scratch(2 * (size_t)num_records);
+    SortPair *a = scratch.data();
+    SortPair *b = a + num_records;
+    SortPair local[SORT_NETWORK];
+
+    // Same network as sort_kernel, blocks padded with sentinels
+    for (uint32_t base = 0; base < num_records; base += SORT_NETWORK) {
+        for (uint32_t i = 0; i < SORT_NETWORK; i++) {
+            if (base + i < num_records) {
+                local[i].key = sort_key(in + (size_t)(base + i) * record_size + key_offset, key_type);
+                local[i].index = base + i;
+            } else {
+                local[i].key = ~0ull;
+                local[i].index = ~0u;
+            }
+            local[i].reserved = 0;
+        }
+        for (uint32_t k = 2; k <= SORT_NETWORK; k <<= 1) {
+            for (uint32_t j = k >> 1; j > 0; j >>= 1) {
+                for (uint32_t i = 0; i < SORT_NETWORK; i++) {
+                    uint32_t l = i ^ j;
+                    if (l <= i) continue;
+                    bool ascending = (i & k) == 0;
+                    if (ascending == (bool)sort_pair_less(&local[l], &local[i])) std::swap(local[i], local[l]);
+                }
+            }
+        }
+        uint32_t count = std::min<uint32_t>(SORT_NETWORK, num_records - base);
+        std::copy(local, local + count, a + base);
+    }
+
+    for (uint32_t width = SORT_NETWORK; width < num_records; width *= 2) {
+        for (uint32_t lo = 0; lo < num_records; lo += 2 * width) {
+            uint32_t mid = std::min(lo + width, num_records);
+            uint32_t hi = std::min(lo + 2 * width, num_records);
+            uint32_t i = lo, j = mid;
+            for (uint32_t k = lo; k < hi; k++) {
+                if (j >= hi || (i < mid && !sort_pair_less(&a[j], &a[i]))) b[k] = a[i++];
+                else b[k] = a[j++];
+            }
+        }
+        std::swap(a, b);
+    }
+
+    for (uint32_t r = 0; r < num_records; r++) {
+        memcpy(out + (size_t)r * record_size, in + (size_t)a[r].index * record_size, record_size);
+    }
+}
+
+ExternalSorter::ExternalSorter(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map)
+    : mModel(false), mChunk(std::min(SORT_CHUNK, p2p_bo.size() / 2)), mDevice(device),
+      mKernel(device, uuid, "sort_kernel"), mBo(p2p_bo), mMap((char*)p2p_map), mScratchBytes(0) {}
+
+ExternalSorter::ExternalSorter(size_t chunk) : mModel(true), mChunk(chunk), mMap(nullptr), mScratchBytes(0) {}
+
+static void fail(const char *what) {
+    std::cerr << "ERR: " << what << " failed: " << strerror(errno) << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+size_t ExternalSorter::form_runs(int in_fd, int runs_fd, size_t size, size_t chunk, const Schema& schema,
+                                 const Column& key, bool check_model, bool& model_match) {
+    uint32_t record_size = schema.record_size;
+    size_t runs = 0;
+    char *in = mMap;
+    char *out = mMap + chunk;
+    xrt::bo in_bo, out_bo;
+    if (mModel) {
+        in = (char*)aligned_alloc(SORT_ALIGN, chunk);
+        out = (char*)aligned_alloc(SORT_ALIGN, chunk);
+    } else {
+        // Input and sorted run side by side in the p2p bo, both P2P transferred
+        in_bo = xrt::bo(mBo, chunk, 0);
+        out_bo = xrt::bo(mBo, chunk, chunk);
+        size_t scratch = 2 * (chunk / record_size) * sizeof(SortPair);
+        if (mScratchBytes < scratch) {
+            mScratchBo = xrt::bo(mDevice, scratch, mKernel.group_id(2));
+            mScratchBytes = scratch;
+        }
+    }
+
+    for (size_t offset = 0; offset < size; offset += chunk, runs++) {
+        size_t len = std::min(chunk, size - offset);
+        size_t io_len = (len + SORT_ALIGN - 1) / SORT_ALIGN * SORT_ALIGN;
+        uint32_t records = len / record_size;
+        if (pread(in_fd, in, io_len, offset) < (ssize_t)len) fail("pread");
+        if (mModel) {
+            sort_model((const uint8_t*)in, (uint8_t*)out, record_size, key.offset, key.type, records);
+        } else {
+            auto run = mKernel(in_bo, out_bo, mScratchBo, record_size, key.offset, (unsigned int)key.type, records);
+            run.wait();
+            if (check_model && offset == 0) {
+                std::vector<uint8_t> host_in(in, in + len), expected(len);
+                sort_model(host_in.data(), expected.data(), record_size, key.offset, key.type, records);
+                model_match = memcmp(expected.data(), out, len) == 0;
+            }
+        }
+        if (pwrite(runs_fd, out, io_len, offset) < (ssize_t)len) fail("pwrite");
+    }
+
+    if (mModel) {
+        free(in);
+        free(out);
+    }
+    return runs;
+}
+
+struct RunCursor {
+    size_t next; // file offset of the next read
+    size_t end;
+    char *buf;
+    size_t pos;
+    size_t fill;
+};
+
+struct MergeHead {
+    uint64_t key;
+    uint32_t run;
+    bool operator>(const MergeHead& o) const { return key > o.key || (key == o.key && run > o.run); }
+};
+
+static bool refill(int fd, RunCursor& cursor, size_t read_size) {
+    if (cursor.next >= cursor.end) return false;
+    size_t len = std::min(read_size, cursor.end - cursor.next);
+    size_t io_len = (len + SORT_ALIGN - 1) / SORT_ALIGN * SORT_ALIGN;
+    if (pread(fd, cursor.buf, io_len, cursor.next) < (ssize_t)len) fail("pread");
+    cursor.next += len;
+    cursor.pos = 0;
+    cursor.fill = len;
+    return true;
+}
+
+SortStats ExternalSorter::sort(const std::string& input, const std::string& output, const Schema& schema,
+                               const std::string& key, size_t size, bool check_model) {
+    SortStats stats = SortStats();
+    const Column& key_column = schema.column(key);
+    uint32_t record_size = schema.record_size;
+
+    int in_fd = open(input.c_str(), O_RDONLY | O_DIRECT);
+    if (in_fd < 0) {
+        std::cerr << "ERROR: open " << input << " failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (size == 0) {
+        struct stat st;
+        fstat(in_fd, &st);
+        size = st.st_size;
+    }
+    size = size / record_size * record_size;
+    std::string runs_path = output + ".runs";
+    int runs_fd = open(runs_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    int out_fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (runs_fd < 0 || out_fd < 0) {
+        std::cerr << "ERROR: open " << output << " failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Runs hold whole records and start 4 KiB aligned
+    size_t unit = record_unit(record_size, SORT_ALIGN);
+    size_t chunk = std::max(record_chunk(record_size, mChunk, SORT_ALIGN), unit);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    stats.runs = form_runs(in_fd, runs_fd, size, chunk, schema, key_column, check_model, stats.model_match);
+    auto formed = std::chrono::high_resolution_clock::now();
+
+    // k-way merge, ties go to the earlier run so the sort stays stable
+    size_t read_size = std::max(MERGE_READ / unit, (size_t)1) * unit;
+    size_t write_size = std::max(MERGE_WRITE / unit, (size_t)1) * unit;
+    std::vector<RunCursor> cursors(stats.runs);
+    std::priority_queue<MergeHead, std::vector<MergeHead>, std::greater<MergeHead>> heap;
+    for (size_t r = 0; r < stats.runs; r++) {
+        RunCursor& cursor = cursors[r];
+        cursor.next = r * chunk;
+        cursor.end = std::min(size, (r + 1) * chunk);
+        cursor.buf = (char*)aligned_alloc(SORT_ALIGN, read_size);
+        refill(runs_fd, cursor, read_size);
+        heap.push({sort_key((const uint8_t*)cursor.buf + key_column.offset, key_column.type), (uint32_t)r});
+    }
+    char *out = (char*)aligned_alloc(SORT_ALIGN, write_size);
+    size_t out_pos = 0, written = 0;
+    while (!heap.empty()) {
+        uint32_t r = heap.top().run;
+        heap.pop();
+        RunCursor& cursor = cursors[r];
+        memcpy(out + out_pos, cursor.buf + cursor.pos, record_size);
+        out_pos += record_size;
+        cursor.pos += record_size;
+        if (out_pos == write_size) {
+            if (pwrite(out_fd, out, out_pos, written) < (ssize_t)out_pos) fail("pwrite");
+            written += out_pos;
+            out_pos = 0;
+        }
+        if (cursor.pos < cursor.fill || refill(runs_fd, cursor, read_size)) {
+            heap.push({sort_key((const uint8_t*)cursor.buf + cursor.pos + key_column.offset, key_column.type), r});
+        }
+    }
+    if (out_pos > 0) {
+        size_t io_len = (out_pos + SORT_ALIGN - 1) / SORT_ALIGN * SORT_ALIGN;
+        if (pwrite(out_fd, out, io_len, written) < (ssize_t)out_pos) fail("pwrite");
+        written += out_pos;
+    }
+    // Drop the padding of the last O_DIRECT writes
+    if (ftruncate(out_fd, written) != 0 || ftruncate(runs_fd, size) != 0) fail("ftruncate");
+    auto merged = std::chrono::high_resolution_clock::now();
+
+    for (RunCursor& cursor : cursors) free(cursor.buf);
+    free(out);
+    (void)close(in_fd);
+    (void)close(runs_fd);
+    (void)close(out_fd);
+
+    stats.records = size / record_size;
+    stats.run_us = std::chrono::duration_cast<std::chrono::microseconds>(formed - start).count();
+    stats.merge_us = std::chrono::duration_cast<std::chrono::microseconds>(merged - formed).count();
+    return stats;
+}
@@ -0,0 +1,69 @@
+/**
+ * @brief External merge sort of fixed-width record files larger than host memory.
+ *
+ * Run formation : chunks of the input are P2P read into the p2p bo, sort_kernel sorts
+ * each one (bitonic network over blocks of SORT_NETWORK records, then merge passes in
+ * device memory) into the second half of the bo, which is P2P written back as a sorted
+ * run. Merge : the runs are read back with O_DIRECT a few MiB at a time and merged by a
+ * streaming k-way merge on the host into the output file.
+ *
+ * sort_model() is a software model of sort_kernel, giving the same bytes, and the sorter
+ * can form the runs with it on the host instead of the device.
+ */
+#ifndef EXTSORT_H_
+#define EXTSORT_H_
+
+#include "sort_network.h"
+#include "scan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "experimental/xrt_bo.h"
+#include "experimental/xrt_device.h"
+#include "experimental/xrt_kernel.h"
+
+// Software model of sort_kernel : `num_records` records of `in` sorted into `out`
+void sort_model(const uint8_t *in, uint8_t *out, uint32_t record_size, uint32_t key_offset, FilterType key_type,
+                uint32_t num_records);
+
+struct SortStats {
+    uint64_t records;
+    uint64_t runs;
+    long long run_us;   // run formation
+    long long merge_us;
+    bool model_match;   // first run of the kernel against sort_model(), when checked
+};
+
+class ExternalSorter {
+public:
+    // Runs sorted by sort_kernel in chunks of half the p2p bo, which must stay mapped
+    ExternalSorter(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map);
+
+    // Runs sorted on the host by sort_model() in chunks of `chunk` bytes
+    explicit ExternalSorter(size_t chunk);
+
+    /**
+     * Sort `size` bytes of `input` (the whole file when 0) by the `key` column into `output`,
+     * the runs are kept in <output>.runs. With check_model the first run sorted by the kernel
+     * is compared with sort_model().
+     */
+    SortStats sort(const std::string& input, const std::string& output, const Schema& schema, const std::string& key,
+                   size_t size = 0, bool check_model = false);
+
+private:
+    size_t form_runs(int in_fd, int runs_fd, size_t size, size_t chunk, const Schema& schema, const Column& key,
+                     bool check_model, bool& model_match);
+
+    bool mModel;
+    size_t mChunk;
+    xrt::device mDevice;
+    xrt::kernel mKernel;
+    xrt::bo mBo;
+    char *mMap;
+    xrt::bo mScratchBo; // sized for the smallest records sorted so far
+    size_t mScratchBytes;
+};
+
+#endif /* EXTSORT_H_ */
@@ -0,0 +1,39 @@
+/**
+ * @brief Key normalization and sort pairs shared by sort_kernel and its software model.
+ *
+ * Records are sorted by one int32, int64 or float64 column (FilterType). The column is
+ * mapped to an unsigned 64-bit key with the same order, and the sort moves (key, index)
+ * pairs, ties being broken by the index so the sort is stable.
+ */
+#ifndef SORT_NETWORK_H_
+#define SORT_NETWORK_H_
+
+#include "filter.h"
+
+#include <stdint.h>
+
+// Pairs sorted by the bitonic network at once, the runs it makes are then merged
+#define SORT_NETWORK 1024
+
+struct SortPair {
+    uint64_t key;
+    uint32_t index; // record in the chunk
+    uint32_t reserved;
+};
+
+// Unsigned key with the order of the little-endian column value
+static inline uint64_t sort_key(const unsigned char *field, uint32_t type) {
+    uint64_t v = 0;
+    uint32_t bytes = type == FILTER_INT32 ? 4 : 8;
+    for (uint32_t i = 0; i < bytes; i++) v |= (uint64_t)field[i] << (8 * i);
+    if (type == FILTER_INT32) return v ^ 0x80000000ull;
+    if (type == FILTER_INT64) return v ^ 0x8000000000000000ull;
+    // Doubles : flip all the bits of negatives, only the sign of positives
+    return (v >> 63) ? ~v : v ^ 0x8000000000000000ull;
+}
+
+static inline int sort_pair_less(const struct SortPair *a, const struct SortPair *b) {
+    return a->key < b->key || (a->key == b->key && a->index < b->index);
+}
+
+#endif /* SORT_NETWORK_H_ */
@@ -0,0 +1,102 @@
+#include "filelayout.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+int preallocate(int fd, size_t size) {
+    if (fallocate(fd, 0, 0, size) != 0) return -errno;
+    return 0;
+}
+
+std::vector<FileExtent> file_extents(int fd, size_t size) {
+    std::vector<FileExtent> extents;
+
+    // First call only counts the extents
+    struct fiemap probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.fm_start = 0;
+    probe.fm_length = size;
+    probe.fm_flags = FIEMAP_FLAG_SYNC;
+    probe.fm_extent_count = 0;
+    if (ioctl(fd, FS_IOC_FIEMAP, &probe) != 0) {
+        std::cerr << "ERR: FIEMAP failed: " << strerror(errno) << std::endl;
+        return extents;
+    }
+
+    size_t count = probe.fm_mapped_extents;
+    size_t bytes = sizeof(struct fiemap) + count * sizeof(struct fiemap_extent);
+    struct fiemap* map = (struct fiemap*)calloc(1, bytes);
+    map->fm_start = 0;
+    map->fm_length = size;
+    map->fm_flags = FIEMAP_FLAG_SYNC;
+    map->fm_extent_count = count;
+    if (ioctl(fd, FS_IOC_FIEMAP, map) != 0) {
+        std::cerr << "ERR: FIEMAP failed: " << strerror(errno) << std::endl;
+        free(map);
+        return extents;
+    }
+
+    for (size_t i = 0; i < map->fm_mapped_extents; i++) {
+        const struct fiemap_extent& e = map->fm_extents[i];
+        extents.push_back({e.fe_logical, e.fe_physical, e.fe_length});
+    }
+    free(map);
+    return extents;
+}
+
+size_t count_fragments(const std::vector<FileExtent>& extents) {
+    if (extents.empty()) return 0;
+    size_t fragments = 1;
+    for (size_t i = 1; i < extents.size(); i++) {
+        const FileExtent& prev = extents[i - 1];
+        const FileExtent& cur = extents[i];
+        bool contiguous = prev.logical + prev.length == cur.logical && prev.physical + prev.length == cur.physical;
+        if (!contiguous) fragments++;
+    }
+    return fragments;
+}
+
+size_t create_contiguous(const std::string& path, size_t size, int max_attempts) {
+    std::vector<std::string> discarded;
+    size_t fragments = 0;
+
+    for (int attempt = 0; attempt < max_attempts; attempt++) {
+        (void)unlink(path.c_str());
+        int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            std::cerr << "ERR: open " << path << " failed: " << strerror(errno) << std::endl;
+            fragments = 0;
+            break;
+        }
+        int ret = preallocate(fd, size);
+        if (ret != 0) {
+            std::cerr << "ERR: fallocate failed: " << strerror(-ret) << std::endl;
+            (void)close(fd);
+            fragments = 0;
+            break;
+        }
+        std::vector<FileExtent> extents = file_extents(fd, size);
+        fragments = count_fragments(extents);
+        (void)close(fd);
+
+        std::cout << "Layout attempt " << attempt << " : " << extents.size() << " extents, "
+                  << fragments << " fragments\n";
+        if (fragments == 1 || attempt + 1 == max_attempts) break;
+
+        // Hold on to the fragmented blocks so the next attempt lands elsewhere
+        std::string aside = path + ".frag" + std::to_string(attempt);
+        if (rename(path.c_str(), aside.c_str()) == 0) discarded.push_back(aside);
+    }
+
+    for (const std::string& aside : discarded) (void)unlink(aside.c_str());
+    return fragments;
+}
@@ -0,0 +1,36 @@
+/**
+ * @brief Helpers to control the on-disk layout of the benchmark target file :
+ *        preallocation with fallocate and extent inspection with FIEMAP.
+ */
+#ifndef FILELAYOUT_H_
+#define FILELAYOUT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct FileExtent {
+    uint64_t logical;
+    uint64_t physical;
+    uint64_t length;
+};
+
+// Allocate `size` bytes of blocks for fd, returns 0 or -errno
+int preallocate(int fd, size_t size);
+
+// Extents of the first `size` bytes of fd as reported by FIEMAP, empty on error
+std::vector<FileExtent> file_extents(int fd, size_t size);
+
+// Number of physically discontiguous runs, ext4 splits contiguous space in 128 MiB extents
+size_t count_fragments(const std::vector<FileExtent>& extents);
+
+/**
+ * (Re)create `path` with `size` preallocated bytes until it is a single physically
+ * contiguous run or `max_attempts` is reached. Failed attempts are kept aside while
+ * retrying so the allocator cannot hand back the same blocks, then removed.
+ * Returns the number of fragments of the final file, 0 on error.
+ */
+size_t create_contiguous(const std::string& path, size_t size, int max_attempts);
+
+#endif /* FILELAYOUT_H_ */
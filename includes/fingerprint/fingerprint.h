@@ -0,0 +1,41 @@
+/**
+ * @brief Per-block fingerprints for deduplication : reference SHA-256 (FIPS 180-4) to
+ *        check the fingerprint kernel, and the host side dedup index.
+ */
+#ifndef FINGERPRINT_H_
+#define FINGERPRINT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#define SHA256_DIGEST_SIZE 32
+
+void sha256(const uint8_t *data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+// Index of the fingerprints seen so far, keyed by digest with the first block that had it
+class DedupIndex {
+public:
+    DedupIndex() : mBlocks(0) {}
+
+    // Returns true when the block is a duplicate of an earlier one
+    bool add(const uint8_t digest[SHA256_DIGEST_SIZE], uint64_t block);
+
+    uint64_t blocks() const { return mBlocks; }
+    uint64_t unique() const { return mIndex.size(); }
+
+    // Fraction of the blocks that are duplicates
+    double duplicate_ratio() const { return mBlocks ? (double)(mBlocks - unique()) / mBlocks : 0; }
+
+    void clear() {
+        mIndex.clear();
+        mBlocks = 0;
+    }
+
+private:
+    std::unordered_map<std::string, uint64_t> mIndex;
+    uint64_t mBlocks;
+};
+
+#endif /* FINGERPRINT_H_ */
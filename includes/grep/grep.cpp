@@ -0,0 +1,293 @@
+#include "grep.h"
+#include "scan.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Chunk streamed through the p2p bo per kernel run, plus GREP_OVERLAP to finish its last line
+static const size_t GREP_CHUNK = 256 << 20;
+static const size_t GREP_ALIGN = 4096;
+
+static void set_class(uint64_t set[4], unsigned char c) {
+    set[c / 64] |= 1ull << (c % 64);
+}
+
+static void set_escape(uint64_t set[4], char e) {
+    for (int c = 0; c < 256; c++) {
+        bool in = (e == 'd' && isdigit(c)) || (e == 'w' && (isalnum(c) || c == '_')) || (e == 's' && isspace(c) && c != '\n');
+        if (in) set_class(set, c);
+    }
+    if (e == 't') set_class(set, '\t');
+    if (e != 'd' && e != 'w' && e != 's' && e != 't') set_class(set, e);
+}
+
+int grep_compile(const std::string& pattern, GrepProgram& program, bool literal) {
+    memset(&program, 0, sizeof(program));
+    size_t begin = 0, end = pattern.size();
+    if (!literal && end > 0 && pattern[0] == '^') {
+        program.flags |= GREP_ANCHOR_START;
+        begin = 1;
+    }
+    if (!literal && end > begin && pattern[end - 1] == '$') {
+        // Not anchored when the $ is escaped
+        size_t slashes = 0;
+        while (end - 1 - slashes > begin && pattern[end - 2 - slashes] == '\\') slashes++;
+        if (slashes % 2 == 0) {
+            program.flags |= GREP_ANCHOR_END;
+            end--;
+        }
+    }
+
+    size_t i = begin;
+    uint32_t n = 0;
+    while (i < end) {
+        if (n == GREP_MAX_POSITIONS) return -EINVAL;
+        uint64_t set[4] = {0, 0, 0, 0};
+        char c = pattern[i++];
+        if (literal) {
+            set_class(set, c);
+        } else if (c == '.') {
+            for (int b = 0; b < 256; b++) set_class(set, b);
+        } else if (c == '\\') {
+            if (i == end) return -EINVAL;
+            set_escape(set, pattern[i++]);
+        } else if (c == '[') {
+            bool negate = i < end && pattern[i] == '^';
+            if (negate) i++;
+            bool first = true;
+            while (i < end && (pattern[i] != ']' || first)) {
+                first = false;
+                unsigned char lo = pattern[i++];
+                if (lo == '\\' && i < end) {
+                    set_escape(set, pattern[i++]);
+                    continue;
+                }
+                unsigned char hi = lo;
+                if (i + 1 < end && pattern[i] == '-' && pattern[i + 1] != ']') {
+                    hi = pattern[i + 1];
+                    i += 2;
+                }
+                if (hi < lo) return -EINVAL;
+                for (int b = lo; b <= hi; b++) set_class(set, b);
+            }
+            if (i == end) return -EINVAL;
+            i++;
+            if (negate) {
+                for (int w = 0; w < 4; w++) set[w] = ~set[w];
+            }
+        } else if (strchr("()|{}?*+", c)) {
+            return -EINVAL;
+        } else {
+            set_class(set, c);
+        }
+
+        uint64_t bit = 1ull << n;
+        for (int b = 0; b < 256; b++) {
+            if (b != '\n' && (set[b / 64] & (1ull << (b % 64)))) program.masks[b] |= bit;
+        }
+        if (!literal && i < end && strchr("?*+", pattern[i])) {
+            char q = pattern[i++];
+            if (q != '+') program.optional |= bit;
+            if (q != '?') program.repeat |= bit;
+        }
+        n++;
+    }
+    if (n == 0 || (program.optional | ((n < 64 ? 1ull << n : 0) - 1)) == program.optional) return -EINVAL;
+
+    program.positions = n;
+    program.accept = 1ull << (n - 1);
+    uint32_t run = 0;
+    bool leading = true;
+    for (uint32_t a = 0; a < n; a++) {
+        if (leading) program.initial |= 1ull << a;
+        bool optional = program.optional & (1ull << a);
+        leading = leading && optional;
+        run = optional ? run + 1 : 0;
+        program.closure = std::max(program.closure, run);
+    }
+    return 0;
+}
+
+std::string grep_required_literal(const GrepProgram& program) {
+    std::string best, run;
+    for (uint32_t a = 0; a < program.positions; a++) {
+        uint64_t bit = 1ull << a;
+        int byte = -1, count = 0;
+        for (int b = 0; b < 256; b++) {
+            if (program.masks[b] & bit) {
+                byte = b;
+                count++;
+            }
+        }
+        if (count != 1 || (program.optional & bit)) {
+            run.clear();
+            continue;
+        }
+        run += (char)byte;
+        if (run.size() > best.size()) best = run;
+        // x+ ends the run, its last repetition starts the next one
+        if (program.repeat & bit) run = std::string(1, (char)byte);
+    }
+    return best;
+}
+
+void grep_scalar(const GrepProgram& program, const char *data, size_t size, size_t limit, bool skip_partial,
+                 uint64_t base, std::vector<uint64_t>& lines) {
+    size_t i = 0;
+    if (skip_partial) {
+        const char *nl = (const char*)memchr(data, '\n', size);
+        if (!nl) return;
+        i = nl - data + 1;
+    }
+    bool anchor_end = program.flags & GREP_ANCHOR_END;
+    size_t line_start = i;
+    bool reported = false;
+    uint64_t state = 0;
+    for (; i < size && line_start <= limit; i++) {
+        unsigned char c = data[i];
+        if (c == '\n') {
+            if (anchor_end && (state & program.accept) && !reported) lines.push_back(base + line_start);
+            state = 0;
+            line_start = i + 1;
+            reported = false;
+            continue;
+        }
+        state = grep_step(&program, state, c, i == line_start);
+        if (!anchor_end && (state & program.accept) && !reported) {
+            lines.push_back(base + line_start);
+            reported = true;
+        }
+    }
+    if (i == size && line_start < size && line_start <= limit && anchor_end && (state & program.accept) && !reported) {
+        lines.push_back(base + line_start);
+    }
+}
+
+#if defined(__x86_64__)
+// First occurrence of lit in [p, end), comparing its first and last bytes 32 positions at a time
+__attribute__((target("avx2")))
+static const char *find_literal_avx2(const char *p, const char *end, const std::string& lit) {
+    size_t n = lit.size();
+    const __m256i first = _mm256_set1_epi8(lit[0]);
+    const __m256i last = _mm256_set1_epi8(lit[n - 1]);
+    for (; p + n - 1 + 32 <= end; p += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)p);
+        __m256i b = _mm256_loadu_si256((const __m256i*)(p + n - 1));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (n <= 2 || memcmp(p + bit + 1, lit.data() + 1, n - 2) == 0) return p + bit;
+            mask &= mask - 1;
+        }
+    }
+    for (; p + n <= end; p++) {
+        if (memcmp(p, lit.data(), n) == 0) return p;
+    }
+    return end;
+}
+#endif
+
+bool grep_has_avx2() {
+#if defined(__x86_64__)
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+void grep_avx2(const GrepProgram& program, const char *data, size_t size, size_t limit, bool skip_partial,
+               uint64_t base, std::vector<uint64_t>& lines) {
+    std::string lit = grep_required_literal(program);
+    if (lit.empty() || !grep_has_avx2()) {
+        grep_scalar(program, data, size, limit, skip_partial, base, lines);
+        return;
+    }
+#if defined(__x86_64__)
+    const char *end = data + size;
+    const char *p = data;
+    if (skip_partial) {
+        p = (const char*)memchr(data, '\n', size);
+        if (!p) return;
+        p++;
+    }
+    const char *first_line = p;
+    while (p < end) {
+        const char *hit = find_literal_avx2(p, end, lit);
+        if (hit == end) break;
+        // Match the whole line holding the literal with the automaton
+        const char *line = hit;
+        while (line > first_line && line[-1] != '\n') line--;
+        if ((size_t)(line - data) > limit) break;
+        const char *nl = (const char*)memchr(hit, '\n', end - hit);
+        const char *line_end = nl ? nl + 1 : end;
+        grep_scalar(program, line, line_end - line, 0, false, base + (line - data), lines);
+        p = line_end;
+    }
+#endif
+}
+
+Grepper::Grepper(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map, size_t max_offsets)
+    : mKernel(device, uuid, "grep_kernel"), mBo(p2p_bo), mMap((char*)p2p_map), mMaxOffsets(max_offsets) {
+    mOffsetsBo = xrt::bo(device, max_offsets * sizeof(uint32_t), mKernel.group_id(1));
+    mCountBo = xrt::bo(device, sizeof(uint32_t), mKernel.group_id(2));
+    mProgramBo = xrt::bo(device, sizeof(GrepProgram), mKernel.group_id(3));
+}
+
+GrepResult Grepper::search(const std::string& file, const GrepProgram& program, size_t size) {
+    GrepResult result = GrepResult();
+    size_t chunk = std::min(GREP_CHUNK, mBo.size() - GREP_OVERLAP) / GREP_ALIGN * GREP_ALIGN;
+    ChunkReader input(file, chunk, size, GREP_ALIGN);
+    size = input.size();
+
+    memcpy(mProgramBo.map<GrepProgram*>(), &program, sizeof(program));
+    mProgramBo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+    uint32_t *count = mCountBo.map<uint32_t*>();
+    const uint32_t *offsets = mOffsetsBo.map<uint32_t*>();
+    bool truncated = false;
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t avail = std::min(chunk + GREP_OVERLAP, size - offset);
+        input.read(mMap, offset, avail);
+        auto run = mKernel(mBo, mOffsetsBo, mCountBo, mProgramBo, (unsigned int)avail,
+                           (unsigned int)std::min(chunk, size - offset), (unsigned int)(offset > 0), (unsigned int)mMaxOffsets);
+        run.wait();
+        mCountBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+
+        size_t stored = std::min((size_t)*count, mMaxOffsets);
+        truncated |= stored < *count;
+        if (stored > 0) mOffsetsBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, stored * sizeof(uint32_t), 0);
+        for (size_t m = 0; m < stored; m++) result.lines.push_back(offset + offsets[m]);
+        result.matches += *count;
+        result.bytes_to_host += sizeof(uint32_t) + stored * sizeof(uint32_t);
+        result.bytes_scanned += std::min(chunk, size - offset);
+    }
+    if (truncated) std::cerr << "WARNING: more than " << mMaxOffsets << " matching lines in a chunk, offsets truncated\n";
+    return result;
+}
+
+GrepResult grep_host(const std::string& file, const GrepProgram& program, bool avx2, size_t size) {
+    GrepResult result = GrepResult();
+    size_t chunk = GREP_CHUNK;
+    ChunkReader input(file, chunk, size, GREP_ALIGN);
+    size = input.size();
+
+    char *buf = (char*)aligned_alloc(GREP_ALIGN, chunk + GREP_OVERLAP);
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t avail = std::min(chunk + GREP_OVERLAP, size - offset);
+        input.read(buf, offset, avail);
+        size_t limit = std::min(chunk, size - offset);
+        if (avx2) grep_avx2(program, buf, avail, limit, offset > 0, offset, result.lines);
+        else grep_scalar(program, buf, avail, limit, offset > 0, offset, result.lines);
+        result.bytes_scanned += limit;
+        result.bytes_to_host += avail;
+    }
+    result.matches = result.lines.size();
+    free(buf);
+    return result;
+}
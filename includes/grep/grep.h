@@ -0,0 +1,76 @@
+/**
+ * @brief Line search with literals and simple regular expressions, near the drive with
+ *        grep_kernel or on the host, with an AVX2 prefilter when the CPU has it.
+ *
+ * A pattern is compiled to a GrepProgram for bit-parallel (extended Shift-And) matching
+ * of up to GREP_MAX_POSITIONS atoms. Supported syntax : literal characters, `.`, classes
+ * `[a-z_]` and `[^...]`, escapes `\d \w \s \t` and `\` before a special character, the
+ * postfix `?`, `*` and `+` on one atom, `^` at the start and `$` at the end. Matches do
+ * not span lines and a search reports the offset of each matching line.
+ */
+#ifndef GREP_H_
+#define GREP_H_
+
+#include "grep_program.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "experimental/xrt_bo.h"
+#include "experimental/xrt_device.h"
+#include "experimental/xrt_kernel.h"
+
+// Returns 0 or -EINVAL on an unsupported or empty pattern, `literal` takes every character as is
+int grep_compile(const std::string& pattern, GrepProgram& program, bool literal = false);
+
+// Longest string every match contains, empty when there is none
+std::string grep_required_literal(const GrepProgram& program);
+
+/**
+ * Search `size` bytes of data, appending base + offset of the matching lines that start at
+ * or before `limit`. With skip_partial the bytes up to the first newline belong to a line
+ * of the previous buffer and are ignored. This is the reference of grep_kernel.
+ */
+void grep_scalar(const GrepProgram& program, const char *data, size_t size, size_t limit, bool skip_partial,
+                 uint64_t base, std::vector<uint64_t>& lines);
+
+// Same results, only the lines holding grep_required_literal(), found with AVX2, are matched
+void grep_avx2(const GrepProgram& program, const char *data, size_t size, size_t limit, bool skip_partial,
+               uint64_t base, std::vector<uint64_t>& lines);
+
+// Whether grep_avx2 runs with AVX2, it falls back on grep_scalar otherwise
+bool grep_has_avx2();
+
+struct GrepResult {
+    uint64_t matches;        // lines
+    uint64_t bytes_scanned;
+    uint64_t bytes_to_host;
+    std::vector<uint64_t> lines; // file offsets of the matching lines, at most max_offsets per chunk from the kernel
+};
+
+// Lines longer than this are cut at the chunk boundaries
+static const size_t GREP_OVERLAP = 64 << 10;
+
+class Grepper {
+public:
+    // Searches in chunks of the p2p bo, which must stay mapped for the life of the grepper
+    Grepper(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map, size_t max_offsets = 1 << 20);
+
+    // grep_kernel over `size` bytes of `file` (the whole file when 0) read with P2P preads
+    GrepResult search(const std::string& file, const GrepProgram& program, size_t size = 0);
+
+private:
+    xrt::kernel mKernel;
+    xrt::bo mBo;
+    char *mMap;
+    size_t mMaxOffsets;
+    xrt::bo mOffsetsBo;
+    xrt::bo mCountBo;
+    xrt::bo mProgramBo;
+};
+
+// Host search of the same chunks, read with O_DIRECT into host memory
+GrepResult grep_host(const std::string& file, const GrepProgram& program, bool avx2, size_t size = 0);
+
+#endif /* GREP_H_ */
@@ -0,0 +1,40 @@
+/**
+ * @brief Compiled search pattern shared by the host search and grep_kernel.
+ *
+ * Bit-parallel (extended Shift-And) matching of up to GREP_MAX_POSITIONS atoms : each
+ * atom is a set of bytes that may be skipped (optional) and may match more than once
+ * (repeat). grep_compile() in grep.h builds the program from a pattern.
+ */
+#ifndef GREP_PROGRAM_H_
+#define GREP_PROGRAM_H_
+
+#include <stdint.h>
+
+#define GREP_MAX_POSITIONS 64
+#define GREP_ANCHOR_START 1
+#define GREP_ANCHOR_END 2
+
+// Bit i of a mask stands for atom i of the pattern
+struct GrepProgram {
+    uint64_t masks[256]; // atoms each byte matches
+    uint64_t repeat;     // atoms that can match again, x* and x+
+    uint64_t optional;   // atoms that can be skipped, x? and x*
+    uint64_t initial;    // atoms a match can start at
+    uint64_t accept;     // atoms a match can end at
+    uint32_t positions;
+    uint32_t closure;    // longest run of optional atoms
+    uint32_t flags;      // GREP_ANCHOR_*
+    uint32_t reserved;
+};
+
+// State after byte c, bit i set when atoms 0 to i match the text up to c
+static inline uint64_t grep_step(const GrepProgram *program, uint64_t state, unsigned char c, int at_line_start) {
+    uint64_t start = (program->flags & GREP_ANCHOR_START) && !at_line_start ? 0 : program->initial;
+    uint64_t mask = program->masks[c];
+    uint64_t next = (((state << 1) | start) & mask) | (state & program->repeat & mask);
+    // Skip the optional atoms after the matched ones
+    for (uint32_t i = 0; i < program->closure && i < GREP_MAX_POSITIONS; i++) next |= (next << 1) & program->optional;
+    return next;
+}
+
+#endif /* GREP_PROGRAM_H_ */
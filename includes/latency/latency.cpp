@@ -0,0 +1,45 @@
+#include "latency.h"
+
+#include <algorithm>
+#include <cmath>
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    // Smallest sample with at least p of the samples at or below it, rank ceil(p * n),
+    // without the rounding error of p * n pushing an exact rank to the next one
+    double rank = std::ceil(p * sorted.size() - 1e-9);
+    size_t index = rank < 1 ? 0 : std::min(sorted.size() - 1, (size_t)rank - 1);
+    return sorted[index];
+}
+
+void LatencySamples::sort() {
+    if (!mSorted) std::sort(mSamples.begin(), mSamples.end());
+    mSorted = true;
+}
+
+double LatencySamples::percentile(double p) {
+    sort();
+    return ::percentile(mSamples, p);
+}
+
+double LatencySamples::min() {
+    sort();
+    return mSamples.empty() ? 0 : mSamples.front();
+}
+
+double LatencySamples::max() {
+    sort();
+    return mSamples.empty() ? 0 : mSamples.back();
+}
+
+double LatencySamples::mean() const {
+    if (mSamples.empty()) return 0;
+    double sum = 0;
+    for (double us : mSamples) sum += us;
+    return sum / mSamples.size();
+}
+
+void LatencySamples::print(std::ostream& out) {
+    out << "n=" << count() << " min " << min() << " p50 " << percentile(0.5) << " p90 " << percentile(0.9)
+        << " p99 " << percentile(0.99) << " p99.9 " << percentile(0.999) << " max " << max() << " mean " << mean() << " us";
+}
@@ -0,0 +1,39 @@
+/**
+ * @brief Latency samples of repeated operations, summarized by percentiles.
+ *
+ * Percentiles are nearest-rank over the sorted samples, no interpolation, so every
+ * reported value is one that was measured.
+ */
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Percentile `p` (0 to 1) of sorted samples, 0 when empty
+double percentile(const std::vector<double>& sorted, double p);
+
+class LatencySamples {
+public:
+    void reserve(size_t count) { mSamples.reserve(count); }
+    void add(double us) { mSamples.push_back(us); mSorted = false; }
+    void clear() { mSamples.clear(); }
+    size_t count() const { return mSamples.size(); }
+
+    double percentile(double p);
+    double min();
+    double max();
+    double mean() const;
+
+    // "n=.. min .. p50 .. p90 .. p99 .. p99.9 .. max .. mean .. us"
+    void print(std::ostream& out);
+
+private:
+    void sort();
+
+    std::vector<double> mSamples;
+    bool mSorted = false;
+};
+
+#endif /* LATENCY_H_ */
@@ -0,0 +1,200 @@
+#include "lz4block.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Length continuation bytes of the LZ4 format
+static uint32_t write_length(uint8_t *op, uint32_t length) {
+    uint32_t n = 0;
+    for (; length >= 255; length -= 255) op[n++] = 255;
+    op[n++] = length;
+    return n;
+}
+
+uint32_t lz4b_compress_block(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t limit) {
+    // Last position + 1 of each hashed 4-byte sequence, 0 when empty
+    uint32_t table[1 << LZ4B_HASH_LOG];
+    memset(table, 0, sizeof(table));
+
+    uint32_t ip = 0, anchor = 0, op = 0;
+    if (len > LZ4B_MF_LIMIT) {
+        while (ip < len - LZ4B_MF_LIMIT) {
+            uint32_t seq = read32(src + ip);
+            uint32_t h = (seq * 2654435761u) >> (32 - LZ4B_HASH_LOG);
+            uint32_t ref = table[h];
+            table[h] = ip + 1;
+            if (ref == 0 || ip + 1 - ref > LZ4B_MAX_OFFSET || read32(src + ref - 1) != seq) {
+                ip++;
+                continue;
+            }
+            ref--;
+
+            uint32_t match = LZ4B_MIN_MATCH;
+            while (ip + match < len - LZ4B_LAST_LITERALS && src[ref + match] == src[ip + match]) match++;
+
+            uint32_t literals = ip - anchor;
+            if (op + 1 + literals / 255 + 1 + literals + 2 + match / 255 + 1 > limit) return 0;
+
+            uint32_t token = op++;
+            uint32_t lit_code = std::min(literals, 15u);
+            uint32_t match_code = std::min(match - LZ4B_MIN_MATCH, 15u);
+            dst[token] = (lit_code << 4) | match_code;
+            if (lit_code == 15) op += write_length(dst + op, literals - 15);
+            memcpy(dst + op, src + anchor, literals);
+            op += literals;
+            dst[op++] = (ip - ref) & 0xFF;
+            dst[op++] = (ip - ref) >> 8;
+            if (match_code == 15) op += write_length(dst + op, match - LZ4B_MIN_MATCH - 15);
+
+            ip += match;
+            anchor = ip;
+        }
+    }
+
+    uint32_t literals = len - anchor;
+    if (op + 1 + literals / 255 + 1 + literals > limit) return 0;
+    uint32_t lit_code = std::min(literals, 15u);
+    dst[op++] = lit_code << 4;
+    if (lit_code == 15) op += write_length(dst + op, literals - 15);
+    memcpy(dst + op, src + anchor, literals);
+    return op + literals;
+}
+
+size_t lz4b_compress(const uint8_t *in, size_t size, uint32_t block_size, uint8_t *out, Lz4bIndexEntry *index) {
+    size_t offset = 0;
+    for (size_t start = 0, b = 0; start < size; start += block_size, b++) {
+        uint32_t len = std::min((size_t)block_size, size - start);
+        // Only keep the compressed block when it is actually smaller
+        uint32_t csize = lz4b_compress_block(in + start, len, out + offset, len - 1);
+        if (csize == 0) {
+            memcpy(out + offset, in + start, len);
+            csize = len | LZ4B_RAW_FLAG;
+        }
+        index[b].offset = offset;
+        index[b].size = csize;
+        index[b].raw_size = len;
+        offset += lz4b_align(csize & ~LZ4B_RAW_FLAG);
+    }
+    return offset;
+}
+
+int lz4b_decompress_block(const uint8_t *src, uint32_t size, uint8_t *dst, uint32_t raw_size) {
+    if (size & LZ4B_RAW_FLAG) {
+        if ((size & ~LZ4B_RAW_FLAG) != raw_size) return -1;
+        memcpy(dst, src, raw_size);
+        return 0;
+    }
+
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + size;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + raw_size;
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > (size_t)(iend - ip) || literals > (size_t)(oend - op)) return -1;
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        // The last sequence only has literals
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return -1;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return -1;
+
+        size_t match = token & 15;
+        if (match == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                match += b;
+            } while (b == 255);
+        }
+        match += LZ4B_MIN_MATCH;
+        if (match > (size_t)(oend - op)) return -1;
+
+        // Byte by byte, the match may overlap the output
+        const uint8_t *ref = op - offset;
+        for (size_t i = 0; i < match; i++) op[i] = ref[i];
+        op += match;
+    }
+    return op == oend ? 0 : -1;
+}
+
+int lz4b_decompress(const uint8_t *data, const Lz4bIndexEntry *index, uint32_t count, uint32_t block_size, uint8_t *out) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (lz4b_decompress_block(data + index[i].offset, index[i].size, out + (size_t)i * block_size, index[i].raw_size) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int lz4b_write_metadata(int fd, const Lz4bIndexEntry *index, uint32_t count, uint32_t block_size, uint64_t raw_size, uint64_t data_size) {
+    Lz4bHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = LZ4B_MAGIC;
+    header.block_size = block_size;
+    header.block_count = count;
+    header.raw_size = raw_size;
+    header.data_offset = LZ4B_ALIGN;
+    header.data_size = data_size;
+    header.index_offset = LZ4B_ALIGN + lz4b_align(data_size);
+
+    // O_DIRECT needs aligned buffers and lengths
+    size_t index_bytes = lz4b_align(count * sizeof(Lz4bIndexEntry));
+    char *buf = (char*)aligned_alloc(LZ4B_ALIGN, LZ4B_ALIGN + index_bytes);
+    if (!buf) return -ENOMEM;
+    memset(buf, 0, LZ4B_ALIGN + index_bytes);
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + LZ4B_ALIGN, index, count * sizeof(Lz4bIndexEntry));
+
+    int ret = 0;
+    if (pwrite(fd, buf + LZ4B_ALIGN, index_bytes, header.index_offset) != (ssize_t)index_bytes) ret = -errno;
+    if (ret == 0 && pwrite(fd, buf, LZ4B_ALIGN, 0) != LZ4B_ALIGN) ret = -errno;
+    free(buf);
+    return ret;
+}
+
+int lz4b_read_metadata(int fd, Lz4bHeader& header, std::vector<Lz4bIndexEntry>& index) {
+    char *buf = (char*)aligned_alloc(LZ4B_ALIGN, LZ4B_ALIGN);
+    if (!buf) return -ENOMEM;
+    int ret = 0;
+    if (pread(fd, buf, LZ4B_ALIGN, 0) != LZ4B_ALIGN) ret = -errno;
+    memcpy(&header, buf, sizeof(header));
+    free(buf);
+    if (ret != 0) return ret;
+    if (header.magic != LZ4B_MAGIC || header.block_size == 0) return -EINVAL;
+
+    size_t index_bytes = lz4b_align(header.block_count * sizeof(Lz4bIndexEntry));
+    buf = (char*)aligned_alloc(LZ4B_ALIGN, index_bytes);
+    if (!buf) return -ENOMEM;
+    if (pread(fd, buf, index_bytes, header.index_offset) != (ssize_t)index_bytes) ret = -errno;
+    const Lz4bIndexEntry *entries = (const Lz4bIndexEntry*)buf;
+    index.assign(entries, entries + header.block_count);
+    free(buf);
+    return ret;
+}
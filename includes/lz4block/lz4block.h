@@ -0,0 +1,91 @@
+/**
+ * @brief Block compressed on-disk format written by the near-storage compression
+ *        kernel, with the host side (CPU) codec.
+ *
+ * The input is cut in fixed size blocks, each compressed independently in the LZ4
+ * block format, so any block can be decoded on its own. On the SSD :
+ *
+ *   [0, 4 KiB)                    Lz4bHeader
+ *   [data_offset, +data_size)     compressed blocks, each one starting 4 KiB aligned
+ *                                 so it can be read back with a P2P pread
+ *   [index_offset, +block_count)  Lz4bIndexEntry per block, padded to 4 KiB
+ *
+ * A block that does not shrink is stored as is with LZ4B_RAW_FLAG set in its size.
+ * The format definitions are plain C so they can be included by the kernels, the host
+ * codec is hidden from HLS synthesis.
+ */
+#ifndef LZ4BLOCK_H_
+#define LZ4BLOCK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZ4B_MAGIC 0x42345A4C // "LZ4B"
+#define LZ4B_ALIGN 4096
+#define LZ4B_RAW_FLAG 0x80000000u
+
+// LZ4 block format constants
+#define LZ4B_MIN_MATCH 4
+#define LZ4B_LAST_LITERALS 5
+#define LZ4B_MF_LIMIT 12
+#define LZ4B_MAX_OFFSET 65535
+#define LZ4B_HASH_LOG 12
+
+struct Lz4bIndexEntry {
+    uint32_t offset;   // from data_offset, multiple of LZ4B_ALIGN
+    uint32_t size;     // compressed size, | LZ4B_RAW_FLAG when stored uncompressed
+    uint32_t raw_size; // decompressed size
+};
+
+struct Lz4bHeader {
+    uint32_t magic;
+    uint32_t block_size;
+    uint32_t block_count;
+    uint32_t reserved;
+    uint64_t raw_size;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t index_offset;
+};
+
+#if defined(__cplusplus) && !defined(__SYNTHESIS__)
+#include <vector>
+
+inline size_t lz4b_align(size_t size) { return (size + LZ4B_ALIGN - 1) / LZ4B_ALIGN * LZ4B_ALIGN; }
+
+// Worst case size of the packed data region of `raw_size` bytes cut in `block_size` blocks
+inline size_t lz4b_data_bound(size_t raw_size, size_t block_size) {
+    return (raw_size + block_size - 1) / block_size * lz4b_align(block_size);
+}
+
+/**
+ * Compress one block of `len` bytes into `dst`, the same greedy pass as lz4_compress_kernel
+ * so both give the same bytes. Returns the compressed size, or 0 when it does not fit in
+ * `limit` bytes and the block must be stored raw.
+ */
+uint32_t lz4b_compress_block(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t limit);
+
+/**
+ * Host equivalent of lz4_compress_kernel : `size` bytes cut in `block_size` blocks packed
+ * into `out` (lz4b_data_bound bytes), each at LZ4B_ALIGN with its entry in `index`. The
+ * padding between blocks is left as it is. Returns the size of the data region.
+ */
+size_t lz4b_compress(const uint8_t *in, size_t size, uint32_t block_size, uint8_t *out, Lz4bIndexEntry *index);
+
+// Decode one block of `size` bytes (flags included) into `raw_size` bytes, returns 0 or -1
+int lz4b_decompress_block(const uint8_t *src, uint32_t size, uint8_t *dst, uint32_t raw_size);
+
+// Decode `count` blocks of the data region into out, block i landing at i * block_size
+int lz4b_decompress(const uint8_t *data, const Lz4bIndexEntry *index, uint32_t count, uint32_t block_size, uint8_t *out);
+
+/**
+ * Write the header at offset 0 and the index after the data region of an O_DIRECT fd.
+ * The data region itself is written by the caller at LZ4B_ALIGN. Returns 0 or -errno.
+ */
+int lz4b_write_metadata(int fd, const Lz4bIndexEntry *index, uint32_t count, uint32_t block_size, uint64_t raw_size, uint64_t data_size);
+
+// Read back the header and the index, returns 0 or -errno (-EINVAL on a bad header)
+int lz4b_read_metadata(int fd, Lz4bHeader& header, std::vector<Lz4bIndexEntry>& index);
+#endif
+
+#endif /* LZ4BLOCK_H_ */
@@ -0,0 +1,148 @@
+#include "microbench.h"
+
+#include <cstring>
+#include <string>
+
+XrtBackend::XrtBackend(xrt::device& device, const xrt::uuid& uuid, size_t bytes)
+    : mDevice(device), mUuid(uuid), mKernel(device, uuid, "dummy_kernel") {
+    mIn = xrt::bo(device, bytes, mKernel.group_id(0));
+    mOut = xrt::bo(device, bytes, mKernel.group_id(1));
+    mSync = xrt::bo(device, bytes, mKernel.group_id(0));
+    uint32_t *in_map = mIn.map<uint32_t*>();
+    for (size_t i = 0; i < bytes / sizeof(uint32_t); i++) in_map[i] = i * 2654435761u;
+    memset(mOut.map<char*>(), 0, bytes);
+    mIn.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    mOut.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    mRun = xrt::run(mKernel);
+    mRun.set_arg(0, mIn);
+    mRun.set_arg(1, mOut);
+}
+
+void XrtBackend::create_kernel() {
+    xrt::kernel krnl(mDevice, mUuid, "dummy_kernel");
+}
+
+void XrtBackend::create_run() {
+    xrt::run run(mKernel);
+}
+
+void XrtBackend::reuse_run(uint32_t words) {
+    mRun.set_arg(2, words);
+    mRun.start();
+    mRun.wait();
+}
+
+void XrtBackend::round_trip(uint32_t words) {
+    mKernel(mIn, mOut, words).wait();
+}
+
+void XrtBackend::sync(size_t bytes, bool to_device) {
+    mSync.sync(to_device ? XCL_BO_SYNC_BO_TO_DEVICE : XCL_BO_SYNC_BO_FROM_DEVICE, bytes, 0);
+}
+
+bool XrtBackend::verify(uint32_t words) {
+    size_t bytes = words * sizeof(uint32_t);
+    mOut.sync(XCL_BO_SYNC_BO_FROM_DEVICE, bytes, 0);
+    return memcmp(mOut.map<char*>(), mIn.map<char*>(), bytes) == 0;
+}
+
+// Kernels of the emulated xclbin, their arguments as integers like the registers of the kernel
+struct EmulatedBackend::Kernel {
+    const char *name;
+    size_t num_args;
+    void (*body)(const std::vector<uintptr_t>& args);
+};
+
+static void emulated_dummy_kernel(const std::vector<uintptr_t>& args) {
+    memcpy((uint32_t*)args[1], (const uint32_t*)args[0], args[2] * sizeof(uint32_t));
+}
+
+EmulatedBackend::EmulatedBackend(size_t bytes)
+    : mIn(bytes / sizeof(uint32_t)), mOut(bytes / sizeof(uint32_t)), mSyncHost(bytes), mSyncDevice(bytes),
+      mStop(false), mStarted(0), mCompleted(0) {
+    for (size_t i = 0; i < mIn.size(); i++) mIn[i] = i * 2654435761u;
+    mWorker = std::thread(&EmulatedBackend::serve, this);
+    mKernel = open_kernel("dummy_kernel");
+    mRun = {mKernel.get(), std::vector<uintptr_t>(mKernel->num_args), false};
+    mRun.args[0] = (uintptr_t)mIn.data();
+    mRun.args[1] = (uintptr_t)mOut.data();
+}
+
+EmulatedBackend::~EmulatedBackend() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCond.notify_all();
+    mWorker.join();
+}
+
+std::shared_ptr<EmulatedBackend::Kernel> EmulatedBackend::open_kernel(const char *name) {
+    static const Kernel kernels[] = {{"dummy_kernel", 3, emulated_dummy_kernel}};
+    for (const Kernel& kernel : kernels) {
+        if (strcmp(kernel.name, name) == 0) return std::make_shared<Kernel>(kernel);
+    }
+    return nullptr;
+}
+
+// The device : runs the started commands in order and marks them done
+void EmulatedBackend::serve() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+        mCond.wait(lock, [this] { return mStop || !mQueue.empty(); });
+        if (mQueue.empty()) return;
+        Run *run = mQueue.front();
+        mQueue.pop_front();
+        lock.unlock();
+        run->kernel->body(run->args);
+        lock.lock();
+        run->done = true;
+        mCompleted++;
+        mCond.notify_all();
+    }
+}
+
+void EmulatedBackend::start(Run& run) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        run.done = false;
+        mQueue.push_back(&run);
+        mStarted++;
+    }
+    mCond.notify_all();
+}
+
+void EmulatedBackend::wait(Run& run) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCond.wait(lock, [&run] { return run.done; });
+}
+
+void EmulatedBackend::create_kernel() {
+    std::shared_ptr<Kernel> kernel = open_kernel("dummy_kernel");
+}
+
+void EmulatedBackend::create_run() {
+    Run run = {mKernel.get(), std::vector<uintptr_t>(mKernel->num_args), false};
+}
+
+void EmulatedBackend::reuse_run(uint32_t words) {
+    mRun.args[2] = words;
+    start(mRun);
+    wait(mRun);
+}
+
+void EmulatedBackend::round_trip(uint32_t words) {
+    Run run = {mKernel.get(), {(uintptr_t)mIn.data(), (uintptr_t)mOut.data(), words}, false};
+    start(run);
+    wait(run);
+}
+
+void EmulatedBackend::sync(size_t bytes, bool to_device) {
+    if (to_device) memcpy(mSyncDevice.data(), mSyncHost.data(), bytes);
+    else memcpy(mSyncHost.data(), mSyncDevice.data(), bytes);
+}
+
+bool EmulatedBackend::verify(uint32_t words) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStarted == mCompleted && memcmp(mOut.data(), mIn.data(), words * sizeof(uint32_t)) == 0;
+}
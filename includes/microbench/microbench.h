@@ -0,0 +1,117 @@
+/**
+ * @brief Backends of the fixed cost microbenchmarks of the XRT path.
+ *
+ * Each operation is one call measured on its own : constructing an xrt::kernel, creating
+ * an xrt::run, set_arg then start/wait on a run kept between calls, a full launch of
+ * dummy_kernel with nothing to copy, and bo.sync of a few bytes. The emulated backend has
+ * the same operations on host objects, the runs executed by a worker thread standing in
+ * for the device, so the suite runs and checks itself without a card.
+ */
+#ifndef MICROBENCH_H_
+#define MICROBENCH_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "experimental/xrt_bo.h"
+#include "experimental/xrt_device.h"
+#include "experimental/xrt_kernel.h"
+
+class LaunchBackend {
+public:
+    virtual ~LaunchBackend() {}
+    virtual const char *name() const = 0;
+
+    // Construct then drop a handle of dummy_kernel
+    virtual void create_kernel() = 0;
+
+    // Create then drop a run of the kernel kept by the backend
+    virtual void create_run() = 0;
+
+    // set_arg of the word count on the kept run, start, wait : copies `words` words
+    virtual void reuse_run(uint32_t words) = 0;
+
+    // Launch with all the arguments and wait, a new run each time
+    virtual void round_trip(uint32_t words) = 0;
+
+    // bo.sync of the first `bytes` of the sync buffer
+    virtual void sync(size_t bytes, bool to_device) = 0;
+
+    // The output of the runs holds the first `words` words of the input
+    virtual bool verify(uint32_t words) = 0;
+};
+
+class XrtBackend : public LaunchBackend {
+public:
+    // Buffers of `bytes` for the copies and the syncs
+    XrtBackend(xrt::device& device, const xrt::uuid& uuid, size_t bytes);
+    const char *name() const { return "xrt"; }
+    void create_kernel();
+    void create_run();
+    void reuse_run(uint32_t words);
+    void round_trip(uint32_t words);
+    void sync(size_t bytes, bool to_device);
+    bool verify(uint32_t words);
+
+private:
+    xrt::device mDevice;
+    xrt::uuid mUuid;
+    xrt::kernel mKernel;
+    xrt::run mRun;
+    xrt::bo mIn;
+    xrt::bo mOut;
+    xrt::bo mSync;
+};
+
+class EmulatedBackend : public LaunchBackend {
+public:
+    explicit EmulatedBackend(size_t bytes);
+    ~EmulatedBackend();
+    const char *name() const { return "emulated"; }
+    void create_kernel();
+    void create_run();
+    void reuse_run(uint32_t words);
+    void round_trip(uint32_t words);
+    void sync(size_t bytes, bool to_device);
+    bool verify(uint32_t words);
+
+    // Runs started and completed by the worker, equal once all were waited for
+    uint64_t started() const { return mStarted; }
+    uint64_t completed() const { return mCompleted; }
+
+private:
+    struct Kernel;
+    struct Run {
+        const Kernel *kernel;
+        std::vector<uintptr_t> args;
+        bool done;
+    };
+
+    std::shared_ptr<Kernel> open_kernel(const char *name);
+    void start(Run& run);
+    void wait(Run& run);
+    void serve();
+
+    std::shared_ptr<Kernel> mKernel;
+    Run mRun;
+    std::vector<uint32_t> mIn;  // device memory
+    std::vector<uint32_t> mOut;
+    std::vector<char> mSyncHost;
+    std::vector<char> mSyncDevice;
+
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    std::deque<Run*> mQueue;
+    bool mStop;
+    uint64_t mStarted;
+    uint64_t mCompleted;
+    std::thread mWorker;
+};
+
+#endif /* MICROBENCH_H_ */
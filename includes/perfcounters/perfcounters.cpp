@@ -0,0 +1,136 @@
+#include "perfcounters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const char *EVENT_NAMES[PERF_EVENT_COUNT] = {"cycles", "instructions", "llc-misses", "page-faults", "ctx-switches"};
+
+static int perf_event_open(PerfEvent event, bool user_only) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_kernel = user_only;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (event) {
+    case PERF_CYCLES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CPU_CYCLES;
+        break;
+    case PERF_INSTRUCTIONS:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+        break;
+    case PERF_LLC_MISSES:
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        break;
+    case PERF_PAGE_FAULTS:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+        break;
+    case PERF_CONTEXT_SWITCHES:
+        attr.type = PERF_TYPE_SOFTWARE;
+        attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+        break;
+    default:
+        return -1;
+    }
+
+    // Calling thread, any CPU
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+PerfCounters::PerfCounters() : mEnabled(false), mUserOnly(false) {
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) mFds[i] = -1;
+}
+
+PerfCounters::~PerfCounters() {
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (mFds[i] >= 0) close(mFds[i]);
+    }
+}
+
+int PerfCounters::open() {
+    int available = 0;
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        PerfEvent event = (PerfEvent)i;
+        mFds[i] = perf_event_open(event, mUserOnly);
+        if (mFds[i] < 0 && (errno == EACCES || errno == EPERM) && !mUserOnly) {
+            // perf_event_paranoid forbids kernel counting, count user space only
+            mUserOnly = true;
+            for (int j = 0; j < i; j++) {
+                if (mFds[j] >= 0) close(mFds[j]);
+                mFds[j] = perf_event_open((PerfEvent)j, mUserOnly);
+            }
+            mFds[i] = perf_event_open(event, mUserOnly);
+        }
+        if (mFds[i] < 0) {
+            std::cout << "WARNING: perf counter " << EVENT_NAMES[i] << " unavailable: " << strerror(errno) << "\n";
+        }
+    }
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (mFds[i] >= 0) available++;
+    }
+    if (mUserOnly && available) std::cout << "WARNING: perf counters restricted to user space\n";
+    mEnabled = available > 0;
+    return available;
+}
+
+void PerfCounters::start() {
+    if (!mEnabled) return;
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (mFds[i] < 0) continue;
+        ioctl(mFds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(mFds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void PerfCounters::stop(const std::string& phase) {
+    if (!mEnabled) return;
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (mFds[i] >= 0) ioctl(mFds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+
+    auto it = mPhases.find(phase);
+    if (it == mPhases.end()) {
+        Phase empty;
+        memset(&empty, 0, sizeof(empty));
+        it = mPhases.insert(std::make_pair(phase, empty)).first;
+    }
+    Phase& p = it->second;
+    p.calls++;
+    for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (mFds[i] < 0) continue;
+        // value, time enabled, time running ; scale when the PMU was multiplexed
+        uint64_t data[3];
+        if (read(mFds[i], data, sizeof(data)) != sizeof(data)) continue;
+        double value = data[0];
+        if (data[2] > 0 && data[2] < data[1]) value = value * data[1] / data[2];
+        p.values[i] += value;
+    }
+}
+
+void PerfCounters::print(std::ostream& out) const {
+    for (const auto& it : mPhases) {
+        const Phase& p = it.second;
+        out << "		" << it.first << " (" << p.calls << " calls):";
+        for (int i = 0; i < PERF_EVENT_COUNT; i++) {
+            out << " " << EVENT_NAMES[i] << "=";
+            if (mFds[i] < 0) out << "n/a";
+            else out << (uint64_t)p.values[i];
+        }
+        if (mFds[PERF_CYCLES] >= 0 && mFds[PERF_INSTRUCTIONS] >= 0 && p.values[PERF_CYCLES] > 0) {
+            out << " ipc=" << p.values[PERF_INSTRUCTIONS] / p.values[PERF_CYCLES];
+        }
+        out << "\n";
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * @brief Optional hardware/software performance counters (perf_event_open) of the
+ *        calling thread, accumulated per named phase of a transfer.
+ *
+ * Counters that cannot be opened (no PMU access in a VM, perf_event_paranoid, ...)
+ * are reported as unavailable instead of failing the benchmark. When kernel-side
+ * counting is not allowed the counters fall back to user space only.
+ */
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_CONTEXT_SWITCHES,
+    PERF_EVENT_COUNT
+};
+
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Open the counters, returns the number of available events
+    int open();
+
+    bool enabled() const { return mEnabled; }
+
+    // Count the code between start() and stop() into `phase`, no-ops when not enabled
+    void start();
+    void stop(const std::string& phase);
+
+    void reset() { mPhases.clear(); }
+
+    // One line per phase with the totals and IPC, "n/a" for unavailable events
+    void print(std::ostream& out) const;
+
+private:
+    struct Phase {
+        uint64_t calls;
+        double values[PERF_EVENT_COUNT];
+    };
+
+    bool mEnabled;
+    bool mUserOnly;
+    int mFds[PERF_EVENT_COUNT];
+    std::map<std::string, Phase> mPhases;
+};
+
+#endif /* PERFCOUNTERS_H_ */
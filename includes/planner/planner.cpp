@@ -0,0 +1,96 @@
+#include "planner.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// Bytes read per host chunk, rounded down to whole bitmap words
+static const size_t HOST_SCAN_CHUNK = 64 << 20;
+static const size_t HOST_SCAN_ALIGN = 4096;
+
+// Multiple of 4 KiB holding whole words of the bitmap, where the file can be cut
+static size_t split_unit(size_t record_size) {
+    return record_unit(32 * record_size, HOST_SCAN_ALIGN);
+}
+
+const char *plan_name(PlanKind kind) {
+    return kind == PLAN_CPU ? "CPU" : kind == PLAN_FPGA ? "FPGA" : "split";
+}
+
+Plan plan_scan(const Calibration& calibration, double min_gain) {
+    // Seconds per MiB of each side, its steps run one after the other
+    double cpu_time = 1 / calibration.ssd_read + 1 / calibration.cpu_kernel;
+    double fpga_time = 1 / calibration.p2p_read + 1 / calibration.fpga_kernel + calibration.result_ratio / calibration.sync;
+    Plan plan;
+    plan.cpu = 1 / cpu_time;
+    plan.fpga = 1 / fpga_time;
+    plan.split = std::min(plan.cpu + plan.fpga, std::max(calibration.ssd_read, calibration.p2p_read));
+
+    double best = std::max(plan.cpu, plan.fpga);
+    if (plan.split > best * (1 + min_gain)) {
+        plan.kind = PLAN_SPLIT;
+        plan.fpga_share = plan.fpga / (plan.cpu + plan.fpga);
+        plan.predicted = plan.split;
+    } else if (plan.fpga >= plan.cpu) {
+        plan.kind = PLAN_FPGA;
+        plan.fpga_share = 1;
+        plan.predicted = plan.fpga;
+    } else {
+        plan.kind = PLAN_CPU;
+        plan.fpga_share = 0;
+        plan.predicted = plan.cpu;
+    }
+    return plan;
+}
+
+ScanResult host_scan(const std::string& file, const Schema& schema, const Predicate& predicate, size_t start, size_t size) {
+    ScanResult result = ScanResult();
+    if (start % HOST_SCAN_ALIGN != 0 || start % schema.record_size != 0) {
+        std::cerr << "ERROR: host scan start " << start << " is not a multiple of 4 KiB and of the records" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<FilterPredicate> predicates = encode_predicate(schema, predicate);
+    size_t unit = split_unit(schema.record_size);
+    size_t chunk = std::max(HOST_SCAN_CHUNK / unit, (size_t)1) * unit;
+    ChunkReader input(file, chunk, start + size, HOST_SCAN_ALIGN);
+    char *buf = (char*)aligned_alloc(HOST_SCAN_ALIGN, chunk);
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t len = std::min(chunk, size - offset);
+        input.read(buf, start + offset, len);
+        uint32_t records = len / schema.record_size;
+        // Every chunk but the last holds whole bitmap words
+        size_t word = result.bitmap.size();
+        result.bitmap.resize(word + (records + 31) / 32);
+        result.matches += cpu_filter((const uint8_t*)buf, nullptr, result.bitmap.data() + word, predicates.data(),
+                                     predicates.size(), schema.record_size, records);
+        result.records += records;
+        result.bytes_scanned += len;
+    }
+    free(buf);
+    return result;
+}
+
+ScanResult planned_scan(Scanner& scanner, const Plan& plan, const std::string& file, const Schema& schema,
+                        const Predicate& predicate, size_t size) {
+    size_t unit = split_unit(schema.record_size);
+    size_t split = (size_t)(plan.fpga_share * size) / unit * unit;
+    if (plan.kind == PLAN_FPGA || split >= size) return scanner.scan(file, schema, predicate, SCAN_BITMAP, size);
+    if (plan.kind == PLAN_CPU || split == 0) return host_scan(file, schema, predicate, 0, size);
+
+    ScanResult cpu_result;
+    std::thread cpu_thread([&] { cpu_result = host_scan(file, schema, predicate, split, size - split); });
+    ScanResult result = scanner.scan_range(file, schema, predicate, SCAN_BITMAP, 0, split);
+    cpu_thread.join();
+
+    // The FPGA share ends on a word boundary of the bitmap
+    result.bitmap.resize(result.records / 32);
+    result.bitmap.insert(result.bitmap.end(), cpu_result.bitmap.begin(), cpu_result.bitmap.end());
+    result.records += cpu_result.records;
+    result.matches += cpu_result.matches;
+    result.bytes_scanned += cpu_result.bytes_scanned;
+    return result;
+}
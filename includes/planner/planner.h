@@ -0,0 +1,57 @@
+/**
+ * @brief Cost model choosing where a filter scan runs : on the CPU, on the FPGA, or split
+ *        between both running concurrently.
+ *
+ * The model only takes bandwidths measured by the harness on the machine : drive reads into
+ * host memory and P2P into the p2p bo, bo.sync of the results, and the throughput of
+ * filter_kernel and of its SIMD host equivalent on the predicate. Each side handles its
+ * chunks one step after the other, so its time per byte is the sum of the times per byte of
+ * its steps. A split gives each side a share of the file in proportion to its throughput,
+ * both sides adding up until the drive is saturated.
+ */
+#ifndef PLANNER_H_
+#define PLANNER_H_
+
+#include "scan.h"
+
+#include <cstddef>
+#include <string>
+
+// Bandwidths in MiB/s of bytes of records, result_ratio in bytes to host per byte scanned
+struct Calibration {
+    double ssd_read;     // O_DIRECT reads into host memory
+    double p2p_read;     // P2P reads into the p2p bo
+    double sync;         // bo.sync from the device
+    double fpga_kernel;  // filter_kernel on the predicate
+    double cpu_kernel;   // cpu_filter on the predicate
+    double result_ratio; // bitmap bytes per record byte
+};
+
+enum PlanKind { PLAN_CPU, PLAN_FPGA, PLAN_SPLIT };
+
+struct Plan {
+    PlanKind kind;
+    double fpga_share; // of the bytes, 1 for PLAN_FPGA and 0 for PLAN_CPU
+    double cpu;        // predicted MiB/s of each path on its own
+    double fpga;
+    double split;      // predicted MiB/s of the split
+    double predicted;  // of the chosen plan
+};
+
+const char *plan_name(PlanKind kind);
+
+// Splits are only chosen when they beat the best single path by min_gain
+Plan plan_scan(const Calibration& calibration, double min_gain = 0.05);
+
+// Filter scan with cpu_filter of `size` bytes of `file` from byte `start`, read with O_DIRECT, as a bitmap
+ScanResult host_scan(const std::string& file, const Schema& schema, const Predicate& predicate, size_t start, size_t size);
+
+/**
+ * Run `plan` over the first `size` bytes of `file` : the FPGA share from the start with the
+ * scanner, the CPU share after it on a second thread, the bitmaps joined at the end. The
+ * boundary is rounded to whole 4 KiB pages and bitmap words.
+ */
+ScanResult planned_scan(Scanner& scanner, const Plan& plan, const std::string& file, const Schema& schema,
+                        const Predicate& predicate, size_t size);
+
+#endif /* PLANNER_H_ */
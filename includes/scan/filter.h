@@ -0,0 +1,26 @@
+/**
+ * @brief Predicate encoding shared by the host scan API and filter_kernel.
+ *
+ * A predicate is a conjunction of at most FILTER_MAX_PREDICATES comparisons of a
+ * fixed-width little-endian column of the record against a constant.
+ */
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <stdint.h>
+
+#define FILTER_MAX_PREDICATES 8
+
+enum FilterType { FILTER_INT32 = 0, FILTER_INT64 = 1, FILTER_FLOAT64 = 2 };
+
+enum FilterOp { FILTER_EQ = 0, FILTER_NE = 1, FILTER_LT = 2, FILTER_LE = 3, FILTER_GT = 4, FILTER_GE = 5 };
+
+struct FilterPredicate {
+    uint32_t offset; // byte offset of the column in the record
+    uint32_t type;   // FilterType
+    uint32_t op;     // FilterOp
+    uint32_t reserved;
+    int64_t value;   // constant, the bits of a double for FILTER_FLOAT64
+};
+
+#endif /* FILTER_H_ */
@@ -0,0 +1,261 @@
+#include "scan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Chunk streamed through the p2p bo per kernel run, the rows bo is as large in the worst case
+static const size_t SCAN_CHUNK = 256 << 20;
+static const size_t SCAN_ALIGN = 4096;
+
+const Column& Schema::column(const std::string& name) const {
+    for (const Column& c : columns) {
+        if (c.name == name) return c;
+    }
+    std::cerr << "ERROR: unknown column " << name << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// Terms of an integer column always false and always true, nothing is below INT64_MIN
+static void constant_term(FilterPredicate& p, bool result) {
+    p.op = result ? FILTER_GE : FILTER_LT;
+    p.value = INT64_MIN;
+}
+
+/**
+ * Comparison of an integer column with a real constant as the same comparison with an
+ * integer : rounded up for < and >=, down for <= and >. == and != a constant that is not
+ * an integer, NaN or outside of int64 give a constant term.
+ */
+static void encode_integer(FilterPredicate& p, uint32_t op, double value) {
+    // 2^63, the first double above INT64_MAX
+    const double limit = 9223372036854775808.0;
+    if (std::isnan(value)) return constant_term(p, op == FILTER_NE);
+
+    double rounded;
+    switch (op) {
+    case FILTER_LT: case FILTER_GE: rounded = std::ceil(value); break;
+    case FILTER_LE: case FILTER_GT: rounded = std::floor(value); break;
+    default:
+        if (value != std::floor(value)) return constant_term(p, op == FILTER_NE);
+        rounded = value;
+    }
+    if (rounded >= limit) return constant_term(p, op == FILTER_LT || op == FILTER_LE || op == FILTER_NE);
+    if (rounded < -limit) return constant_term(p, op == FILTER_GT || op == FILTER_GE || op == FILTER_NE);
+    p.value = (int64_t)rounded;
+}
+
+std::vector<FilterPredicate> encode_predicate(const Schema& schema, const Predicate& predicate) {
+    if (predicate.terms.size() > FILTER_MAX_PREDICATES) {
+        std::cerr << "ERROR: at most " << FILTER_MAX_PREDICATES << " comparisons per predicate" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::vector<FilterPredicate> encoded;
+    for (const Comparison& term : predicate.terms) {
+        const Column& column = schema.column(term.column);
+        FilterPredicate p;
+        memset(&p, 0, sizeof(p));
+        p.offset = column.offset;
+        p.type = column.type;
+        p.op = term.op;
+        if (column.type == FILTER_FLOAT64) memcpy(&p.value, &term.value, sizeof(double));
+        else encode_integer(p, term.op, term.value);
+        encoded.push_back(p);
+    }
+    return encoded;
+}
+
+template <typename T>
+static bool compare(T a, T b, uint32_t op) {
+    switch (op) {
+    case FILTER_EQ: return a == b;
+    case FILTER_NE: return a != b;
+    case FILTER_LT: return a < b;
+    case FILTER_LE: return a <= b;
+    case FILTER_GT: return a > b;
+    default: return a >= b;
+    }
+}
+
+bool evaluate(const std::vector<FilterPredicate>& predicates, const uint8_t *record) {
+    for (const FilterPredicate& p : predicates) {
+        const uint8_t *field = record + p.offset;
+        bool term;
+        if (p.type == FILTER_INT32) {
+            int32_t v;
+            memcpy(&v, field, sizeof(v));
+            term = compare<int64_t>(v, p.value, p.op);
+        } else if (p.type == FILTER_INT64) {
+            int64_t v;
+            memcpy(&v, field, sizeof(v));
+            term = compare<int64_t>(v, p.value, p.op);
+        } else {
+            double v, c;
+            memcpy(&v, field, sizeof(v));
+            memcpy(&c, &p.value, sizeof(c));
+            term = compare<double>(v, c, p.op);
+        }
+        if (!term) return false;
+    }
+    return true;
+}
+
+// Append `count` bits of `words` at bit position `pos` of the result bitmap
+static void append_bits(std::vector<uint32_t>& bitmap, uint64_t pos, const uint32_t *words, uint64_t count) {
+    bitmap.resize((pos + count + 31) / 32, 0);
+    if (pos % 32 == 0) {
+        memcpy(bitmap.data() + pos / 32, words, (count + 31) / 32 * sizeof(uint32_t));
+        return;
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        if (words[i / 32] & (1u << (i % 32))) bitmap[(pos + i) / 32] |= 1u << ((pos + i) % 32);
+    }
+}
+
+static size_t gcd(size_t a, size_t b) {
+    return b == 0 ? a : gcd(b, a % b);
+}
+
+size_t record_unit(size_t record_size, size_t align) {
+    return record_size / gcd(record_size, align) * align;
+}
+
+size_t record_chunk(size_t record_size, size_t limit, size_t align) {
+    size_t unit = record_unit(record_size, align);
+    return limit / unit * unit;
+}
+
+ChunkReader::ChunkReader(const std::string& file, size_t chunk, size_t size, size_t align)
+    : mChunk(chunk), mSize(size), mAlign(align) {
+    mFd = open(file.c_str(), O_RDONLY | O_DIRECT);
+    if (mFd < 0) {
+        std::cerr << "ERROR: open " << file << " failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (mSize == 0) {
+        struct stat st;
+        fstat(mFd, &st);
+        mSize = st.st_size;
+    }
+}
+
+ChunkReader::~ChunkReader() {
+    (void)close(mFd);
+}
+
+void ChunkReader::read(void *dst, size_t offset, size_t len) {
+    size_t read_len = (len + mAlign - 1) / mAlign * mAlign;
+    if (len > 0 && pread(mFd, dst, read_len, offset) < (ssize_t)len) {
+        std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+size_t ChunkReader::read_chunk(void *dst, size_t offset) {
+    size_t len = offset < mSize ? std::min(mChunk, mSize - offset) : 0;
+    read(dst, offset, len);
+    return len;
+}
+
+Scanner::Scanner(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map)
+    : mKernel(device, uuid, "filter_kernel"), mBo(p2p_bo), mMap((char*)p2p_map) {
+    size_t chunk = std::min(SCAN_CHUNK, mBo.size());
+    mRowsBo = xrt::bo(device, chunk, mKernel.group_id(1));
+    mBitmapBo = xrt::bo(device, chunk / 8 + sizeof(uint32_t), mKernel.group_id(2));
+    mCountBo = xrt::bo(device, sizeof(uint32_t), mKernel.group_id(3));
+    mPredicateBo = xrt::bo(device, FILTER_MAX_PREDICATES * sizeof(FilterPredicate), mKernel.group_id(4));
+}
+
+ScanResult Scanner::scan(const std::string& file, const Schema& schema, const Predicate& predicate, ScanOutput output, size_t size,
+                         const ZoneMap *zones) {
+    return scan_range(file, schema, predicate, output, 0, size, zones);
+}
+
+ScanResult Scanner::scan_range(const std::string& file, const Schema& schema, const Predicate& predicate, ScanOutput output,
+                               size_t start, size_t size, const ZoneMap *zones) {
+    ScanResult result = ScanResult();
+
+    std::vector<FilterPredicate> predicates = encode_predicate(schema, predicate);
+    memcpy(mPredicateBo.map<FilterPredicate*>(), predicates.data(), predicates.size() * sizeof(FilterPredicate));
+    mPredicateBo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+    // Chunks hold whole records and keep the P2P reads 4 KiB aligned
+    size_t record_size = schema.record_size;
+    size_t unit = record_unit(record_size, SCAN_ALIGN);
+    size_t chunk = record_chunk(record_size, std::min(SCAN_CHUNK, mBo.size()), SCAN_ALIGN);
+    if (chunk == 0) {
+        std::cerr << "ERROR: records of " << record_size << " bytes do not fit in a scan chunk" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (start % unit != 0) {
+        std::cerr << "ERROR: scan start " << start << " is not a multiple of " << unit << " bytes" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Zone map blocks are skipped whole, the chunks are then made of runs of blocks
+    size_t block = chunk;
+    if (zones) {
+        block = zones->block_bytes();
+        if (block == 0 || block % unit != 0 || block > chunk) {
+            std::cerr << "ERROR: zone map blocks of " << block << " bytes do not split the scan chunks" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        chunk = chunk / block * block;
+    }
+    // The whole file past `start` when `size` is 0
+    ChunkReader input(file, chunk, size == 0 ? 0 : start + size, SCAN_ALIGN);
+    if (size == 0) size = input.size() > start ? input.size() - start : 0;
+
+    uint32_t *count = mCountBo.map<uint32_t*>();
+    size_t offset = start;
+    size_t end_of_range = start + size;
+    while (offset < end_of_range) {
+        if (zones && !zones->may_match(offset / block, predicates)) {
+            size_t len = std::min(block, end_of_range - offset);
+            result.records += len / record_size;
+            if (output == SCAN_BITMAP) result.bitmap.resize((result.records + 31) / 32, 0);
+            result.bytes_scanned += len;
+            result.bytes_skipped += len;
+            offset += len;
+            continue;
+        }
+        size_t end = offset + block;
+        while (zones && end < end_of_range && end - offset < chunk && zones->may_match(end / block, predicates)) end += block;
+        size_t len = std::min(end, end_of_range) - offset;
+        input.read(mMap, offset, len);
+        unsigned int records = len / record_size;
+
+        auto run = mKernel(mBo, mRowsBo, mBitmapBo, mCountBo, mPredicateBo, (unsigned int)predicates.size(),
+                           (unsigned int)record_size, records, (unsigned int)(output == SCAN_ROWS));
+        run.wait();
+        mCountBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+        result.bytes_to_host += sizeof(uint32_t);
+
+        if (output == SCAN_BITMAP) {
+            size_t bytes = (records + 31) / 32 * sizeof(uint32_t);
+            mBitmapBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, bytes, 0);
+            append_bits(result.bitmap, result.records, mBitmapBo.map<uint32_t*>(), records);
+            result.bytes_to_host += bytes;
+        } else if (*count > 0) {
+            size_t bytes = (size_t)*count * record_size;
+            mRowsBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, bytes, 0);
+            const uint8_t *rows = mRowsBo.map<uint8_t*>();
+            result.rows.insert(result.rows.end(), rows, rows + bytes);
+            result.bytes_to_host += bytes;
+        }
+
+        result.records += records;
+        result.matches += *count;
+        result.bytes_scanned += len;
+        offset += len;
+    }
+    return result;
+}
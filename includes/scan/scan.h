@@ -0,0 +1,129 @@
+/**
+ * @brief Predicate pushdown scan over files of fixed-width records.
+ *
+ * scan() streams the file through the p2p bo with P2P preads, filter_kernel evaluates
+ * the predicate next to the drive and only the selection bitmap, or the matching rows
+ * compacted by the kernel, are synced to the host.
+ */
+#ifndef SCAN_H_
+#define SCAN_H_
+
+#include "filter.h"
+#include "zonemap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "experimental/xrt_bo.h"
+#include "experimental/xrt_device.h"
+#include "experimental/xrt_kernel.h"
+
+struct Column {
+    std::string name;
+    FilterType type;
+    uint32_t offset;
+};
+
+struct Schema {
+    std::vector<Column> columns;
+    uint32_t record_size;
+
+    const Column& column(const std::string& name) const;
+};
+
+struct Comparison {
+    std::string column;
+    FilterOp op;
+    double value;
+};
+
+// Conjunction of comparisons
+struct Predicate {
+    std::vector<Comparison> terms;
+
+    Predicate& where(const std::string& column, FilterOp op, double value) {
+        terms.push_back({column, op, value});
+        return *this;
+    }
+};
+
+enum ScanOutput { SCAN_BITMAP, SCAN_ROWS };
+
+struct ScanResult {
+    uint64_t records;
+    uint64_t matches;
+    uint64_t bytes_scanned; // bytes of records covered by the scan, skipped ones included
+    uint64_t bytes_skipped; // not read thanks to the zone map
+    uint64_t bytes_to_host;
+    std::vector<uint32_t> bitmap; // SCAN_BITMAP : bit i of word i / 32 set when record i matches
+    std::vector<uint8_t> rows;    // SCAN_ROWS : the matching records back to back
+};
+
+// Encode the predicate for the kernel, exits on unknown columns or too many terms
+std::vector<FilterPredicate> encode_predicate(const Schema& schema, const Predicate& predicate);
+
+// Host evaluation of one record, the reference of filter_kernel
+bool evaluate(const std::vector<FilterPredicate>& predicates, const uint8_t *record);
+
+// Smallest multiple of `record_size` that is also a multiple of `align`, chunks of whole records for O_DIRECT reads
+size_t record_unit(size_t record_size, size_t align = 4096);
+
+// Largest multiple of record_unit() up to `limit`, 0 when a single unit is larger
+size_t record_chunk(size_t record_size, size_t limit, size_t align = 4096);
+
+/**
+ * File read with O_DIRECT in chunks of `chunk` bytes, into the map of the p2p bo for P2P
+ * reads or into a host buffer. Offsets are in the file, multiples of `align`, and the reads
+ * are rounded up to it. Exits on open and read errors, the file is closed with the reader.
+ */
+class ChunkReader {
+public:
+    // `size` 0 reads the whole file
+    ChunkReader(const std::string& file, size_t chunk, size_t size = 0, size_t align = 4096);
+    ~ChunkReader();
+    ChunkReader(const ChunkReader&) = delete;
+    ChunkReader& operator=(const ChunkReader&) = delete;
+
+    size_t size() const { return mSize; }
+    size_t chunk() const { return mChunk; }
+    // Whether the chunk at `offset` is the last one
+    bool last(size_t offset) const { return offset + mChunk >= mSize; }
+
+    // Read `len` bytes at `offset` into `dst`, which has room for `len` rounded up to the alignment
+    void read(void *dst, size_t offset, size_t len);
+    // Read the chunk at `offset`, returns its length : shorter for the last chunk, 0 past the end
+    size_t read_chunk(void *dst, size_t offset);
+
+private:
+    int mFd;
+    size_t mChunk;
+    size_t mSize;
+    size_t mAlign;
+};
+
+class Scanner {
+public:
+    // Scans in chunks of the p2p bo, which must stay mapped for the life of the scanner
+    Scanner(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map);
+
+    // Scan `size` bytes of `file` (the whole file when 0), without reading the blocks `zones` rules out
+    ScanResult scan(const std::string& file, const Schema& schema, const Predicate& predicate,
+                    ScanOutput output = SCAN_BITMAP, size_t size = 0, const ZoneMap *zones = nullptr);
+
+    // Same from byte `start` of the file, a multiple of the record size and of 4 KiB, bitmaps start at that record
+    ScanResult scan_range(const std::string& file, const Schema& schema, const Predicate& predicate, ScanOutput output,
+                          size_t start, size_t size = 0, const ZoneMap *zones = nullptr);
+
+private:
+    xrt::kernel mKernel;
+    xrt::bo mBo;
+    char *mMap;
+    xrt::bo mPredicateBo;
+    xrt::bo mBitmapBo;
+    xrt::bo mRowsBo;
+    xrt::bo mCountBo;
+};
+
+#endif /* SCAN_H_ */
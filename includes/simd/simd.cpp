@@ -0,0 +1,639 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Copies from this size on use non-temporal stores, the destination is not read back soon
+static const size_t COPY_STREAM_BYTES = 1 << 20;
+
+static SimdLevel simd_cap = SIMD_AVX512;
+
+SimdLevel simd_detect() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+}
+
+SimdLevel simd_level() {
+    static const SimdLevel detected = simd_detect();
+    return std::min(detected, simd_cap);
+}
+
+void simd_set_level(SimdLevel cap) {
+    simd_cap = cap;
+}
+
+const char *simd_name(SimdLevel level) {
+    return level == SIMD_AVX512 ? "avx512" : level == SIMD_AVX2 ? "avx2" : "scalar";
+}
+
+bool simd_parse(const std::string& name, SimdLevel& level) {
+    if (name == "auto" || name == "avx512") level = SIMD_AVX512;
+    else if (name == "avx2") level = SIMD_AVX2;
+    else if (name == "scalar") level = SIMD_SCALAR;
+    else return false;
+    return true;
+}
+
+static bool has_aesni() {
+#if defined(__x86_64__)
+    return simd_level() >= SIMD_AVX2 && __builtin_cpu_supports("aes");
+#else
+    return false;
+#endif
+}
+
+static bool has_vaes() {
+#if defined(__x86_64__)
+    return simd_level() >= SIMD_AVX512 && __builtin_cpu_supports("vaes") && has_aesni();
+#else
+    return false;
+#endif
+}
+
+static bool has_shani() {
+#if defined(__x86_64__)
+    return simd_level() >= SIMD_AVX2 && __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+#else
+    return false;
+#endif
+}
+
+// Scalar versions, written as the kernels
+
+template <typename T>
+static bool compare(T a, T b, uint32_t op) {
+    switch (op) {
+    case FILTER_EQ: return a == b;
+    case FILTER_NE: return a != b;
+    case FILTER_LT: return a < b;
+    case FILTER_LE: return a <= b;
+    case FILTER_GT: return a > b;
+    default: return a >= b;
+    }
+}
+
+static int64_t load_value(const uint8_t *field, uint32_t type) {
+    if (type == FILTER_INT32) {
+        int32_t v;
+        memcpy(&v, field, sizeof(v));
+        return v;
+    }
+    int64_t v;
+    memcpy(&v, field, sizeof(v));
+    return v;
+}
+
+static double as_double(int64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+static bool less(int64_t a, int64_t b, uint32_t type) {
+    return type == FILTER_FLOAT64 ? as_double(a) < as_double(b) : a < b;
+}
+
+static bool match_record(const uint8_t *record, const FilterPredicate *predicates, uint32_t num_predicates) {
+    for (uint32_t p = 0; p < num_predicates; p++) {
+        const FilterPredicate& pred = predicates[p];
+        int64_t v = load_value(record + pred.offset, pred.type);
+        bool term = pred.type == FILTER_FLOAT64 ? compare<double>(as_double(v), as_double(pred.value), pred.op)
+                                                : compare<int64_t>(v, pred.value, pred.op);
+        if (!term) return false;
+    }
+    return true;
+}
+
+// Records [first, num_records) one by one, the bitmap words from first / 32 on
+static uint32_t filter_scalar(const uint8_t *in, uint8_t *rows, uint32_t *bitmap, const FilterPredicate *predicates,
+                              uint32_t num_predicates, uint32_t record_size, uint32_t first, uint32_t num_records,
+                              uint32_t matches) {
+    uint32_t word = first % 32 ? bitmap[first / 32] : 0;
+    for (uint32_t r = first; r < num_records; r++) {
+        const uint8_t *record = in + (uint64_t)r * record_size;
+        if (match_record(record, predicates, num_predicates)) {
+            word |= 1u << (r % 32);
+            if (rows) memcpy(rows + (uint64_t)matches * record_size, record, record_size);
+            matches++;
+        }
+        if (r % 32 == 31 || r == num_records - 1) {
+            bitmap[r / 32] = word;
+            word = 0;
+        }
+    }
+    return matches;
+}
+
+static void zone_scalar(const uint8_t *in, uint32_t record_size, uint32_t type, uint32_t first, uint32_t count, ZoneEntry& zone) {
+    for (uint32_t r = first; r < count; r++) {
+        int64_t v = load_value(in + (uint64_t)r * record_size, type);
+        if (r == 0 || less(v, zone.min, type)) zone.min = v;
+        if (r == 0 || less(zone.max, v, type)) zone.max = v;
+    }
+}
+
+static void sha256_block_scalar(const uint8_t *data, size_t len, uint8_t *digest) {
+    sha256(data, len, digest);
+}
+
+#if defined(__x86_64__)
+// Emit the matching records of an 8 or 4 record step whose match bits are `mask`
+static uint32_t emit_rows(const uint8_t *first, uint8_t *rows, uint32_t record_size, uint32_t mask, uint32_t matches) {
+    if (!rows) return matches + __builtin_popcount(mask);
+    while (mask) {
+        int bit = __builtin_ctz(mask);
+        mask &= mask - 1;
+        memcpy(rows + (uint64_t)matches * record_size, first + (uint64_t)bit * record_size, record_size);
+        matches++;
+    }
+    return matches;
+}
+
+__attribute__((target("avx512f")))
+static __mmask8 compare_avx512(__m512i v, const FilterPredicate& pred) {
+    if (pred.type == FILTER_FLOAT64) {
+        __m512d a = _mm512_castsi512_pd(v);
+        __m512d b = _mm512_castsi512_pd(_mm512_set1_epi64(pred.value));
+        // Ordered compares but NE, like the C++ operators on NaN
+        switch (pred.op) {
+        case FILTER_EQ: return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ);
+        case FILTER_NE: return _mm512_cmp_pd_mask(a, b, _CMP_NEQ_UQ);
+        case FILTER_LT: return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ);
+        case FILTER_LE: return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ);
+        case FILTER_GT: return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ);
+        default: return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ);
+        }
+    }
+    __m512i b = _mm512_set1_epi64(pred.value);
+    switch (pred.op) {
+    case FILTER_EQ: return _mm512_cmpeq_epi64_mask(v, b);
+    case FILTER_NE: return _mm512_cmpneq_epi64_mask(v, b);
+    case FILTER_LT: return _mm512_cmplt_epi64_mask(v, b);
+    case FILTER_LE: return _mm512_cmple_epi64_mask(v, b);
+    case FILTER_GT: return _mm512_cmpgt_epi64_mask(v, b);
+    default: return _mm512_cmpge_epi64_mask(v, b);
+    }
+}
+
+// Column of 8 records whose byte offsets from `in` are `index`, int32 widened to int64
+__attribute__((target("avx512f")))
+static __m512i gather_avx512(const uint8_t *in, __m512i index, uint32_t type) {
+    if (type == FILTER_INT32) return _mm512_cvtepi32_epi64(_mm512_i64gather_epi32(index, in, 1));
+    return _mm512_i64gather_epi64(index, in, 1);
+}
+
+__attribute__((target("avx512f")))
+static uint32_t filter_avx512(const uint8_t *in, uint8_t *rows, uint32_t *bitmap, const FilterPredicate *predicates,
+                              uint32_t num_predicates, uint32_t record_size, uint32_t num_records) {
+    const int64_t rs = record_size;
+    __m512i index = _mm512_setr_epi64(0, rs, 2 * rs, 3 * rs, 4 * rs, 5 * rs, 6 * rs, 7 * rs);
+    const __m512i step = _mm512_set1_epi64(8 * rs);
+    uint32_t matches = 0, word = 0, r = 0;
+    for (; r + 8 <= num_records; r += 8) {
+        __mmask8 mask = 0xFF;
+        for (uint32_t p = 0; p < num_predicates && mask; p++) {
+            __m512i field = _mm512_add_epi64(index, _mm512_set1_epi64(predicates[p].offset));
+            mask &= compare_avx512(gather_avx512(in, field, predicates[p].type), predicates[p]);
+        }
+        word |= (uint32_t)mask << (r % 32);
+        if (r % 32 == 24) {
+            bitmap[r / 32] = word;
+            word = 0;
+        }
+        matches = emit_rows(in + (uint64_t)r * record_size, rows, record_size, mask, matches);
+        index = _mm512_add_epi64(index, step);
+    }
+    if (r % 32) bitmap[r / 32] = word;
+    return filter_scalar(in, rows, bitmap, predicates, num_predicates, record_size, r, num_records, matches);
+}
+
+__attribute__((target("avx2")))
+static uint32_t compare_avx2(__m256i v, const FilterPredicate& pred) {
+    if (pred.type == FILTER_FLOAT64) {
+        __m256d a = _mm256_castsi256_pd(v);
+        __m256d b = _mm256_castsi256_pd(_mm256_set1_epi64x(pred.value));
+        __m256d hits;
+        switch (pred.op) {
+        case FILTER_EQ: hits = _mm256_cmp_pd(a, b, _CMP_EQ_OQ); break;
+        case FILTER_NE: hits = _mm256_cmp_pd(a, b, _CMP_NEQ_UQ); break;
+        case FILTER_LT: hits = _mm256_cmp_pd(a, b, _CMP_LT_OQ); break;
+        case FILTER_LE: hits = _mm256_cmp_pd(a, b, _CMP_LE_OQ); break;
+        case FILTER_GT: hits = _mm256_cmp_pd(a, b, _CMP_GT_OQ); break;
+        default: hits = _mm256_cmp_pd(a, b, _CMP_GE_OQ); break;
+        }
+        return _mm256_movemask_pd(hits);
+    }
+    // Only == and > exist on 64-bit lanes, the others are swaps and complements
+    __m256i b = _mm256_set1_epi64x(pred.value);
+    switch (pred.op) {
+    case FILTER_EQ: return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, b)));
+    case FILTER_NE: return ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, b))) & 0xF;
+    case FILTER_LT: return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(b, v)));
+    case FILTER_LE: return ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, b))) & 0xF;
+    case FILTER_GT: return _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, b)));
+    default: return ~_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(b, v))) & 0xF;
+    }
+}
+
+__attribute__((target("avx2")))
+static __m256i gather_avx2(const uint8_t *in, __m256i index, uint32_t type) {
+    if (type == FILTER_INT32) return _mm256_cvtepi32_epi64(_mm256_i64gather_epi32((const int*)in, index, 1));
+    return _mm256_i64gather_epi64((const long long*)in, index, 1);
+}
+
+__attribute__((target("avx2")))
+static uint32_t filter_avx2(const uint8_t *in, uint8_t *rows, uint32_t *bitmap, const FilterPredicate *predicates,
+                            uint32_t num_predicates, uint32_t record_size, uint32_t num_records) {
+    const int64_t rs = record_size;
+    __m256i index = _mm256_setr_epi64x(0, rs, 2 * rs, 3 * rs);
+    const __m256i step = _mm256_set1_epi64x(4 * rs);
+    uint32_t matches = 0, word = 0, r = 0;
+    for (; r + 4 <= num_records; r += 4) {
+        uint32_t mask = 0xF;
+        for (uint32_t p = 0; p < num_predicates && mask; p++) {
+            __m256i field = _mm256_add_epi64(index, _mm256_set1_epi64x(predicates[p].offset));
+            mask &= compare_avx2(gather_avx2(in, field, predicates[p].type), predicates[p]);
+        }
+        word |= mask << (r % 32);
+        if (r % 32 == 28) {
+            bitmap[r / 32] = word;
+            word = 0;
+        }
+        matches = emit_rows(in + (uint64_t)r * record_size, rows, record_size, mask, matches);
+        index = _mm256_add_epi64(index, step);
+    }
+    if (r % 32) bitmap[r / 32] = word;
+    return filter_scalar(in, rows, bitmap, predicates, num_predicates, record_size, r, num_records, matches);
+}
+
+/**
+ * Bounds of `count` values of one block, 8 lanes then a reduction and the remainder in order.
+ * Zeros and NaNs make the result depend on the order of the compares, so blocks holding one
+ * in their lanes are redone in order.
+ */
+__attribute__((target("avx512f")))
+static void zone_avx512(const uint8_t *in, uint32_t record_size, uint32_t type, uint32_t count, ZoneEntry& zone) {
+    if (count < 16) {
+        zone_scalar(in, record_size, type, 0, count, zone);
+        return;
+    }
+    const int64_t rs = record_size;
+    __m512i index = _mm512_setr_epi64(0, rs, 2 * rs, 3 * rs, 4 * rs, 5 * rs, 6 * rs, 7 * rs);
+    const __m512i step = _mm512_set1_epi64(8 * rs);
+    const __m512d zero = _mm512_setzero_pd();
+    __m512i v = gather_avx512(in, index, type);
+    __m512i min = v, max = v;
+    __mmask8 special = type == FILTER_FLOAT64 ? _mm512_cmp_pd_mask(_mm512_castsi512_pd(v), zero, _CMP_EQ_UQ) : 0;
+    uint32_t r = 8;
+    for (; r + 8 <= count; r += 8) {
+        index = _mm512_add_epi64(index, step);
+        v = gather_avx512(in, index, type);
+        if (type == FILTER_FLOAT64) {
+            special |= _mm512_cmp_pd_mask(_mm512_castsi512_pd(v), zero, _CMP_EQ_UQ);
+            min = _mm512_castpd_si512(_mm512_min_pd(_mm512_castsi512_pd(min), _mm512_castsi512_pd(v)));
+            max = _mm512_castpd_si512(_mm512_max_pd(_mm512_castsi512_pd(max), _mm512_castsi512_pd(v)));
+        } else {
+            min = _mm512_min_epi64(min, v);
+            max = _mm512_max_epi64(max, v);
+        }
+    }
+    if (special) {
+        zone_scalar(in, record_size, type, 0, count, zone);
+        return;
+    }
+    if (type == FILTER_FLOAT64) {
+        double lo = _mm512_reduce_min_pd(_mm512_castsi512_pd(min));
+        double hi = _mm512_reduce_max_pd(_mm512_castsi512_pd(max));
+        memcpy(&zone.min, &lo, sizeof(lo));
+        memcpy(&zone.max, &hi, sizeof(hi));
+    } else {
+        zone.min = _mm512_reduce_min_epi64(min);
+        zone.max = _mm512_reduce_max_epi64(max);
+    }
+    for (; r < count; r++) {
+        int64_t value = load_value(in + (uint64_t)r * record_size, type);
+        if (less(value, zone.min, type)) zone.min = value;
+        if (less(zone.max, value, type)) zone.max = value;
+    }
+}
+
+__attribute__((target("avx2")))
+static void zone_avx2(const uint8_t *in, uint32_t record_size, uint32_t type, uint32_t count, ZoneEntry& zone) {
+    if (count < 8) {
+        zone_scalar(in, record_size, type, 0, count, zone);
+        return;
+    }
+    const int64_t rs = record_size;
+    __m256i index = _mm256_setr_epi64x(0, rs, 2 * rs, 3 * rs);
+    const __m256i step = _mm256_set1_epi64x(4 * rs);
+    const __m256d zero = _mm256_setzero_pd();
+    __m256i v = gather_avx2(in, index, type);
+    __m256i min = v, max = v;
+    int special = type == FILTER_FLOAT64 ? _mm256_movemask_pd(_mm256_cmp_pd(_mm256_castsi256_pd(v), zero, _CMP_EQ_UQ)) : 0;
+    uint32_t r = 4;
+    for (; r + 4 <= count; r += 4) {
+        index = _mm256_add_epi64(index, step);
+        v = gather_avx2(in, index, type);
+        if (type == FILTER_FLOAT64) {
+            special |= _mm256_movemask_pd(_mm256_cmp_pd(_mm256_castsi256_pd(v), zero, _CMP_EQ_UQ));
+            min = _mm256_castpd_si256(_mm256_min_pd(_mm256_castsi256_pd(min), _mm256_castsi256_pd(v)));
+            max = _mm256_castpd_si256(_mm256_max_pd(_mm256_castsi256_pd(max), _mm256_castsi256_pd(v)));
+        } else {
+            min = _mm256_blendv_epi8(min, v, _mm256_cmpgt_epi64(min, v));
+            max = _mm256_blendv_epi8(max, v, _mm256_cmpgt_epi64(v, max));
+        }
+    }
+    if (special) {
+        zone_scalar(in, record_size, type, 0, count, zone);
+        return;
+    }
+    int64_t lanes_min[4], lanes_max[4];
+    _mm256_storeu_si256((__m256i*)lanes_min, min);
+    _mm256_storeu_si256((__m256i*)lanes_max, max);
+    zone.min = lanes_min[0];
+    zone.max = lanes_max[0];
+    for (int i = 1; i < 4; i++) {
+        if (less(lanes_min[i], zone.min, type)) zone.min = lanes_min[i];
+        if (less(zone.max, lanes_max[i], type)) zone.max = lanes_max[i];
+    }
+    for (; r < count; r++) {
+        int64_t value = load_value(in + (uint64_t)r * record_size, type);
+        if (less(value, zone.min, type)) zone.min = value;
+        if (less(zone.max, value, type)) zone.max = value;
+    }
+}
+
+__attribute__((target("avx512f")))
+static void copy_avx512(char *dst, const char *src, size_t size) {
+    size_t pos = 0;
+    if (size >= COPY_STREAM_BYTES && (uintptr_t)dst % 64 == 0) {
+        for (; pos + 256 <= size; pos += 256) {
+            __m512i a = _mm512_loadu_si512(src + pos);
+            __m512i b = _mm512_loadu_si512(src + pos + 64);
+            __m512i c = _mm512_loadu_si512(src + pos + 128);
+            __m512i d = _mm512_loadu_si512(src + pos + 192);
+            _mm512_stream_si512((__m512i*)(dst + pos), a);
+            _mm512_stream_si512((__m512i*)(dst + pos + 64), b);
+            _mm512_stream_si512((__m512i*)(dst + pos + 128), c);
+            _mm512_stream_si512((__m512i*)(dst + pos + 192), d);
+        }
+        _mm_sfence();
+    }
+    for (; pos + 64 <= size; pos += 64) _mm512_storeu_si512(dst + pos, _mm512_loadu_si512(src + pos));
+    memcpy(dst + pos, src + pos, size - pos);
+}
+
+__attribute__((target("avx2")))
+static void copy_avx2(char *dst, const char *src, size_t size) {
+    size_t pos = 0;
+    if (size >= COPY_STREAM_BYTES && (uintptr_t)dst % 32 == 0) {
+        for (; pos + 128 <= size; pos += 128) {
+            __m256i a = _mm256_loadu_si256((const __m256i*)(src + pos));
+            __m256i b = _mm256_loadu_si256((const __m256i*)(src + pos + 32));
+            __m256i c = _mm256_loadu_si256((const __m256i*)(src + pos + 64));
+            __m256i d = _mm256_loadu_si256((const __m256i*)(src + pos + 96));
+            _mm256_stream_si256((__m256i*)(dst + pos), a);
+            _mm256_stream_si256((__m256i*)(dst + pos + 32), b);
+            _mm256_stream_si256((__m256i*)(dst + pos + 64), c);
+            _mm256_stream_si256((__m256i*)(dst + pos + 96), d);
+        }
+        _mm_sfence();
+    }
+    for (; pos + 32 <= size; pos += 32) {
+        _mm256_storeu_si256((__m256i*)(dst + pos), _mm256_loadu_si256((const __m256i*)(src + pos)));
+    }
+    memcpy(dst + pos, src + pos, size - pos);
+}
+
+static uint64_t load_be64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return __builtin_bswap64(v);
+}
+
+// Counter block of block `n` after the one (hi, lo), in memory order
+static void counter_block(uint64_t hi, uint64_t lo, uint64_t n, uint64_t out[2]) {
+    uint64_t sum = lo + n;
+    out[0] = __builtin_bswap64(hi + (sum < lo));
+    out[1] = __builtin_bswap64(sum);
+}
+
+__attribute__((target("aes")))
+static __m128i aes_encrypt_ni(const __m128i *keys, __m128i block) {
+    block = _mm_xor_si128(block, keys[0]);
+    for (int round = 1; round < AES256_ROUNDS; round++) block = _mm_aesenc_si128(block, keys[round]);
+    return _mm_aesenclast_si128(block, keys[AES256_ROUNDS]);
+}
+
+// Eight blocks in flight to cover the latency of AESENC
+__attribute__((target("aes")))
+static void aes_ctr_ni(const uint8_t *in, uint8_t *out, const uint8_t *keys, uint64_t first_block, size_t size) {
+    __m128i round_keys[AES256_ROUNDS + 1];
+    for (int i = 0; i <= AES256_ROUNDS; i++) round_keys[i] = _mm_loadu_si128((const __m128i*)(keys + i * AES_BLOCK_SIZE));
+    uint64_t hi = load_be64(keys + AES256_ROUND_KEYS_SIZE), lo = load_be64(keys + AES256_ROUND_KEYS_SIZE + 8);
+    uint64_t block = first_block;
+    size_t pos = 0;
+    for (; pos + 8 * AES_BLOCK_SIZE <= size; pos += 8 * AES_BLOCK_SIZE, block += 8) {
+        uint64_t counters[16];
+        for (int j = 0; j < 8; j++) counter_block(hi, lo, block + j, counters + 2 * j);
+        __m128i x[8];
+        for (int j = 0; j < 8; j++) x[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(counters + 2 * j)), round_keys[0]);
+        for (int round = 1; round < AES256_ROUNDS; round++) {
+            for (int j = 0; j < 8; j++) x[j] = _mm_aesenc_si128(x[j], round_keys[round]);
+        }
+        for (int j = 0; j < 8; j++) {
+            x[j] = _mm_aesenclast_si128(x[j], round_keys[AES256_ROUNDS]);
+            __m128i data = _mm_loadu_si128((const __m128i*)(in + pos + j * AES_BLOCK_SIZE));
+            _mm_storeu_si128((__m128i*)(out + pos + j * AES_BLOCK_SIZE), _mm_xor_si128(data, x[j]));
+        }
+    }
+    for (; pos < size; pos += AES_BLOCK_SIZE, block++) {
+        uint64_t counter[2];
+        counter_block(hi, lo, block, counter);
+        uint8_t stream[AES_BLOCK_SIZE];
+        _mm_storeu_si128((__m128i*)stream, aes_encrypt_ni(round_keys, _mm_loadu_si128((const __m128i*)counter)));
+        for (size_t i = 0; i < AES_BLOCK_SIZE && pos + i < size; i++) out[pos + i] = in[pos + i] ^ stream[i];
+    }
+}
+
+// Sixteen blocks in flight, four per 512-bit register
+__attribute__((target("avx512f,vaes,aes")))
+static void aes_ctr_vaes(const uint8_t *in, uint8_t *out, const uint8_t *keys, uint64_t first_block, size_t size) {
+    __m512i round_keys[AES256_ROUNDS + 1];
+    for (int i = 0; i <= AES256_ROUNDS; i++) {
+        round_keys[i] = _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*)(keys + i * AES_BLOCK_SIZE)));
+    }
+    uint64_t hi = load_be64(keys + AES256_ROUND_KEYS_SIZE), lo = load_be64(keys + AES256_ROUND_KEYS_SIZE + 8);
+    uint64_t block = first_block;
+    size_t pos = 0;
+    for (; pos + 16 * AES_BLOCK_SIZE <= size; pos += 16 * AES_BLOCK_SIZE, block += 16) {
+        uint64_t counters[32];
+        for (int j = 0; j < 16; j++) counter_block(hi, lo, block + j, counters + 2 * j);
+        __m512i x[4];
+        for (int j = 0; j < 4; j++) x[j] = _mm512_xor_si512(_mm512_loadu_si512(counters + 8 * j), round_keys[0]);
+        for (int round = 1; round < AES256_ROUNDS; round++) {
+            for (int j = 0; j < 4; j++) x[j] = _mm512_aesenc_epi128(x[j], round_keys[round]);
+        }
+        for (int j = 0; j < 4; j++) {
+            x[j] = _mm512_aesenclast_epi128(x[j], round_keys[AES256_ROUNDS]);
+            __m512i data = _mm512_loadu_si512(in + pos + j * 64);
+            _mm512_storeu_si512(out + pos + j * 64, _mm512_xor_si512(data, x[j]));
+        }
+    }
+    aes_ctr_ni(in + pos, out + pos, keys, block, size - pos);
+}
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+// SHA-256 compression of `chunks` 64-byte chunks, the state kept as ABEF/CDGH for SHA256RNDS2
+__attribute__((target("sha,sse4.1")))
+static void sha256_chunks_ni(uint32_t state[8], const uint8_t *data, size_t chunks) {
+    const __m128i swap = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(state + 4)), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (size_t c = 0; c < chunks; c++, data += 64) {
+        __m128i save0 = state0, save1 = state1;
+        __m128i w[4];
+        for (int i = 0; i < 16; i++) {
+            if (i < 4) {
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * i)), swap);
+            } else {
+                __m128i next = _mm_add_epi32(_mm_sha256msg1_epu32(w[i % 4], w[(i + 1) % 4]),
+                                             _mm_alignr_epi8(w[(i + 3) % 4], w[(i + 2) % 4], 4));
+                w[i % 4] = _mm_sha256msg2_epu32(next, w[(i + 3) % 4]);
+            }
+            __m128i msg = _mm_add_epi32(w[i % 4], _mm_loadu_si128((const __m128i*)(SHA256_K + 4 * i)));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(msg, 0x0E));
+        }
+        state0 = _mm_add_epi32(state0, save0);
+        state1 = _mm_add_epi32(state1, save1);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i*)state, _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128((__m128i*)(state + 4), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+static void sha256_block_ni(const uint8_t *data, size_t len, uint8_t *digest) {
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    size_t full = len / 64;
+    sha256_chunks_ni(h, data, full);
+
+    // Padding : 0x80, zeros, then the length in bits big-endian, in one or two chunks
+    uint8_t tail[128] = {0};
+    size_t rest = len - full * 64;
+    size_t tail_len = rest + 1 + 8 <= 64 ? 64 : 128;
+    memcpy(tail, data + full * 64, rest);
+    tail[rest] = 0x80;
+    uint64_t bits = __builtin_bswap64((uint64_t)len * 8);
+    memcpy(tail + tail_len - 8, &bits, sizeof(bits));
+    sha256_chunks_ni(h, tail, tail_len / 64);
+
+    for (int i = 0; i < 8; i++) {
+        uint32_t be = __builtin_bswap32(h[i]);
+        memcpy(digest + 4 * i, &be, sizeof(be));
+    }
+}
+#endif
+
+void cpu_copy(uint32_t *dst, const uint32_t *src, size_t words) {
+#if defined(__x86_64__)
+    SimdLevel level = simd_level();
+    if (level == SIMD_AVX512) return copy_avx512((char*)dst, (const char*)src, words * sizeof(uint32_t));
+    if (level == SIMD_AVX2) return copy_avx2((char*)dst, (const char*)src, words * sizeof(uint32_t));
+#endif
+    for (size_t i = 0; i < words; i++) dst[i] = src[i];
+}
+
+uint32_t cpu_filter(const uint8_t *in, uint8_t *rows, uint32_t *bitmap, const FilterPredicate *predicates,
+                    uint32_t num_predicates, uint32_t record_size, uint32_t num_records) {
+    num_predicates = std::min(num_predicates, (uint32_t)FILTER_MAX_PREDICATES);
+#if defined(__x86_64__)
+    SimdLevel level = simd_level();
+    if (level == SIMD_AVX512) return filter_avx512(in, rows, bitmap, predicates, num_predicates, record_size, num_records);
+    if (level == SIMD_AVX2) return filter_avx2(in, rows, bitmap, predicates, num_predicates, record_size, num_records);
+#endif
+    return filter_scalar(in, rows, bitmap, predicates, num_predicates, record_size, 0, num_records, 0);
+}
+
+void cpu_zonemap(const uint8_t *in, ZoneEntry *zones, uint32_t record_size, uint32_t column_offset, uint32_t type,
+                 uint32_t num_records, uint32_t block_records) {
+    SimdLevel level = simd_level();
+    for (uint32_t first = 0; first < num_records; first += block_records) {
+        const uint8_t *block = in + (uint64_t)first * record_size + column_offset;
+        uint32_t count = std::min(block_records, num_records - first);
+        ZoneEntry& zone = zones[first / block_records];
+#if defined(__x86_64__)
+        if (level == SIMD_AVX512) {
+            zone_avx512(block, record_size, type, count, zone);
+            continue;
+        }
+        if (level == SIMD_AVX2) {
+            zone_avx2(block, record_size, type, count, zone);
+            continue;
+        }
+#endif
+        zone_scalar(block, record_size, type, 0, count, zone);
+    }
+    (void)level;
+}
+
+void cpu_aes256_ctr(const uint8_t *in, uint8_t *out, const uint8_t keys[AES256_KERNEL_KEYS_SIZE], uint64_t first_block,
+                    size_t size) {
+#if defined(__x86_64__)
+    if (has_vaes()) return aes_ctr_vaes(in, out, keys, first_block, size);
+    if (has_aesni()) return aes_ctr_ni(in, out, keys, first_block, size);
+#endif
+    aes256_ctr(keys, keys + AES256_ROUND_KEYS_SIZE, first_block, in, out, size);
+}
+
+void cpu_sha256_blocks(const uint8_t *in, uint8_t *digests, size_t size, size_t block_size) {
+    void (*block_digest)(const uint8_t*, size_t, uint8_t*) = sha256_block_scalar;
+#if defined(__x86_64__)
+    if (has_shani()) block_digest = sha256_block_ni;
+#endif
+    for (size_t pos = 0, b = 0; pos < size; pos += block_size, b++) {
+        block_digest(in + pos, std::min(block_size, size - pos), digests + b * SHA256_DIGEST_SIZE);
+    }
+}
+
+std::vector<CpuKernel> cpu_kernels() {
+    const char *level = simd_name(simd_level());
+    const char *avx2 = simd_level() >= SIMD_AVX2 ? "avx2" : "scalar";
+    return {{"dummy_kernel", "cpu_copy", level},
+            {"lz4_compress_kernel", "lz4b_compress", "scalar"},
+            {"lz4_decompress_kernel", "lz4b_decompress", "scalar"},
+            {"aes256_ctr_kernel", "cpu_aes256_ctr", has_vaes() ? "vaes" : has_aesni() ? "aes-ni" : "scalar"},
+            {"sha256_blocks_kernel", "cpu_sha256_blocks", has_shani() ? "sha-ni" : "scalar"},
+            {"filter_kernel", "cpu_filter", level},
+            {"zonemap_kernel", "cpu_zonemap", level},
+            {"bloom_build_kernel", "BloomIndex::add_records", "scalar"},
+            {"grep_kernel", "grep_avx2 / grep_scalar", avx2},
+            {"aggregate_kernel", "aggregate_records", "scalar"},
+            {"sort_kernel", "sort_model", "scalar"},
+            {"topk_kernel", "summarize_records", "scalar"},
+            {"quantile_kernel", "summarize_records", "scalar"},
+            {"parse_kernel", "parse_avx2 / parse_scalar", avx2},
+            {"transpose_kernel", "transpose_records", "scalar"}};
+}
@@ -0,0 +1,68 @@
+/**
+ * @brief Host versions of the pipeline kernels with runtime SIMD dispatch, the CPU baseline
+ *        an offload is measured against.
+ *
+ * Each cpu_* function writes exactly what its kernel of src/pipeline_kernel.cpp writes, with
+ * AVX-512, AVX2 or scalar code picked at run time from the CPU flags. The AVX2 level also
+ * enables AES-NI and SHA-NI, the AVX-512 level VAES. simd_set_level() caps the level so the
+ * variants can be compared on one machine. Kernels without a data parallel formulation
+ * (LZ4, sort, aggregation, sketches, Bloom filters, transposition) keep their scalar host
+ * reference, cpu_kernels() lists what runs for each kernel.
+ */
+#ifndef SIMD_H_
+#define SIMD_H_
+
+#include "aes.h"
+#include "fingerprint.h"
+#include "filter.h"
+#include "zonemap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_AVX2 = 1, SIMD_AVX512 = 2 };
+
+// Best level of this CPU
+SimdLevel simd_detect();
+
+// Level in use : the detected one, capped by simd_set_level()
+SimdLevel simd_level();
+void simd_set_level(SimdLevel cap);
+
+const char *simd_name(SimdLevel level);
+
+// "auto", "scalar", "avx2" or "avx512", returns false on other names
+bool simd_parse(const std::string& name, SimdLevel& level);
+
+// dummy_kernel : copy `words` 32-bit words
+void cpu_copy(uint32_t *dst, const uint32_t *src, size_t words);
+
+/**
+ * filter_kernel : bit r % 32 of bitmap[r / 32] set when record r matches the conjunction,
+ * the matching records compacted in rows unless it is null. Returns the match count.
+ */
+uint32_t cpu_filter(const uint8_t *in, uint8_t *rows, uint32_t *bitmap, const FilterPredicate *predicates,
+                    uint32_t num_predicates, uint32_t record_size, uint32_t num_records);
+
+// zonemap_kernel : one ZoneEntry per block of `block_records` records
+void cpu_zonemap(const uint8_t *in, ZoneEntry *zones, uint32_t record_size, uint32_t column_offset, uint32_t type,
+                 uint32_t num_records, uint32_t block_records);
+
+// aes256_ctr_kernel, keys being the round keys followed by the IV
+void cpu_aes256_ctr(const uint8_t *in, uint8_t *out, const uint8_t keys[AES256_KERNEL_KEYS_SIZE], uint64_t first_block,
+                    size_t size);
+
+// sha256_blocks_kernel : SHA256_DIGEST_SIZE bytes per `block_size` block, the last one may be shorter
+void cpu_sha256_blocks(const uint8_t *in, uint8_t *digests, size_t size, size_t block_size);
+
+struct CpuKernel {
+    const char *kernel;   // in src/pipeline_kernel.cpp
+    const char *function; // host equivalent
+    const char *variant;  // code it runs at the current level
+};
+
+std::vector<CpuKernel> cpu_kernels();
+
+#endif /* SIMD_H_ */
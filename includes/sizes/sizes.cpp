@@ -0,0 +1,40 @@
+#include "sizes.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+
+size_t parse_size(const std::string& str) {
+    size_t pos = 0;
+    unsigned long long value = std::stoull(str, &pos);
+    if (pos < str.size()) {
+        switch (toupper(str[pos])) {
+        case 'T': value <<= 10; // fall through
+        case 'G': value <<= 10; // fall through
+        case 'M': value <<= 10; // fall through
+        case 'K': value <<= 10; break;
+        default:
+            std::cerr << "ERROR: invalid size " << str << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    return value;
+}
+
+std::vector<std::string> split_list(const std::string& str) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start < str.size()) {
+        size_t end = str.find(',', start);
+        if (end == std::string::npos) end = str.size();
+        items.push_back(str.substr(start, end - start));
+        start = end + 1;
+    }
+    return items;
+}
+
+std::vector<size_t> parse_size_list(const std::string& str) {
+    std::vector<size_t> sizes;
+    for (const std::string& item : split_list(str)) sizes.push_back(parse_size(item));
+    return sizes;
+}
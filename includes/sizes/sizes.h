@@ -0,0 +1,22 @@
+/**
+ * @brief Sizes and lists of the command line switches, shared by the benchmark binaries.
+ *
+ * Sizes take an optional binary suffix (K, M, G, T), lists are comma separated.
+ */
+#ifndef SIZES_H_
+#define SIZES_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Parse a size with an optional binary suffix (K, M, G, T), e.g. "128K" or "64G", exits when invalid
+size_t parse_size(const std::string& str);
+
+// Split a comma separated list, e.g. "key,price"
+std::vector<std::string> split_list(const std::string& str);
+
+// Parse a comma separated list of sizes, e.g. "4K,64K,1M"
+std::vector<size_t> parse_size_list(const std::string& str);
+
+#endif /* SIZES_H_ */
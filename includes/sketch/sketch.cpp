@@ -0,0 +1,123 @@
+#include "sketch.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+// Chunk streamed through the p2p bo per pair of kernel runs
+static const size_t SKETCH_CHUNK = 256 << 20;
+static const size_t SKETCH_ALIGN = 4096;
+
+void summarize_records(const uint8_t *records, size_t size, size_t record_size, const Column& column,
+                       uint64_t first_row, uint32_t k, TopKEntry *heap, KllSketch *sketch) {
+    uint64_t row = first_row;
+    for (size_t pos = 0; pos + record_size <= size; pos += record_size, row++) {
+        uint64_t key = sort_key(records + pos + column.offset, column.type);
+        if (heap) topk_push(heap, row, k, {key, row});
+        kll_insert(sketch, key);
+    }
+}
+
+std::vector<TopKEntry> sorted_top(const TopKEntry *heap, size_t count) {
+    std::vector<TopKEntry> top(heap, heap + count);
+    std::sort(top.begin(), top.end(), [](const TopKEntry& a, const TopKEntry& b) { return topk_better(&a, &b); });
+    return top;
+}
+
+void kll_merge(KllSketch& into, const KllSketch& other) {
+    for (uint32_t h = 0; h < KLL_LEVELS; h++) {
+        for (uint32_t i = 0; i < other.sizes[h]; i++) kll_add(&into, h, other.items[h][i]);
+    }
+    into.count += other.count;
+}
+
+// Items of the sketch with their weights, sorted
+static std::vector<std::pair<uint64_t, uint64_t>> weighted_items(const KllSketch& sketch) {
+    std::vector<std::pair<uint64_t, uint64_t>> items;
+    for (uint32_t h = 0; h < KLL_LEVELS; h++) {
+        for (uint32_t i = 0; i < sketch.sizes[h]; i++) items.push_back({sketch.items[h][i], 1ull << h});
+    }
+    std::sort(items.begin(), items.end());
+    return items;
+}
+
+uint64_t kll_quantile(const KllSketch& sketch, double q) {
+    std::vector<std::pair<uint64_t, uint64_t>> items = weighted_items(sketch);
+    if (items.empty()) return 0;
+    uint64_t total = 0;
+    for (const auto& item : items) total += item.second;
+    double target = q * total;
+    uint64_t below = 0;
+    for (const auto& item : items) {
+        below += item.second;
+        if (below > target) return item.first;
+    }
+    return items.back().first;
+}
+
+double kll_rank(const KllSketch& sketch, uint64_t key) {
+    uint64_t total = 0, below = 0;
+    for (uint32_t h = 0; h < KLL_LEVELS; h++) {
+        for (uint32_t i = 0; i < sketch.sizes[h]; i++) {
+            total += 1ull << h;
+            if (sketch.items[h][i] < key) below += 1ull << h;
+        }
+    }
+    return total == 0 ? 0 : (double)below / total;
+}
+
+double decode_key(uint64_t key, FilterType type) {
+    if (type == FILTER_INT32) return (double)(int32_t)(uint32_t)(key ^ 0x80000000ull);
+    if (type == FILTER_INT64) return (double)(int64_t)(key ^ 0x8000000000000000ull);
+    uint64_t bits = (key >> 63) ? key ^ 0x8000000000000000ull : ~key;
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+Summarizer::Summarizer(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map, uint32_t k)
+    : mTopKKernel(device, uuid, "topk_kernel"), mQuantileKernel(device, uuid, "quantile_kernel"), mBo(p2p_bo),
+      mMap((char*)p2p_map), mK(k) {
+    if (k == 0 || k > TOPK_MAX) {
+        std::cerr << "ERROR: top-K needs 1 to " << TOPK_MAX << " entries" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    mHeapBo = xrt::bo(device, k * sizeof(TopKEntry), mTopKKernel.group_id(1));
+    mSketchBo = xrt::bo(device, sizeof(KllSketch), mQuantileKernel.group_id(1));
+}
+
+SummaryResult Summarizer::summarize(const std::string& file, const Schema& schema, const std::string& column,
+                                    size_t size) {
+    SummaryResult result = SummaryResult();
+    const Column& key = schema.column(column);
+
+    // Chunks hold whole records and keep the P2P reads 4 KiB aligned
+    size_t record_size = schema.record_size;
+    ChunkReader input(file, record_chunk(record_size, std::min(SKETCH_CHUNK, mBo.size()), SKETCH_ALIGN), size, SKETCH_ALIGN);
+
+    // Both reductions read the same chunk, the first run of each resets its state
+    for (size_t offset = 0;; offset += input.chunk()) {
+        size_t len = input.read_chunk(mMap, offset);
+        unsigned int records = len / record_size;
+        auto topk_run = mTopKKernel(mBo, mHeapBo, (unsigned int)record_size, key.offset, (unsigned int)key.type, records,
+                                    (unsigned long long)result.records, mK);
+        auto quantile_run = mQuantileKernel(mBo, mSketchBo, (unsigned int)record_size, key.offset, (unsigned int)key.type,
+                                            records, (unsigned int)(offset == 0));
+        topk_run.wait();
+        quantile_run.wait();
+        result.records += records;
+        result.bytes_scanned += len;
+        if (input.last(offset)) break;
+    }
+
+    // Only the summaries cross PCIe
+    size_t heap_count = std::min<uint64_t>(mK, result.records);
+    if (heap_count > 0) mHeapBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, heap_count * sizeof(TopKEntry), 0);
+    mSketchBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+    result.top = sorted_top(mHeapBo.map<TopKEntry*>(), heap_count);
+    result.sketch.reset(new KllSketch(*mSketchBo.map<KllSketch*>()));
+    result.bytes_to_host = heap_count * sizeof(TopKEntry) + sizeof(KllSketch);
+    return result;
+}
@@ -0,0 +1,74 @@
+/**
+ * @brief Streaming summaries of a column next to the drive : top-K records by the column
+ *        and a mergeable quantile sketch of its values.
+ *
+ * summarize() streams the file through the p2p bo with P2P preads, topk_kernel and
+ * quantile_kernel both reduce each chunk into their state in device memory, and only the
+ * K entries and the sketch are synced to the host.
+ */
+#ifndef SKETCH_H_
+#define SKETCH_H_
+
+#include "sketch_state.h"
+#include "scan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "experimental/xrt_bo.h"
+#include "experimental/xrt_device.h"
+#include "experimental/xrt_kernel.h"
+
+struct SummaryResult {
+    uint64_t records;
+    uint64_t bytes_scanned;
+    uint64_t bytes_to_host;
+    std::vector<TopKEntry> top;         // best first
+    std::unique_ptr<KllSketch> sketch;
+};
+
+/**
+ * Host model of the kernels : add `size` bytes of records, numbered from first_row, to the
+ * heap of the best k entries (unless null) and to the sketch. Gives the same state as the
+ * kernels for a sketch started by kll_init(sketch, KLL_SEED).
+ */
+void summarize_records(const uint8_t *records, size_t size, size_t record_size, const Column& column,
+                       uint64_t first_row, uint32_t k, TopKEntry *heap, KllSketch *sketch);
+
+// Entries of a heap filled by topk_push(), best first
+std::vector<TopKEntry> sorted_top(const TopKEntry *heap, size_t count);
+
+// Add the values summarized by `other` to `into`
+void kll_merge(KllSketch& into, const KllSketch& other);
+
+// Key at rank q (0 to 1) of the summarized values
+uint64_t kll_quantile(const KllSketch& sketch, double q);
+
+// Estimated fraction of the summarized values below `key`
+double kll_rank(const KllSketch& sketch, uint64_t key);
+
+// Column value of a sort_key()
+double decode_key(uint64_t key, FilterType type);
+
+class Summarizer {
+public:
+    // Top k records, k up to TOPK_MAX
+    Summarizer(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map, uint32_t k);
+
+    // Summarize the `column` of `size` bytes of `file` (the whole file when 0)
+    SummaryResult summarize(const std::string& file, const Schema& schema, const std::string& column, size_t size = 0);
+
+private:
+    xrt::kernel mTopKKernel;
+    xrt::kernel mQuantileKernel;
+    xrt::bo mBo;
+    char *mMap;
+    uint32_t mK;
+    xrt::bo mHeapBo;
+    xrt::bo mSketchBo;
+};
+
+#endif /* SKETCH_H_ */
@@ -0,0 +1,126 @@
+/**
+ * @brief Top-K heap and KLL-style quantile sketch shared by the host summary API and the
+ *        topk_kernel / quantile_kernel reductions.
+ *
+ * Both summarize one int32, int64 or float64 column (FilterType) through its order
+ * preserving key (sort_key()). The state lives in device memory across the kernel runs of
+ * a file and only it is synced to the host.
+ */
+#ifndef SKETCH_STATE_H_
+#define SKETCH_STATE_H_
+
+#include "sort_network.h"
+
+#include <stdint.h>
+
+#define TOPK_MAX 4096
+
+struct TopKEntry {
+    uint64_t key; // sort_key() of the column
+    uint64_t row; // record number in the file
+};
+
+// Larger keys rank first, the earlier row on ties so the top K is deterministic
+static inline int topk_better(const struct TopKEntry *a, const struct TopKEntry *b) {
+    return a->key > b->key || (a->key == b->key && a->row < b->row);
+}
+
+// Offer an entry to the heap of `count` of the best `k` entries seen, its root is the worst
+static inline void topk_push(struct TopKEntry *heap, uint64_t count, uint32_t k, struct TopKEntry entry) {
+    uint32_t i;
+    if (count < k) {
+        i = (uint32_t)count;
+        while (i > 0 && topk_better(&heap[(i - 1) / 2], &entry)) {
+            heap[i] = heap[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        heap[i] = entry;
+        return;
+    }
+    if (!topk_better(&entry, &heap[0])) return;
+    i = 0;
+    while (2 * i + 1 < k) {
+        uint32_t c = 2 * i + 1;
+        if (c + 1 < k && topk_better(&heap[c], &heap[c + 1])) c++;
+        if (!topk_better(&entry, &heap[c])) break;
+        heap[i] = heap[c];
+        i = c;
+    }
+    heap[i] = entry;
+}
+
+/**
+ * Compactors of equal capacity : items at level h stand for 2^h values. A full level is
+ * sorted and every other item, from a random first one, moves up a level. Sketches of
+ * parts of a file merge by adding the items of one to the levels of the other.
+ */
+#define KLL_LEVELS 32
+#define KLL_CAPACITY 512
+#define KLL_SEED 0x9E3779B97F4A7C15ull
+
+struct KllSketch {
+    uint64_t items[KLL_LEVELS][KLL_CAPACITY];
+    uint32_t sizes[KLL_LEVELS];
+    uint64_t count; // values summarized
+    uint64_t rng;   // xorshift state of the compactions
+};
+
+static inline void kll_init(struct KllSketch *s, uint64_t seed) {
+    for (uint32_t h = 0; h < KLL_LEVELS; h++) s->sizes[h] = 0;
+    s->count = 0;
+    s->rng = seed | 1;
+}
+
+static inline void kll_sort(uint64_t *items, uint32_t n) {
+    static const uint32_t gaps[7] = {301, 132, 57, 23, 10, 4, 1};
+    for (uint32_t g = 0; g < 7; g++) {
+        uint32_t gap = gaps[g];
+        for (uint32_t i = gap; i < n; i++) {
+            uint64_t v = items[i];
+            uint32_t j = i;
+            while (j >= gap && items[j - gap] > v) {
+                items[j] = items[j - gap];
+                j -= gap;
+            }
+            items[j] = v;
+        }
+    }
+}
+
+// Move every other item of level h up, an odd one out stays
+static inline void kll_compact(struct KllSketch *s, uint32_t h) {
+    uint64_t *items = s->items[h];
+    uint32_t n = s->sizes[h];
+    kll_sort(items, n);
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 7;
+    s->rng ^= s->rng << 17;
+    uint32_t first = (uint32_t)(s->rng & 1);
+    uint32_t up = s->sizes[h + 1];
+    for (uint32_t i = 0; i < n / 2; i++) s->items[h + 1][up + i] = items[2 * i + first];
+    s->sizes[h + 1] = up + n / 2;
+    if (n & 1) items[0] = items[n - 1];
+    s->sizes[h] = n & 1;
+}
+
+/**
+ * Add an item of weight 2^h. Making room compacts the full levels from the first one with
+ * room for half a level downwards, so no level ever overflows. The sketch holds up to
+ * KLL_CAPACITY * 2^(KLL_LEVELS - 1) values, items past that are dropped.
+ */
+static inline void kll_add(struct KllSketch *s, uint32_t h, uint64_t item) {
+    if (s->sizes[h] == KLL_CAPACITY) {
+        uint32_t t = h + 1;
+        while (t < KLL_LEVELS && s->sizes[t] > KLL_CAPACITY / 2) t++;
+        if (t == KLL_LEVELS) return;
+        for (uint32_t lv = t; lv > h; lv--) kll_compact(s, lv - 1);
+    }
+    s->items[h][s->sizes[h]++] = item;
+}
+
+static inline void kll_insert(struct KllSketch *s, uint64_t item) {
+    kll_add(s, 0, item);
+    s->count++;
+}
+
+#endif /* SKETCH_STATE_H_ */
@@ -0,0 +1,89 @@
+#include "staging.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#include <unistd.h>
+
+static double seconds_since(const std::chrono::steady_clock::time_point& start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+double StagingResult::concurrency() const {
+    return wall > 0 ? (busy.fill + busy.sync + busy.write) / wall : 0;
+}
+
+double StagingResult::overlap() const {
+    double slowest = std::max(busy.fill, std::max(busy.sync, busy.write));
+    double others = busy.fill + busy.sync + busy.write - slowest;
+    if (others <= 0) return 0;
+    return std::min(1.0, std::max(0.0, (busy.fill + busy.sync + busy.write - wall) / others));
+}
+
+StagingPipeline::StagingPipeline(xrt::bo bo, char *bo_map, size_t chunk, int buffers) : mChunk(chunk) {
+    for (int b = 0; b < buffers; b++) {
+        mSlots.push_back({xrt::bo(bo, chunk, b * chunk), bo_map + b * chunk, SLOT_FREE, 0});
+    }
+}
+
+void StagingPipeline::wait_for(Slot& slot, SlotState state) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCond.wait(lock, [&] { return slot.state == state; });
+}
+
+void StagingPipeline::set(Slot& slot, SlotState state) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        slot.state = state;
+    }
+    mCond.notify_all();
+}
+
+StagingResult StagingPipeline::write(int fd, off_t offset, size_t size, const std::function<void(size_t, char*, size_t)>& fill) {
+    StagingResult result = StagingResult();
+    size_t chunks = (size + mChunk - 1) / mChunk;
+    size_t buffers = mSlots.size();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::thread sync_thread([&] {
+        for (size_t c = 0; c < chunks; c++) {
+            Slot& slot = mSlots[c % buffers];
+            wait_for(slot, SLOT_FILLED);
+            std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+            slot.bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, slot.len, 0);
+            result.busy.sync += seconds_since(t);
+            set(slot, SLOT_SYNCED);
+        }
+    });
+    std::thread write_thread([&] {
+        for (size_t c = 0; c < chunks; c++) {
+            Slot& slot = mSlots[c % buffers];
+            wait_for(slot, SLOT_SYNCED);
+            std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+            // After a failure the chunks are still drained so the other steps finish
+            if (result.error == 0 && pwrite(fd, slot.map, slot.len, offset + c * mChunk) != (ssize_t)slot.len) {
+                result.error = errno != 0 ? errno : EIO;
+            }
+            result.busy.write += seconds_since(t);
+            set(slot, SLOT_FREE);
+        }
+    });
+
+    for (size_t c = 0; c < chunks; c++) {
+        Slot& slot = mSlots[c % buffers];
+        wait_for(slot, SLOT_FREE);
+        std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+        slot.len = std::min(mChunk, size - c * mChunk);
+        fill(c, slot.map, slot.len);
+        result.busy.fill += seconds_since(t);
+        set(slot, SLOT_FILLED);
+    }
+    sync_thread.join();
+    write_thread.join();
+
+    result.wall = seconds_since(start);
+    result.bytes = size;
+    return result;
+}
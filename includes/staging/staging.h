@@ -0,0 +1,75 @@
+/**
+ * @brief Staged host to SSD writes through several buffers of the p2p bo, so filling,
+ *        bo.sync and the P2P write of different chunks overlap.
+ *
+ * The data goes through `buffers` chunk sized sub-buffers used in turn. The calling thread
+ * fills chunk c in buffer c % buffers, a sync thread runs bo.sync of the chunks filled, and
+ * a write thread P2P writes the chunks synced, then gives the buffer back to the filler.
+ * With one buffer the three steps run one after the other, as in p2p_host_to_ssd.
+ */
+#ifndef STAGING_H_
+#define STAGING_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "experimental/xrt_bo.h"
+
+// Seconds each step spent working, its waits for the other steps excluded
+struct StageTimes {
+    double fill;
+    double sync;
+    double write;
+};
+
+struct StagingResult {
+    double wall; // s
+    StageTimes busy;
+    size_t bytes;
+    int error;   // errno of the first failed pwrite, 0 if none
+
+    // Sum of the busy times over the wall time : 1 when the steps never overlap
+    double concurrency() const;
+
+    // Fraction of the time of all the steps but the slowest one hidden behind it
+    double overlap() const;
+};
+
+class StagingPipeline {
+public:
+    // `buffers` sub-buffers of `chunk` bytes at the start of `bo`, mapped at `bo_map`
+    StagingPipeline(xrt::bo bo, char *bo_map, size_t chunk, int buffers);
+
+    /**
+     * Write `size` bytes to `fd` from `offset`, chunk by chunk. `fill(c, dst, len)` writes
+     * the `len` bytes of chunk c into the buffer at `dst`.
+     */
+    StagingResult write(int fd, off_t offset, size_t size, const std::function<void(size_t, char*, size_t)>& fill);
+
+    int buffers() const { return mSlots.size(); }
+    size_t chunk() const { return mChunk; }
+
+private:
+    enum SlotState { SLOT_FREE, SLOT_FILLED, SLOT_SYNCED };
+    struct Slot {
+        xrt::bo bo;
+        char *map;
+        SlotState state;
+        size_t len;
+    };
+
+    void wait_for(Slot& slot, SlotState state);
+    void set(Slot& slot, SlotState state);
+
+    size_t mChunk;
+    std::vector<Slot> mSlots;
+    std::mutex mMutex;
+    std::condition_variable mCond;
+};
+
+#endif /* STAGING_H_ */
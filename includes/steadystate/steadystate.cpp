@@ -0,0 +1,52 @@
+#include "steadystate.h"
+
+#include <algorithm>
+#include <cmath>
+
+SteadyStateDetector::SteadyStateDetector(size_t window, double range_pct, double slope_pct)
+    : mWindow(window < 2 ? 2 : window), mRangePct(range_pct), mSlopePct(slope_pct) {}
+
+bool SteadyStateDetector::add(double value) {
+    mValues.push_back(value);
+    return reached();
+}
+
+bool SteadyStateDetector::reached() const {
+    if (mValues.size() < mWindow) return false;
+    return range_pct() <= mRangePct && slope_pct() <= mSlopePct;
+}
+
+double SteadyStateDetector::average() const {
+    if (mValues.empty()) return 0;
+    size_t n = std::min(mWindow, mValues.size());
+    double sum = 0;
+    for (size_t i = mValues.size() - n; i < mValues.size(); i++) sum += mValues[i];
+    return sum / n;
+}
+
+double SteadyStateDetector::range_pct() const {
+    double avg = average();
+    if (avg == 0) return 0;
+    size_t n = std::min(mWindow, mValues.size());
+    auto first = mValues.end() - n;
+    auto minmax = std::minmax_element(first, mValues.end());
+    return (*minmax.second - *minmax.first) * 100 / avg;
+}
+
+double SteadyStateDetector::slope_pct() const {
+    double avg = average();
+    size_t n = std::min(mWindow, mValues.size());
+    if (avg == 0 || n < 2) return 0;
+
+    // Least-squares fit y = a + b*x with x = 0..n-1
+    size_t first = mValues.size() - n;
+    double mean_x = (n - 1) / 2.0;
+    double sxy = 0, sxx = 0;
+    for (size_t i = 0; i < n; i++) {
+        double dx = i - mean_x;
+        sxy += dx * (mValues[first + i] - avg);
+        sxx += dx * dx;
+    }
+    double slope = sxy / sxx;
+    return std::fabs(slope) * (n - 1) * 100 / avg;
+}
@@ -0,0 +1,43 @@
+/**
+ * @brief Steady-state detection following the SNIA Solid State Storage
+ *        Performance Test Specification (PTS).
+ *
+ * A tracking variable (here the write bandwidth of one round) is recorded
+ * round after round. The device is considered in steady state once, over the
+ * last `window` rounds:
+ *   - the max data excursion (max - min) is within `range_pct` % of the
+ *     window average, and
+ *   - the excursion of the least-squares linear fit across the window
+ *     (|slope| * (window - 1)) is within `slope_pct` % of the window average.
+ */
+#ifndef STEADYSTATE_H_
+#define STEADYSTATE_H_
+
+#include <cstddef>
+#include <vector>
+
+class SteadyStateDetector {
+public:
+    SteadyStateDetector(size_t window = 5, double range_pct = 20.0, double slope_pct = 10.0);
+
+    // Record the tracking variable of one round, returns reached()
+    bool add(double value);
+
+    // True once the last `window` rounds satisfy both criteria
+    bool reached() const;
+
+    size_t rounds() const { return mValues.size(); }
+
+    // Statistics over the current measurement window
+    double average() const;
+    double range_pct() const;
+    double slope_pct() const;
+
+private:
+    size_t mWindow;
+    double mRangePct;
+    double mSlopePct;
+    std::vector<double> mValues;
+};
+
+#endif /* STEADYSTATE_H_ */
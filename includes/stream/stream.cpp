@@ -0,0 +1,102 @@
+#include "stream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <unistd.h>
+
+static const size_t STREAM_PAGE = 4096;
+
+// Head of each chunk on the drive
+struct ChunkStamp {
+    uint64_t magic;
+    uint64_t chunk;
+    uint64_t pass;
+};
+
+static const uint64_t STREAM_MAGIC = 0x4d41455254535353ull; // "SSSTREAM"
+
+StreamWindow::StreamWindow(xrt::bo bo, char *bo_map, size_t window, int slots)
+    : mBo(bo), mMap(bo_map), mChunk(window / slots / STREAM_PAGE * STREAM_PAGE), mSlots(slots), mInterval(0) {}
+
+void StreamWindow::set_progress(double interval, const std::function<void(size_t, double)>& progress) {
+    mInterval = interval;
+    mProgress = progress;
+}
+
+StreamResult StreamWindow::write(int fd, size_t size, uint64_t pass) {
+    return run(fd, size, pass, true);
+}
+
+StreamResult StreamWindow::read(int fd, size_t size, uint64_t pass) {
+    return run(fd, size, pass, false);
+}
+
+StreamResult StreamWindow::run(int fd, size_t size, uint64_t pass, bool write) {
+    StreamResult result = StreamResult();
+    size_t chunks = (size + mChunk - 1) / mChunk;
+    std::atomic<size_t> done(0);
+    std::atomic<int> running(mSlots);
+    std::atomic<int> error(0);
+    std::atomic<size_t> mismatches(0);
+
+    std::vector<std::thread> threads;
+    for (int s = 0; s < mSlots; s++) {
+        threads.push_back(std::thread([&, s] {
+            size_t slot_offset = s * mChunk;
+            char *slot = mMap + slot_offset;
+            for (size_t k = s; k < chunks && error == 0; k += mSlots) {
+                size_t len = std::min(mChunk, size - k * mChunk);
+                off_t offset = k * mChunk;
+                ChunkStamp stamp = {STREAM_MAGIC, k, pass};
+                ssize_t ret;
+                if (write) {
+                    memcpy(slot, &stamp, sizeof(stamp));
+                    mBo.sync(XCL_BO_SYNC_BO_TO_DEVICE, STREAM_PAGE, slot_offset);
+                    ret = pwrite(fd, slot, len, offset);
+                } else {
+                    ret = pread(fd, slot, len, offset);
+                    mBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, STREAM_PAGE, slot_offset);
+                    if (ret == (ssize_t)len && memcmp(slot, &stamp, sizeof(stamp)) != 0) mismatches++;
+                }
+                if (ret != (ssize_t)len) {
+                    int expected = 0;
+                    error.compare_exchange_strong(expected, ret < 0 ? errno : EIO);
+                }
+                done += len;
+            }
+            running--;
+        }));
+    }
+
+    // Throughput of each second, sampled from the calling thread
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point second = start, report = start;
+    size_t second_bytes = 0;
+    while (running > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - second >= std::chrono::seconds(1)) {
+            size_t bytes = done;
+            result.per_second.push_back((double)(bytes - second_bytes) / (1024 * 1024) /
+                                        std::chrono::duration<double>(now - second).count());
+            second_bytes = bytes;
+            second = now;
+        }
+        if (mProgress && std::chrono::duration<double>(now - report).count() >= mInterval) {
+            mProgress(done, std::chrono::duration<double>(now - start).count());
+            report = now;
+        }
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.bytes = done;
+    result.error = error;
+    result.mismatches = mismatches;
+    return result;
+}
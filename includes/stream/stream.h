@@ -0,0 +1,61 @@
+/**
+ * @brief Streaming of a file larger than the device memory through a fixed window of the
+ *        p2p bo, reused in turn.
+ *
+ * The window is cut in `slots` chunk sized regions. Chunk k of the file goes through slot
+ * k % slots at file offset k * chunk, so the offsets keep advancing while the same device
+ * memory is reused. Each slot has its own thread and one P2P pread or pwrite in flight, the
+ * number of slots is the queue depth of the stream.
+ *
+ * Every chunk written is stamped with its index and the pass, so a read pass checks that
+ * each chunk came from the right offset of the right pass.
+ */
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "experimental/xrt_bo.h"
+
+struct StreamResult {
+    size_t bytes;
+    double seconds;
+    std::vector<double> per_second; // MiB/s of each whole second of the pass
+    int error;                      // errno of the first failed transfer, 0 if none
+    size_t mismatches;              // chunks read with the wrong stamp
+
+    double throughput() const { return seconds > 0 ? (double)bytes / (1024 * 1024) / seconds : 0; }
+};
+
+class StreamWindow {
+public:
+    // `slots` regions of `window` / `slots` bytes, whole 4 KiB pages, at the start of `bo`
+    StreamWindow(xrt::bo bo, char *bo_map, size_t window, int slots);
+
+    size_t chunk() const { return mChunk; }
+    int slots() const { return mSlots; }
+
+    // Progress callback, called about every `interval` seconds with the bytes done so far
+    void set_progress(double interval, const std::function<void(size_t, double)>& progress);
+
+    // P2P write of the first `size` bytes of `fd`, stamped with `pass`
+    StreamResult write(int fd, size_t size, uint64_t pass);
+
+    // P2P read of the first `size` bytes of `fd`, checking the stamps of `pass`
+    StreamResult read(int fd, size_t size, uint64_t pass);
+
+private:
+    StreamResult run(int fd, size_t size, uint64_t pass, bool write);
+
+    xrt::bo mBo;
+    char *mMap;
+    size_t mChunk;
+    int mSlots;
+    double mInterval;
+    std::function<void(size_t, double)> mProgress;
+};
+
+#endif /* STREAM_H_ */
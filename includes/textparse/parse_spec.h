@@ -0,0 +1,251 @@
+/**
+ * @brief Text to binary column parsing shared by the host parsers and parse_kernel.
+ *
+ * A line of CSV or JSON lines text holds one row of numeric fields (FilterType). Parsers
+ * only have to find the separators, CSV delimiters or JSON ':' ',' '}', and the newlines :
+ * parse_separator() turns the text between two of them into values and emits the row at
+ * the end of the line. Rows are stored column by column, the layout of a ColumnarWriter
+ * group once parse_pack() has moved the columns for the final row count.
+ *
+ * Quoted fields and string values are not supported. Doubles are correctly rounded up to
+ * 15 significant digits.
+ */
+#ifndef PARSE_SPEC_H_
+#define PARSE_SPEC_H_
+
+#include "columnar.h"
+
+#include <stdint.h>
+
+#define PARSE_CSV 0
+#define PARSE_JSON 1
+#define PARSE_MAX_FIELDS 16
+
+struct ParseSpec {
+    uint32_t format;    // PARSE_CSV or PARSE_JSON
+    uint32_t num_fields;
+    uint32_t delimiter; // CSV
+    uint32_t reserved;
+    uint32_t types[PARSE_MAX_FIELDS];             // FilterType of each column
+    char names[PARSE_MAX_FIELDS][COLF_NAME_SIZE]; // JSON keys, NUL terminated
+};
+
+// Status words written by the parsers
+#define PARSE_STATUS_ROWS 0
+#define PARSE_STATUS_CONSUMED 1 // bytes up to the end of the last line parsed
+#define PARSE_STATUS_BAD 2      // lines dropped because they did not parse
+
+#define PARSE_NO_KEY -1
+#define PARSE_UNKNOWN_KEY -2 // its value is skipped
+
+struct ParseState {
+    uint64_t values[PARSE_MAX_FIELDS];
+    uint32_t seen;    // JSON fields set in the line, bit per field
+    int32_t field;    // CSV field, JSON field of the last key, PARSE_NO_KEY or PARSE_UNKNOWN_KEY
+    uint32_t invalid; // the line does not parse
+    uint32_t blank;   // nothing but spaces in the line so far
+    uint32_t rows;
+    uint32_t bad_lines;
+};
+
+static inline uint32_t parse_width(uint32_t type) { return type == FILTER_INT32 ? 4 : 8; }
+
+// Offset of column c in the output of `rows` rows, columns start COLF_ALIGN aligned
+static inline uint64_t parse_column_offset(const struct ParseSpec *spec, uint32_t rows, uint32_t c) {
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < c && i < spec->num_fields; i++) {
+        offset += ((uint64_t)rows * parse_width(spec->types[i]) + COLF_ALIGN - 1) / COLF_ALIGN * COLF_ALIGN;
+    }
+    return offset;
+}
+
+// Shortest line with all the fields, which bounds the rows of a chunk of text
+static inline uint32_t parse_min_line(const struct ParseSpec *spec) {
+    if (spec->format == PARSE_CSV) return 2 * spec->num_fields;
+    // {"k":1,"l":2}\n
+    uint32_t bytes = 2;
+    for (uint32_t f = 0; f < spec->num_fields; f++) {
+        uint32_t name = 0;
+        while (name < COLF_NAME_SIZE && spec->names[f][name]) name++;
+        bytes += name + 5;
+    }
+    return bytes;
+}
+
+static inline int parse_is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+static inline int parse_is_separator(const struct ParseSpec *spec, char c) {
+    if (c == '\n') return 1;
+    if (spec->format == PARSE_CSV) return c == (char)spec->delimiter;
+    return c == ':' || c == ',' || c == '}';
+}
+
+// Number in text[begin, end) as the bits of a value of `type`, 0 when it does not parse
+static inline int parse_value(const char *text, uint32_t begin, uint32_t end, uint32_t type, uint64_t *value) {
+    static const double pow10[23] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    while (begin < end && parse_is_space(text[begin])) begin++;
+    while (end > begin && parse_is_space(text[end - 1])) end--;
+    int negative = begin < end && text[begin] == '-';
+    if (negative || (begin < end && text[begin] == '+')) begin++;
+
+    uint64_t mantissa = 0;
+    int32_t exponent = 0;
+    uint32_t digits = 0, significant = 0;
+    for (; begin < end && text[begin] >= '0' && text[begin] <= '9'; begin++, digits++) {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (text[begin] - '0');
+            if (mantissa) significant++;
+        } else {
+            if (type != FILTER_FLOAT64) return 0;
+            exponent++;
+        }
+    }
+    if (type != FILTER_FLOAT64) {
+        if (digits == 0 || begin != end) return 0;
+        if (type == FILTER_INT32 && mantissa > (negative ? 0x80000000ull : 0x7FFFFFFFull)) return 0;
+        if (type == FILTER_INT64 && mantissa > (negative ? 0x8000000000000000ull : 0x7FFFFFFFFFFFFFFFull)) return 0;
+        uint64_t v = negative ? 0 - mantissa : mantissa;
+        *value = type == FILTER_INT32 ? (v & 0xFFFFFFFFull) : v;
+        return 1;
+    }
+
+    if (begin < end && text[begin] == '.') {
+        for (begin++; begin < end && text[begin] >= '0' && text[begin] <= '9'; begin++, digits++) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (text[begin] - '0');
+                if (mantissa) significant++;
+                exponent--;
+            }
+        }
+    }
+    if (digits == 0) return 0;
+    if (begin < end && (text[begin] == 'e' || text[begin] == 'E')) {
+        begin++;
+        int exp_negative = begin < end && text[begin] == '-';
+        if (exp_negative || (begin < end && text[begin] == '+')) begin++;
+        int32_t e = 0;
+        uint32_t exp_digits = 0;
+        for (; begin < end && text[begin] >= '0' && text[begin] <= '9'; begin++, exp_digits++) {
+            if (e < 100000) e = e * 10 + (text[begin] - '0');
+        }
+        if (exp_digits == 0) return 0;
+        exponent += exp_negative ? -e : e;
+    }
+    if (begin != end) return 0;
+
+    // One multiplication or division by an exact power of ten is correctly rounded
+    double d = (double)mantissa;
+    for (; exponent > 22; exponent -= 22) d *= pow10[22];
+    for (; exponent < -22; exponent += 22) d /= pow10[22];
+    d = exponent >= 0 ? d * pow10[exponent] : d / pow10[-exponent];
+    if (negative) d = -d;
+    union {
+        double d;
+        uint64_t u;
+    } bits;
+    bits.d = d;
+    *value = bits.u;
+    return 1;
+}
+
+static inline void parse_line_begin(const struct ParseSpec *spec, struct ParseState *state) {
+    state->seen = 0;
+    state->field = spec->format == PARSE_CSV ? 0 : PARSE_NO_KEY;
+    state->invalid = 0;
+    state->blank = 1;
+}
+
+static inline void parse_begin(const struct ParseSpec *spec, struct ParseState *state) {
+    parse_line_begin(spec, state);
+    state->rows = 0;
+    state->bad_lines = 0;
+}
+
+// JSON field of the key in text[begin, end), such as {"price" or  "id"
+static inline int32_t parse_key(const struct ParseSpec *spec, const char *text, uint32_t begin, uint32_t end) {
+    while (begin < end && (parse_is_space(text[begin]) || text[begin] == '{')) begin++;
+    while (end > begin && parse_is_space(text[end - 1])) end--;
+    if (end - begin < 2 || text[begin] != '"' || text[end - 1] != '"') return PARSE_UNKNOWN_KEY;
+    begin++;
+    end--;
+    for (uint32_t f = 0; f < spec->num_fields; f++) {
+        uint32_t i = 0;
+        while (begin + i < end && i < COLF_NAME_SIZE && spec->names[f][i] == text[begin + i]) i++;
+        if (begin + i == end && i < COLF_NAME_SIZE && spec->names[f][i] == 0) return f;
+    }
+    return PARSE_UNKNOWN_KEY;
+}
+
+/**
+ * Handle the separator `c` at text[end] ending the field text[begin, end). At the end of a
+ * valid line its row is stored in out, laid out for max_rows rows. Returns 1 at the end of
+ * a line.
+ */
+static inline int parse_separator(const struct ParseSpec *spec, struct ParseState *state, const char *text,
+                                  uint32_t begin, uint32_t end, char c, unsigned char *out, uint32_t max_rows) {
+    uint32_t b = begin;
+    while (b < end && parse_is_space(text[b])) b++;
+    int empty = b == end;
+    if (!empty) state->blank = 0;
+
+    if (spec->format == PARSE_CSV) {
+        if (!(c == '\n' && state->blank)) {
+            if (state->field >= (int32_t)spec->num_fields ||
+                !parse_value(text, begin, end, spec->types[state->field], &state->values[state->field])) {
+                state->invalid = 1;
+            }
+            state->field++;
+        }
+    } else if (c == ':') {
+        if (state->field != PARSE_NO_KEY) state->invalid = 1;
+        state->field = parse_key(spec, text, begin, end);
+    } else if (state->field != PARSE_NO_KEY) {
+        // A value, ended by ',' '}' or the newline
+        if (state->field >= 0) {
+            if (parse_value(text, begin, end, spec->types[state->field], &state->values[state->field])) {
+                state->seen |= 1u << state->field;
+            } else {
+                state->invalid = 1;
+            }
+        }
+        state->field = PARSE_NO_KEY;
+    } else if (!empty) {
+        state->invalid = 1;
+    }
+    if (c != '\n') return 0;
+
+    if (!state->blank) {
+        int complete = spec->format == PARSE_CSV ? state->field == (int32_t)spec->num_fields
+                                                 : state->seen == (1u << spec->num_fields) - 1;
+        if (state->invalid || !complete) {
+            state->bad_lines++;
+        } else {
+            for (uint32_t f = 0; f < spec->num_fields; f++) {
+                uint32_t width = parse_width(spec->types[f]);
+                unsigned char *dst = out + parse_column_offset(spec, max_rows, f) + (uint64_t)state->rows * width;
+                for (uint32_t i = 0; i < width; i++) dst[i] = (unsigned char)(state->values[f] >> (8 * i));
+            }
+            state->rows++;
+        }
+    }
+    parse_line_begin(spec, state);
+    return 1;
+}
+
+// Move the columns laid out for max_rows rows to their place for `rows` rows, zero padded
+static inline void parse_pack(const struct ParseSpec *spec, unsigned char *out, uint32_t max_rows, uint32_t rows) {
+    for (uint32_t c = 1; c < spec->num_fields; c++) {
+        uint64_t from = parse_column_offset(spec, max_rows, c);
+        uint64_t to = parse_column_offset(spec, rows, c);
+        uint64_t bytes = (uint64_t)rows * parse_width(spec->types[c]);
+        for (uint64_t i = 0; i < bytes && to != from; i++) out[to + i] = out[from + i];
+    }
+    for (uint32_t c = 0; c < spec->num_fields; c++) {
+        uint64_t end = parse_column_offset(spec, rows, c) + (uint64_t)rows * parse_width(spec->types[c]);
+        uint64_t next = parse_column_offset(spec, rows, c + 1);
+        for (uint64_t i = end; i < next; i++) out[i] = 0;
+    }
+}
+
+#endif /* PARSE_SPEC_H_ */
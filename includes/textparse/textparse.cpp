@@ -0,0 +1,283 @@
+#include "textparse.h"
+#include "columnar.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Text per kernel run, the same on the host so both write the same groups
+static const size_t PARSE_CHUNK = 128 << 20;
+
+ParseSpec parse_spec(uint32_t format, const std::vector<ColfColumn>& columns, char delimiter) {
+    if (columns.empty() || columns.size() > PARSE_MAX_FIELDS) {
+        std::cerr << "ERROR: parsing needs 1 to " << PARSE_MAX_FIELDS << " columns" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    ParseSpec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.format = format;
+    spec.num_fields = columns.size();
+    spec.delimiter = (unsigned char)delimiter;
+    for (size_t f = 0; f < columns.size(); f++) {
+        spec.types[f] = columns[f].type;
+        memcpy(spec.names[f], columns[f].name, COLF_NAME_SIZE);
+    }
+    return spec;
+}
+
+std::vector<ColfColumn> parse_columns(const ParseSpec& spec) {
+    std::vector<ColfColumn> columns;
+    for (uint32_t f = 0; f < spec.num_fields; f++) {
+        columns.push_back(colf_column(std::string(spec.names[f], strnlen(spec.names[f], COLF_NAME_SIZE)),
+                                      (FilterType)spec.types[f]));
+    }
+    return columns;
+}
+
+uint32_t parse_max_rows(const ParseSpec& spec, size_t chunk) {
+    return chunk / parse_min_line(&spec) + 1;
+}
+
+size_t parse_out_bytes(const ParseSpec& spec, size_t chunk) {
+    return parse_column_offset(&spec, parse_max_rows(spec, chunk), spec.num_fields);
+}
+
+// Last line of the chunk when it has no newline, then the columns are packed
+static void parse_finish(const ParseSpec& spec, ParseState& state, const char *text, uint32_t line, uint32_t consumed,
+                         uint32_t size, bool final, bool full, uint8_t *out, uint32_t max_rows, uint32_t status[3]) {
+    if (final && !full && consumed < size) {
+        parse_separator(&spec, &state, text, line, size, '\n', out, max_rows);
+        consumed = size;
+    }
+    parse_pack(&spec, out, max_rows, state.rows);
+    status[PARSE_STATUS_ROWS] = state.rows;
+    status[PARSE_STATUS_CONSUMED] = consumed;
+    status[PARSE_STATUS_BAD] = state.bad_lines;
+}
+
+void parse_scalar(const ParseSpec& spec, const char *text, uint32_t start, uint32_t size, bool final, uint8_t *out,
+                  uint32_t max_rows, uint32_t status[3]) {
+    ParseState state;
+    parse_begin(&spec, &state);
+    uint32_t field = start, consumed = start;
+    bool full = false;
+    for (uint32_t pos = start; pos < size && !full; pos++) {
+        char c = text[pos];
+        if (!parse_is_separator(&spec, c)) continue;
+        if (parse_separator(&spec, &state, text, field, pos, c, out, max_rows)) {
+            consumed = pos + 1;
+            full = state.rows == max_rows;
+        }
+        field = pos + 1;
+    }
+    parse_finish(spec, state, text, field, consumed, size, final, full, out, max_rows, status);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static void parse_avx2_impl(const ParseSpec& spec, const char *text, uint32_t start, uint32_t size, bool final,
+                            uint8_t *out, uint32_t max_rows, uint32_t status[3]) {
+    ParseState state;
+    parse_begin(&spec, &state);
+    // Separator bytes, the CSV delimiter three times
+    bool csv = spec.format == PARSE_CSV;
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i sep1 = _mm256_set1_epi8(csv ? (char)spec.delimiter : ':');
+    const __m256i sep2 = _mm256_set1_epi8(csv ? (char)spec.delimiter : ',');
+    const __m256i sep3 = _mm256_set1_epi8(csv ? (char)spec.delimiter : '}');
+
+    uint32_t field = start, consumed = start;
+    bool full = false;
+    for (uint32_t base = start; base < size && !full; base += 32) {
+        uint32_t mask = 0;
+        if (base + 32 <= size) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(text + base));
+            __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, newline), _mm256_cmpeq_epi8(v, sep1)),
+                                           _mm256_or_si256(_mm256_cmpeq_epi8(v, sep2), _mm256_cmpeq_epi8(v, sep3)));
+            mask = (uint32_t)_mm256_movemask_epi8(hits);
+        } else {
+            for (uint32_t i = 0; base + i < size; i++) {
+                if (parse_is_separator(&spec, text[base + i])) mask |= 1u << i;
+            }
+        }
+        while (mask && !full) {
+            uint32_t pos = base + __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (parse_separator(&spec, &state, text, field, pos, text[pos], out, max_rows)) {
+                consumed = pos + 1;
+                full = state.rows == max_rows;
+            }
+            field = pos + 1;
+        }
+    }
+    parse_finish(spec, state, text, field, consumed, size, final, full, out, max_rows, status);
+}
+#endif
+
+bool parse_has_avx2() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+void parse_avx2(const ParseSpec& spec, const char *text, uint32_t start, uint32_t size, bool final, uint8_t *out,
+                uint32_t max_rows, uint32_t status[3]) {
+#if defined(__x86_64__)
+    if (parse_has_avx2()) {
+        parse_avx2_impl(spec, text, start, size, final, out, max_rows, status);
+        return;
+    }
+#endif
+    parse_scalar(spec, text, start, size, final, out, max_rows, status);
+}
+
+static void open_files(const std::string& text_file, const std::string& colf_file, ColumnarWriter& writer, int& fd,
+                       size_t& size) {
+    fd = open(text_file.c_str(), O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        std::cerr << "ERROR: open " << text_file << " failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (size == 0) {
+        struct stat st;
+        fstat(fd, &st);
+        size = st.st_size;
+    }
+    int ret = writer.open(colf_file);
+    if (ret != 0) {
+        std::cerr << "ERROR: open " << colf_file << " failed: " << strerror(-ret) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Chunk that starts at the line at `pos`, 4 KiB aligned for the reads : the lines start
+ * `start` bytes into the `len` bytes read from `aligned`.
+ */
+static void next_chunk(size_t pos, size_t size, size_t& aligned, uint32_t& start, uint32_t& len) {
+    aligned = pos / COLF_ALIGN * COLF_ALIGN;
+    start = pos - aligned;
+    len = std::min(PARSE_CHUNK, size - aligned);
+}
+
+// Account for a parsed chunk, the next one starts after its last line
+static void add_chunk(ParseResult& result, const uint32_t status[3], size_t aligned, uint32_t start, uint32_t len,
+                      size_t& pos) {
+    if (status[PARSE_STATUS_CONSUMED] == start && start < len) {
+        std::cerr << "ERROR: line longer than " << (PARSE_CHUNK >> 20) << " MiB at offset " << pos << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    result.rows += status[PARSE_STATUS_ROWS];
+    result.bad_lines += status[PARSE_STATUS_BAD];
+    result.bytes_parsed += status[PARSE_STATUS_CONSUMED] - start;
+    pos = aligned + status[PARSE_STATUS_CONSUMED];
+}
+
+static void finish(ColumnarWriter& writer, ParseResult& result, int fd) {
+    int ret = writer.close();
+    if (ret != 0) {
+        std::cerr << "ERR: columnar write failed: " << strerror(-ret) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    result.bytes_written = writer.bytes_written();
+    (void)close(fd);
+}
+
+static void write_group(ColumnarWriter& writer, ParseResult& result, const void *group, uint32_t rows) {
+    if (rows == 0) return;
+    int ret = writer.write_group_data(group, rows);
+    if (ret != 0) {
+        std::cerr << "ERR: pwrite failed: " << strerror(-ret) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    result.groups++;
+}
+
+TextParser::TextParser(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map)
+    : mKernel(device, uuid, "parse_kernel"), mBo(p2p_bo), mMap((char*)p2p_map) {
+    mSpecBo = xrt::bo(device, sizeof(ParseSpec), mKernel.group_id(3));
+    mStatusBo = xrt::bo(device, 3 * sizeof(uint32_t), mKernel.group_id(2));
+}
+
+ParseResult TextParser::parse(const std::string& text_file, const ParseSpec& spec, const std::string& colf_file,
+                              size_t size) {
+    ParseResult result = ParseResult();
+    size_t half = mBo.size() / 2 / COLF_ALIGN * COLF_ALIGN;
+    size_t out_bytes = parse_out_bytes(spec, PARSE_CHUNK);
+    if (half < PARSE_CHUNK || mBo.size() - half < out_bytes) {
+        std::cerr << "ERROR: the p2p bo is too small for chunks of " << (PARSE_CHUNK >> 20) << " MiB of text" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    ColumnarWriter writer(parse_columns(spec));
+    int fd;
+    open_files(text_file, colf_file, writer, fd, size);
+
+    memcpy(mSpecBo.map<ParseSpec*>(), &spec, sizeof(spec));
+    mSpecBo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    uint32_t *status = mStatusBo.map<uint32_t*>();
+    xrt::bo in_bo = xrt::bo(mBo, PARSE_CHUNK, 0);
+    xrt::bo out_bo = xrt::bo(mBo, out_bytes, half);
+    uint32_t max_rows = parse_max_rows(spec, PARSE_CHUNK);
+
+    // Text P2P read, parsed next to the drive and the columns P2P written
+    for (size_t pos = 0; pos < size;) {
+        size_t aligned;
+        uint32_t start, len;
+        next_chunk(pos, size, aligned, start, len);
+        if (pread(fd, mMap, (len + COLF_ALIGN - 1) / COLF_ALIGN * COLF_ALIGN, aligned) < (ssize_t)len) {
+            std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        auto run = mKernel(in_bo, out_bo, mStatusBo, mSpecBo, start, len, max_rows, (unsigned int)(aligned + len == size));
+        run.wait();
+        mStatusBo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+        write_group(writer, result, mMap + half, status[PARSE_STATUS_ROWS]);
+        add_chunk(result, status, aligned, start, len, pos);
+    }
+    finish(writer, result, fd);
+    return result;
+}
+
+ParseResult parse_host(const std::string& text_file, const ParseSpec& spec, const std::string& colf_file, bool avx2,
+                       size_t size) {
+    ParseResult result = ParseResult();
+    ColumnarWriter writer(parse_columns(spec));
+    int fd;
+    open_files(text_file, colf_file, writer, fd, size);
+
+    uint32_t max_rows = parse_max_rows(spec, PARSE_CHUNK);
+    char *text = (char*)aligned_alloc(COLF_ALIGN, PARSE_CHUNK);
+    uint8_t *out = (uint8_t*)aligned_alloc(COLF_ALIGN, parse_out_bytes(spec, PARSE_CHUNK));
+    uint32_t status[3];
+    for (size_t pos = 0; pos < size;) {
+        size_t aligned;
+        uint32_t start, len;
+        next_chunk(pos, size, aligned, start, len);
+        if (pread(fd, text, (len + COLF_ALIGN - 1) / COLF_ALIGN * COLF_ALIGN, aligned) < (ssize_t)len) {
+            std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        bool final = aligned + len == size;
+        if (avx2) parse_avx2(spec, text, start, len, final, out, max_rows, status);
+        else parse_scalar(spec, text, start, len, final, out, max_rows, status);
+        write_group(writer, result, out, status[PARSE_STATUS_ROWS]);
+        add_chunk(result, status, aligned, start, len, pos);
+    }
+    finish(writer, result, fd);
+    free(text);
+    free(out);
+    return result;
+}
@@ -0,0 +1,73 @@
+/**
+ * @brief Parsing of CSV and JSON lines text into binary columns next to the drive.
+ *
+ * TextParser::parse() P2P reads chunks of the text into the p2p bo, parse_kernel tokenizes
+ * whole lines into fixed-width columns in the second half of the bo, laid out as a group
+ * of the columnar format, and the group is P2P written to a columnar file. parse_host()
+ * does the same on the host with the scalar or AVX2 parser, for the same file.
+ */
+#ifndef TEXTPARSE_H_
+#define TEXTPARSE_H_
+
+#include "parse_spec.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "experimental/xrt_bo.h"
+#include "experimental/xrt_device.h"
+#include "experimental/xrt_kernel.h"
+
+// Spec of the columns, JSON keys being the column names
+ParseSpec parse_spec(uint32_t format, const std::vector<ColfColumn>& columns, char delimiter = ',');
+
+std::vector<ColfColumn> parse_columns(const ParseSpec& spec);
+
+// Rows of a chunk of `chunk` bytes of text at most, and the bytes of their columns
+uint32_t parse_max_rows(const ParseSpec& spec, size_t chunk);
+size_t parse_out_bytes(const ParseSpec& spec, size_t chunk);
+
+/**
+ * Parse the lines of text[start, size) into `out`, columns packed for the rows parsed
+ * (parse_out_bytes()), and fill the PARSE_STATUS_* words. A line without its newline is
+ * only parsed when `final`. Both give the same output as parse_kernel.
+ */
+void parse_scalar(const ParseSpec& spec, const char *text, uint32_t start, uint32_t size, bool final, uint8_t *out,
+                  uint32_t max_rows, uint32_t status[3]);
+void parse_avx2(const ParseSpec& spec, const char *text, uint32_t start, uint32_t size, bool final, uint8_t *out,
+                uint32_t max_rows, uint32_t status[3]);
+
+// Whether parse_avx2() uses AVX2 on this CPU, it falls back to parse_scalar() otherwise
+bool parse_has_avx2();
+
+struct ParseResult {
+    uint64_t rows;
+    uint64_t bad_lines;
+    uint64_t bytes_parsed;
+    uint64_t bytes_written; // columnar file, footer included
+    uint32_t groups;
+};
+
+class TextParser {
+public:
+    // Chunks of text in the first half of the p2p bo, columns in the second
+    TextParser(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map);
+
+    // Parse `size` bytes of text_file (the whole file when 0) into the columnar file colf_file
+    ParseResult parse(const std::string& text_file, const ParseSpec& spec, const std::string& colf_file, size_t size = 0);
+
+private:
+    xrt::kernel mKernel;
+    xrt::bo mBo;
+    char *mMap;
+    xrt::bo mSpecBo;
+    xrt::bo mStatusBo;
+};
+
+// Host only parse and write of the same columnar file, O_DIRECT reads and writes
+ParseResult parse_host(const std::string& text_file, const ParseSpec& spec, const std::string& colf_file, bool avx2,
+                       size_t size = 0);
+
+#endif /* TEXTPARSE_H_ */
@@ -0,0 +1,59 @@
+#include "transpose.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+std::vector<TransposeColumn> transpose_columns(const Schema& schema, const std::vector<std::string>& names) {
+    if (names.empty() || names.size() > TRANSPOSE_MAX_COLUMNS) {
+        std::cerr << "ERROR: transposition needs 1 to " << TRANSPOSE_MAX_COLUMNS << " columns" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::vector<TransposeColumn> columns;
+    for (const std::string& name : names) {
+        const Column& column = schema.column(name);
+        columns.push_back({column.offset, colf_type_width(column.type)});
+    }
+    return columns;
+}
+
+void transpose_records(const uint8_t *records, uint32_t record_size, const std::vector<TransposeColumn>& columns,
+                       uint32_t rows, uint8_t *out) {
+    uint32_t n = columns.size();
+    for (uint32_t c = 0; c < n; c++) {
+        uint8_t *dst = out + transpose_column_offset(columns.data(), rows, c);
+        uint32_t width = columns[c].width;
+        const uint8_t *field = records + columns[c].offset;
+        for (uint32_t r = 0; r < rows; r++, field += record_size) memcpy(dst + (size_t)r * width, field, width);
+        uint64_t end = transpose_column_offset(columns.data(), rows, c + 1) - transpose_column_offset(columns.data(), rows, c);
+        memset(dst + (size_t)rows * width, 0, end - (size_t)rows * width);
+    }
+}
+
+Transposer::Transposer(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map,
+                       const std::vector<TransposeColumn>& columns, uint32_t record_size)
+    : mKernel(device, uuid, "transpose_kernel"), mBo(p2p_bo), mMap((char*)p2p_map), mColumns(columns),
+      mRecordSize(record_size) {
+    mColumnsBo = xrt::bo(device, TRANSPOSE_MAX_COLUMNS * sizeof(TransposeColumn), mKernel.group_id(2));
+    memcpy(mColumnsBo.map<TransposeColumn*>(), columns.data(), columns.size() * sizeof(TransposeColumn));
+    mColumnsBo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+}
+
+uint32_t Transposer::max_rows() const {
+    // Every column may lose up to COLF_ALIGN to its padding
+    size_t row_bytes = 0;
+    for (const TransposeColumn& column : mColumns) row_bytes += column.width;
+    size_t room = mBo.size() - mColumns.size() * COLF_ALIGN;
+    return std::min<size_t>(room / row_bytes, UINT32_MAX);
+}
+
+void Transposer::transpose(xrt::bo& in_bo, uint64_t first_row, uint32_t rows) {
+    auto run = mKernel(in_bo, mBo, mColumnsBo, (unsigned int)mColumns.size(), mRecordSize, (unsigned long long)first_row, rows);
+    run.wait();
+}
+
+int Transposer::write(ColumnarWriter& writer, xrt::bo& in_bo, uint64_t first_row, uint32_t rows) {
+    transpose(in_bo, first_row, rows);
+    return writer.write_group_data(mMap, rows);
+}
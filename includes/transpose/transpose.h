@@ -0,0 +1,53 @@
+/**
+ * @brief Row to column transposition on the ingest path.
+ *
+ * Records synced row-major into a device bo are transposed by transpose_kernel into the
+ * column chunks of a row group in the p2p bo, which ColumnarWriter::write_group_data()
+ * P2P writes to a columnar file.
+ */
+#ifndef TRANSPOSE_H_
+#define TRANSPOSE_H_
+
+#include "transpose_layout.h"
+#include "scan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "experimental/xrt_bo.h"
+#include "experimental/xrt_device.h"
+#include "experimental/xrt_kernel.h"
+
+// Layout of the named columns of the schema
+std::vector<TransposeColumn> transpose_columns(const Schema& schema, const std::vector<std::string>& names);
+
+// Host reference of transpose_kernel, `out` holds transpose_column_offset(.., rows, columns.size()) bytes
+void transpose_records(const uint8_t *records, uint32_t record_size, const std::vector<TransposeColumn>& columns,
+                       uint32_t rows, uint8_t *out);
+
+class Transposer {
+public:
+    Transposer(xrt::device& device, const xrt::uuid& uuid, xrt::bo p2p_bo, void *p2p_map,
+               const std::vector<TransposeColumn>& columns, uint32_t record_size);
+
+    // Rows of a group that fits in the p2p bo
+    uint32_t max_rows() const;
+
+    // Transpose `rows` records of in_bo from first_row, already synced to the device, into the p2p bo
+    void transpose(xrt::bo& in_bo, uint64_t first_row, uint32_t rows);
+
+    // transpose() then P2P write the group as one row group of `writer`, returns 0 or -errno
+    int write(ColumnarWriter& writer, xrt::bo& in_bo, uint64_t first_row, uint32_t rows);
+
+private:
+    xrt::kernel mKernel;
+    xrt::bo mBo;
+    char *mMap;
+    std::vector<TransposeColumn> mColumns;
+    uint32_t mRecordSize;
+    xrt::bo mColumnsBo;
+};
+
+#endif /* TRANSPOSE_H_ */
@@ -0,0 +1,31 @@
+/**
+ * @brief Row to column layout shared by the host transposition and transpose_kernel.
+ *
+ * Fixed-width records are split into one chunk per column, each chunk starting COLF_ALIGN
+ * aligned and zero padded : the layout of a row group of the columnar format, so the
+ * output is P2P written as is.
+ */
+#ifndef TRANSPOSE_LAYOUT_H_
+#define TRANSPOSE_LAYOUT_H_
+
+#include "columnar.h"
+
+#include <stdint.h>
+
+#define TRANSPOSE_MAX_COLUMNS 16
+
+struct TransposeColumn {
+    uint32_t offset; // in the record
+    uint32_t width;
+};
+
+// Offset of column c in the group of `rows` rows, the group size for c = num_columns
+static inline uint64_t transpose_column_offset(const struct TransposeColumn *columns, uint32_t rows, uint32_t c) {
+    uint64_t offset = 0;
+    for (uint32_t i = 0; i < c; i++) {
+        offset += ((uint64_t)rows * columns[i].width + COLF_ALIGN - 1) / COLF_ALIGN * COLF_ALIGN;
+    }
+    return offset;
+}
+
+#endif /* TRANSPOSE_LAYOUT_H_ */
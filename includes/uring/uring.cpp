@@ -0,0 +1,210 @@
+#include "uring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// Kernel limit on the size of one registered buffer
+static const size_t FIXED_REGION_SIZE = 1UL << 30;
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+Uring::Uring(unsigned depth, unsigned sqpoll_idle_ms)
+    : mRingFd(-1), mError(0), mSqpoll(sqpoll_idle_ms > 0), mDepth(depth),
+      mSqRing(MAP_FAILED), mSqRingSize(0), mCqRing(MAP_FAILED), mCqRingSize(0),
+      mSqes((io_uring_sqe*)MAP_FAILED), mSqesSize(0), mToSubmit(0),
+      mFixedFd(-1), mFixedBase(nullptr), mFixedSize(0) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if (mSqpoll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = sqpoll_idle_ms;
+    }
+
+    mRingFd = io_uring_setup(depth, &params);
+    if (mRingFd < 0) {
+        mError = -errno;
+        return;
+    }
+    mDepth = std::min(depth, params.sq_entries);
+
+    mSqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    mCqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) mSqRingSize = mCqRingSize = std::max(mSqRingSize, mCqRingSize);
+
+    mSqRing = mmap(NULL, mSqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQ_RING);
+    if (mSqRing == MAP_FAILED) {
+        mError = -errno;
+        return;
+    }
+    if (single_mmap) {
+        mCqRing = mSqRing;
+    } else {
+        mCqRing = mmap(NULL, mCqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_CQ_RING);
+        if (mCqRing == MAP_FAILED) {
+            mError = -errno;
+            return;
+        }
+    }
+    mSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    mSqes = (io_uring_sqe*)mmap(NULL, mSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRingFd, IORING_OFF_SQES);
+    if (mSqes == MAP_FAILED) {
+        mError = -errno;
+        return;
+    }
+
+    char *sq = (char*)mSqRing;
+    mSqHead = (unsigned*)(sq + params.sq_off.head);
+    mSqTail = (unsigned*)(sq + params.sq_off.tail);
+    mSqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+    mSqFlags = (unsigned*)(sq + params.sq_off.flags);
+    mSqArray = (unsigned*)(sq + params.sq_off.array);
+
+    char *cq = (char*)mCqRing;
+    mCqHead = (unsigned*)(cq + params.cq_off.head);
+    mCqTail = (unsigned*)(cq + params.cq_off.tail);
+    mCqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+    mCqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+}
+
+Uring::~Uring() {
+    if (mSqes != MAP_FAILED) munmap(mSqes, mSqesSize);
+    if (mCqRing != MAP_FAILED && mCqRing != mSqRing) munmap(mCqRing, mCqRingSize);
+    if (mSqRing != MAP_FAILED) munmap(mSqRing, mSqRingSize);
+    if (mRingFd >= 0) close(mRingFd);
+}
+
+int Uring::register_file(int fd) {
+    if (io_uring_register(mRingFd, IORING_REGISTER_FILES, &fd, 1) < 0) return -errno;
+    mFixedFd = fd;
+    return 0;
+}
+
+int Uring::register_buffer(void *base, size_t size) {
+    std::vector<struct iovec> iovecs;
+    for (size_t offset = 0; offset < size; offset += FIXED_REGION_SIZE) {
+        struct iovec iov;
+        iov.iov_base = (char*)base + offset;
+        iov.iov_len = std::min(FIXED_REGION_SIZE, size - offset);
+        iovecs.push_back(iov);
+    }
+    if (io_uring_register(mRingFd, IORING_REGISTER_BUFFERS, iovecs.data(), iovecs.size()) < 0) return -errno;
+    mFixedBase = (char*)base;
+    mFixedSize = size;
+    return 0;
+}
+
+bool Uring::push(const io_uring_sqe& sqe) {
+    unsigned head = __atomic_load_n(mSqHead, __ATOMIC_ACQUIRE);
+    unsigned tail = *mSqTail;
+    if (tail - head > *mSqMask) return false;
+
+    unsigned index = tail & *mSqMask;
+    mSqes[index] = sqe;
+    mSqArray[index] = index;
+    __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+    mToSubmit++;
+    return true;
+}
+
+int Uring::submit(unsigned wait_nr) {
+    if (mSqpoll) {
+        // The kernel thread picks up new entries by itself unless it went idle, only
+        // enter the kernel to wake it up or when there is no completion to reap yet
+        mToSubmit = 0;
+        unsigned flags = 0;
+        if (__atomic_load_n(mSqFlags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP) flags |= IORING_ENTER_SQ_WAKEUP;
+        if (wait_nr && *mCqHead == __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE)) flags |= IORING_ENTER_GETEVENTS;
+        if (flags && io_uring_enter(mRingFd, 0, wait_nr, flags) < 0) return -errno;
+        return 0;
+    }
+
+    int ret = io_uring_enter(mRingFd, mToSubmit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0);
+    if (ret < 0) return -errno;
+    mToSubmit -= ret;
+    return 0;
+}
+
+int Uring::reap(unsigned& inflight, size_t& done) {
+    unsigned head = *mCqHead;
+    while (head != __atomic_load_n(mCqTail, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe& cqe = mCqes[head & *mCqMask];
+        head++;
+        inflight--;
+        if (cqe.res < 0) {
+            __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+            return cqe.res;
+        }
+        if ((uint64_t)cqe.res != cqe.user_data) {
+            __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+            return -EIO;
+        }
+        done += cqe.res;
+    }
+    __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+    return 0;
+}
+
+ssize_t Uring::transfer(bool write, int fd, char *buf, size_t size, off_t offset, size_t bs) {
+    if (mError) return mError;
+
+    size_t queued = 0;
+    size_t done = 0;
+    unsigned inflight = 0;
+    while (done < size) {
+        while (inflight < mDepth && queued < size) {
+            size_t len = std::min(bs, size - queued);
+            char *data = buf + queued;
+
+            struct io_uring_sqe sqe;
+            memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+            sqe.addr = (uint64_t)data;
+            sqe.len = len;
+            sqe.off = offset + queued;
+            sqe.user_data = len;
+
+            // Fixed buffers when the I/O fits entirely in one registered region
+            if (data >= mFixedBase && data + len <= mFixedBase + mFixedSize) {
+                size_t region = (data - mFixedBase) / FIXED_REGION_SIZE;
+                if ((data + len - 1 - mFixedBase) / FIXED_REGION_SIZE == region) {
+                    sqe.opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+                    sqe.buf_index = region;
+                }
+            }
+            if (fd == mFixedFd) {
+                sqe.fd = 0;
+                sqe.flags |= IOSQE_FIXED_FILE;
+            } else {
+                sqe.fd = fd;
+            }
+
+            if (!push(sqe)) break;
+            queued += len;
+            inflight++;
+        }
+
+        int ret = submit(1);
+        if (ret < 0) return ret;
+        ret = reap(inflight, done);
+        if (ret < 0) return ret;
+    }
+    return done;
+}
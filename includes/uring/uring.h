@@ -0,0 +1,77 @@
+/**
+ * @brief Minimal io_uring engine on top of the raw syscalls (no liburing dependency).
+ *
+ * Supports plain submission, registered files (IORING_REGISTER_FILES), fixed buffers
+ * (IORING_REGISTER_BUFFERS + READ/WRITE_FIXED) and kernel side submission polling
+ * (IORING_SETUP_SQPOLL), which is all the P2P benchmark needs to compare the cost of
+ * per-I/O page pinning and syscalls.
+ */
+#ifndef URING_H_
+#define URING_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+class Uring {
+public:
+    // `sqpoll_idle_ms` > 0 enables IORING_SETUP_SQPOLL with that idle timeout
+    Uring(unsigned depth, unsigned sqpoll_idle_ms = 0);
+    ~Uring();
+
+    Uring(const Uring&) = delete;
+    Uring& operator=(const Uring&) = delete;
+
+    // 0 when the ring is usable, -errno otherwise
+    int error() const { return mError; }
+
+    // Register fd as fixed file 0, returns 0 or -errno
+    int register_file(int fd);
+
+    /**
+     * Register [base, base + size) as fixed buffers, split in regions of at most 1 GiB
+     * (the kernel limit per iovec). Returns 0 or -errno, e.g. when the pages cannot be
+     * pinned long term.
+     */
+    int register_buffer(void *base, size_t size);
+
+    /**
+     * Transfer `size` bytes between `buf` and `fd` at `offset` in `bs` sized I/Os, keeping
+     * up to `depth` of them in flight. Uses the registered file and fixed buffers when they
+     * are registered. Returns the number of bytes transferred or -errno.
+     */
+    ssize_t transfer(bool write, int fd, char *buf, size_t size, off_t offset, size_t bs);
+
+private:
+    bool push(const io_uring_sqe& sqe);
+    int submit(unsigned wait_nr);
+    int reap(unsigned& inflight, size_t& done);
+
+    int mRingFd;
+    int mError;
+    bool mSqpoll;
+    unsigned mDepth;
+
+    // Shared ring memory
+    void *mSqRing;
+    size_t mSqRingSize;
+    void *mCqRing;
+    size_t mCqRingSize;
+    io_uring_sqe *mSqes;
+    size_t mSqesSize;
+
+    unsigned *mSqHead, *mSqTail, *mSqMask, *mSqFlags, *mSqArray;
+    unsigned *mCqHead, *mCqTail, *mCqMask;
+    io_uring_cqe *mCqes;
+    unsigned mToSubmit;
+
+    int mFixedFd;
+    char *mFixedBase;
+    size_t mFixedSize;
+};
+
+#endif /* URING_H_ */
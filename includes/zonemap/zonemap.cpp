@@ -0,0 +1,113 @@
+#include "zonemap.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+ZoneMap::ZoneMap() {
+    memset(&mHeader, 0, sizeof(mHeader));
+    mHeader.magic = ZMAP_MAGIC;
+}
+
+ZoneMap::ZoneMap(uint32_t record_size, uint32_t column_offset, FilterType type, size_t block_bytes) : ZoneMap() {
+    mHeader.type = type;
+    mHeader.column_offset = column_offset;
+    mHeader.record_size = record_size;
+    mHeader.block_bytes = block_bytes;
+}
+
+void ZoneMap::append(const ZoneEntry *entries, size_t count) {
+    mEntries.insert(mEntries.end(), entries, entries + count);
+}
+
+// Column value of a record as a double or an int64, the same way filter_kernel reads it
+static int64_t load_value(const uint8_t *field, uint32_t type) {
+    if (type == FILTER_INT32) {
+        int32_t v;
+        memcpy(&v, field, sizeof(v));
+        return v;
+    }
+    int64_t v;
+    memcpy(&v, field, sizeof(v));
+    return v;
+}
+
+static double as_double(int64_t bits) {
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+// a < b in the order of the column type
+static bool less(int64_t a, int64_t b, uint32_t type) {
+    return type == FILTER_FLOAT64 ? as_double(a) < as_double(b) : a < b;
+}
+
+void ZoneMap::add_records(const uint8_t *records, size_t size) {
+    for (size_t block = 0; block < size; block += mHeader.block_bytes) {
+        size_t end = std::min(size, block + mHeader.block_bytes);
+        ZoneEntry entry;
+        entry.min = entry.max = load_value(records + block + mHeader.column_offset, mHeader.type);
+        for (size_t pos = block; pos + mHeader.record_size <= end; pos += mHeader.record_size) {
+            int64_t v = load_value(records + pos + mHeader.column_offset, mHeader.type);
+            if (less(v, entry.min, mHeader.type)) entry.min = v;
+            if (less(entry.max, v, mHeader.type)) entry.max = v;
+        }
+        mEntries.push_back(entry);
+    }
+}
+
+bool ZoneMap::may_match(size_t block, const std::vector<FilterPredicate>& predicates) const {
+    if (block >= mEntries.size()) return true;
+    const ZoneEntry& zone = mEntries[block];
+    uint32_t type = mHeader.type;
+    for (const FilterPredicate& p : predicates) {
+        if (p.offset != mHeader.column_offset || p.type != type) continue;
+        bool below = less(p.value, zone.min, type); // value < min
+        bool above = less(zone.max, p.value, type); // value > max
+        bool possible;
+        switch (p.op) {
+        case FILTER_EQ: possible = !below && !above; break;
+        case FILTER_NE: possible = less(zone.min, zone.max, type) || below || above; break;
+        case FILTER_LT: possible = less(zone.min, p.value, type); break;
+        case FILTER_LE: possible = !below; break;
+        case FILTER_GT: possible = less(p.value, zone.max, type); break;
+        default: possible = !above; break;
+        }
+        if (!possible) return false;
+    }
+    return true;
+}
+
+int ZoneMap::save(const std::string& path) const {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) return -errno;
+    ZoneMapHeader header = mHeader;
+    header.count = mEntries.size();
+    int ret = 0;
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(mEntries.data(), sizeof(ZoneEntry), mEntries.size(), file) != mEntries.size()) {
+        ret = -errno;
+    }
+    if (fclose(file) != 0 && ret == 0) ret = -errno;
+    return ret;
+}
+
+int ZoneMap::load(const std::string& path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) return -errno;
+    ZoneMapHeader header;
+    int ret = 0;
+    if (fread(&header, sizeof(header), 1, file) != 1) {
+        ret = -EINVAL;
+    } else if (header.magic != ZMAP_MAGIC || header.record_size == 0 || header.block_bytes % header.record_size != 0) {
+        ret = -EINVAL;
+    } else {
+        mHeader = header;
+        mEntries.resize(header.count);
+        if (fread(mEntries.data(), sizeof(ZoneEntry), header.count, file) != header.count) ret = -EINVAL;
+    }
+    fclose(file);
+    return ret;
+}
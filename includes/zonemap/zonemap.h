@@ -0,0 +1,70 @@
+/**
+ * @brief Zone map : min/max of one column per block of a record file, kept in a sidecar
+ *        index so range scans can skip the blocks that cannot match.
+ *
+ * Entries are computed by zonemap_kernel on the data in the p2p bo before it is P2P
+ * written, or on the host. The sidecar file is a ZoneMapHeader followed by one ZoneEntry
+ * per block. The definitions are plain C so they can be included by the kernels.
+ */
+#ifndef ZONEMAP_H_
+#define ZONEMAP_H_
+
+#include "filter.h"
+
+#include <stdint.h>
+
+#define ZMAP_MAGIC 0x50414D5A // "ZMAP"
+
+// Bounds of a block, the bits of a double for FILTER_FLOAT64
+struct ZoneEntry {
+    int64_t min;
+    int64_t max;
+};
+
+struct ZoneMapHeader {
+    uint32_t magic;
+    uint32_t type;          // FilterType of the column
+    uint32_t column_offset; // in the record
+    uint32_t record_size;
+    uint64_t block_bytes;   // multiple of the record size
+    uint64_t count;
+};
+
+#if defined(__cplusplus) && !defined(__SYNTHESIS__)
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class ZoneMap {
+public:
+    ZoneMap();
+    ZoneMap(uint32_t record_size, uint32_t column_offset, FilterType type, size_t block_bytes);
+
+    // Entries of the next blocks, as computed by zonemap_kernel
+    void append(const ZoneEntry *entries, size_t count);
+
+    // Host computation of the entries of the next blocks of `size` bytes of records
+    void add_records(const uint8_t *records, size_t size);
+
+    /**
+     * False when no record of `block` can satisfy the predicates. Only the comparisons
+     * on the indexed column are used, blocks past the end of the index may match.
+     */
+    bool may_match(size_t block, const std::vector<FilterPredicate>& predicates) const;
+
+    // Sidecar file, return 0 or -errno (-EINVAL on a bad header)
+    int save(const std::string& path) const;
+    int load(const std::string& path);
+
+    size_t block_bytes() const { return mHeader.block_bytes; }
+    size_t blocks() const { return mEntries.size(); }
+    const std::vector<ZoneEntry>& entries() const { return mEntries; }
+    void clear() { mEntries.clear(); }
+
+private:
+    ZoneMapHeader mHeader;
+    std::vector<ZoneEntry> mEntries;
+};
+#endif
+
+#endif /* ZONEMAP_H_ */
@@ -21,19 +21,116 @@
 
 /**
  * Can be compiled with :
- * g++ -o bin/benchmark includes/cmdparser/cmdlineparser.cpp includes/logger/logger.cpp src/benchmark.cpp -I/opt/xilinx/xrt/include -Wall -O0 -g -std=c++1y -I includes/cmdparser -I includes/logger -fmessage-length=0  -L/opt/xilinx/xrt/lib -pthread -lOpenCL -lrt -lstdc++  -luuid -lxrt_coreutil
+ * g++ -o bin/benchmark includes/cmdparser/cmdlineparser.cpp includes/logger/logger.cpp includes/steadystate/steadystate.cpp includes/filelayout/filelayout.cpp includes/uring/uring.cpp includes/cpustat/cpustat.cpp includes/perfcounters/perfcounters.cpp includes/lz4block/lz4block.cpp includes/datagen/datagen.cpp includes/aes/aes.cpp includes/fingerprint/fingerprint.cpp includes/scan/scan.cpp includes/columnar/columnar.cpp includes/zonemap/zonemap.cpp includes/bloom/bloom.cpp includes/grep/grep.cpp includes/aggregate/aggregate.cpp includes/extsort/extsort.cpp includes/sketch/sketch.cpp includes/textparse/textparse.cpp includes/transpose/transpose.cpp includes/simd/simd.cpp includes/planner/planner.cpp includes/cmdring/cmdring.cpp includes/latency/latency.cpp includes/staging/staging.cpp includes/stream/stream.cpp includes/sizes/sizes.cpp src/benchmark.cpp -I/opt/xilinx/xrt/include -Wall -O0 -g -std=c++1y -I includes/cmdparser -I includes/logger -I includes/steadystate -I includes/filelayout -I includes/uring -I includes/cpustat -I includes/perfcounters -I includes/lz4block -I includes/datagen -I includes/aes -I includes/fingerprint -I includes/scan -I includes/columnar -I includes/zonemap -I includes/bloom -I includes/grep -I includes/aggregate -I includes/extsort -I includes/sketch -I includes/textparse -I includes/transpose -I includes/simd -I includes/planner -I includes/cmdring -I includes/latency -I includes/staging -I includes/stream -I includes/sizes -fmessage-length=0  -L/opt/xilinx/xrt/lib -pthread -lOpenCL -lrt -lstdc++  -luuid -lxrt_coreutil
  * 
  * Can be run with :
  * bin/benchmark -x bin/empty_kernel.xclbin -p <file's path on smartssd> -i <# of iterations>
+ *
+ * Steady-state write numbers (precondition the span, then wait for the SNIA criteria) :
+ * bin/benchmark -x bin/empty_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -s 64G -c -ss
+ *
+ * Allocating vs preallocated P2P writes side by side :
+ * bin/benchmark -x bin/empty_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m layout
+ *
+ * io_uring plain vs registered files/fixed buffers (vs SQPOLL) per block size :
+ * bin/benchmark -x bin/empty_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m uring -bs 4K,64K,1M -sq
+ *
+ * Near-storage compression on the write path (xclbin built from src/pipeline_kernel.cpp) :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m compress [-if <input file>]
+ *
+ * Near-storage decompression on the read path, of a file written by -m compress :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m decompress
+ *
+ * Inline AES-256-CTR encryption of the P2P write and read paths vs plaintext :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m crypt
+ *
+ * Dedup scan with per-block fingerprints computed next to the drive (-dr writes test data first) :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m dedup -s 64G -fb 4K [-dr 0.3]
+ *
+ * Predicate pushdown scan of fixed-width records, selectivity vs effective scan bandwidth :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m scan -ds 4G
+ *
+ * Projected scans of a columnar copy of the records (<path>.colf) vs full-row scans :
+ * bin/benchmark -x bin/empty_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m columnar -ds 4G -cs key,price
+ *
+ * Range scans skipping blocks with a zone map built on the write path (<path>.zmap) :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m zonemap -ds 4G -zs 1M
+ *
+ * Point lookups probing per-segment Bloom filters built on the write path (<path>.bloom), -i lookups per kind :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of lookups> -m bloom -ds 4G -bg 1M -bp 0.1,0.01,0.001
+ *
+ * Log search next to the drive vs on the host (AVX2 and scalar) over the same file :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m grep -ds 4G -pt 'status=5\d\d latency_ms=9\d\d'
+ *
+ * Group-by aggregation next to the drive vs pulling the rows to the CPU, per group cardinality :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m aggregate -ds 4G -gc 16,1K,64K,1M
+ *
+ * External merge sort, runs sorted next to the drive then merged on the host (<path>.sorted, <path>.sorted.runs) :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m sort -ds 16G -sk key [-sm]
+ *
+ * Top-K and quantile sketch of a column reduced next to the drive vs an exact host computation :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m sketch -ds 4G -sc price -tk 100
+ *
+ * CSV or JSON lines parsed into binary columns next to the drive (<path>.colf) vs host parse and write (<path>.host.colf) :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m parse -ds 4G -tf csv
+ *
+ * Row to column transposition on the write path (<path>.colf) vs the plain P2P write of the rows :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m transpose -ds 1G -rg 64M
+ *
+ * Each offload against its CPU SIMD equivalent, O_DIRECT reads and host compute vs P2P reads and the kernels :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m offload -ds 4G [-sd avx2]
+ *
+ * Filter scans planned on the CPU, the FPGA or split between both from bandwidths calibrated first, predicted vs achieved :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m plan -ds 16G
+ *
+ * Per-chunk kernel launches vs the persistent ring_kernel polling a command ring, -i chunks per block size :
+ * bin/benchmark -x bin/pipeline_kernel.xclbin -p <file's path on smartssd> -i <# of chunks> -m ring -bs 4K,64K,1M
+ *
+ * Host to SSD writes staged through 1 to 4 buffers, fill, bo.sync and P2P write of different chunks overlapping :
+ * bin/benchmark -x bin/empty_kernel.xclbin -p <file's path on smartssd> -i <# of iterations> -m staging -sb 64M
+ *
+ * A file larger than the device memory streamed W/R through a window of the p2p bo reused in turn, 1 iteration unless -i is given :
+ * bin/benchmark -x bin/empty_kernel.xclbin -p <file's path on smartssd> -m stream -st 400G -wn 1G -wc 4 [-i <# of iterations>]
  */
 
 #include "cmdlineparser.h"
+#include "steadystate.h"
+#include "filelayout.h"
+#include "uring.h"
+#include "cpustat.h"
+#include "perfcounters.h"
+#include "lz4block.h"
+#include "datagen.h"
+#include "aes.h"
+#include "fingerprint.h"
+#include "scan.h"
+#include "columnar.h"
+#include "zonemap.h"
+#include "bloom.h"
+#include "grep.h"
+#include "aggregate.h"
+#include "extsort.h"
+#include "sketch.h"
+#include "textparse.h"
+#include "transpose.h"
+#include "simd.h"
+#include "planner.h"
+#include "cmdring.h"
+#include "latency.h"
+#include "staging.h"
+#include "stream.h"
+#include "sizes.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <cstring>
 #include <chrono>
+#include <random>
+#include <vector>
 
 #include <fcntl.h>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iosfwd>
 #include <unistd.h>
@@ -50,108 +147,2735 @@ double throughput_from_fpga_max_ssd_to_host = 0;
 double throughput_from_cpu_max_host_to_ssd = 0;
 double throughput_from_cpu_max_ssd_to_host = 0;
 
+// Host CPU cost of the measured transfers
+CpuStats cpu_host_to_ssd;
+CpuStats cpu_ssd_to_host;
+
+// Per phase performance counters, only collected with --perf
+PerfCounters perf_counters;
+
 ////////////////////////////////////////////////////////////////////////////////
 class Timer {
     std::chrono::high_resolution_clock::time_point mTimeStart;
 
-public:
-    Timer() { reset(); }
-    long long stop() {
-        std::chrono::high_resolution_clock::time_point timeEnd = std::chrono::high_resolution_clock::now();
-        return std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - mTimeStart).count();
+public:
+    Timer() { reset(); }
+    long long stop() {
+        std::chrono::high_resolution_clock::time_point timeEnd = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(timeEnd - mTimeStart).count();
+    }
+    // Same without rounding to the microsecond
+    double elapsed_us() {
+        std::chrono::high_resolution_clock::time_point timeEnd = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration<double, std::micro>(timeEnd - mTimeStart).count();
+    }
+    void reset() { mTimeStart = std::chrono::high_resolution_clock::now(); }
+};
+
+Timer global_timer;
+
+std::pair<double, double> p2p_host_to_ssd(int& nvmeFd, xrt::kernel& krnl, xrt::bo bo, int *bo_map, off_t offset = 0) {
+	Timer timer_from_cpu, timer_from_fpga;
+    int ret = 0;
+    size_t vector_size_bytes = sizeof(int) * DATA_SIZE;
+
+    //std::cout << "Start cpu timer : " << global_timer.stop() << std::endl;
+    timer_from_cpu = Timer();
+    CpuMeter cpu_meter = CpuMeter();
+
+    //std::cout << "Synchronize input buffer data to device global memory : " << global_timer.stop() << std::endl;
+    perf_counters.start();
+    bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    perf_counters.stop("write: sync");
+
+    //std::cout << "Start fpga timer : " << global_timer.stop() << std::endl;
+    timer_from_fpga = Timer();
+
+    //std::cout << "Now start P2P Write from device buffers to SSD : " << global_timer.stop() << std::endl;
+    perf_counters.start();
+    ret = pwrite(nvmeFd, (void*)bo_map, vector_size_bytes, offset);
+    perf_counters.stop("write: pwrite");
+    if (ret == -1) std::cout << "P2P: write() failed, err: " << ret << ", line: " << __LINE__ << std::endl;
+
+    //std::cout << "Stop timers : " << global_timer.stop() << std::endl;
+    long long duration_from_cpu = timer_from_cpu.stop();
+    long long duration_from_fpga = timer_from_fpga.stop();
+    cpu_host_to_ssd.add(cpu_meter.stop(), vector_size_bytes);
+
+    //std::cout << "Compute throughputs : " << global_timer.stop() << std::endl;
+    double throughput = vector_size_bytes;
+    throughput *= 1000000;     // convert us to s;
+    throughput /= 1024 * 1024; // convert to MB
+
+    double throughput_from_fpga = throughput / duration_from_fpga;
+    double throughput_from_cpu = throughput / duration_from_cpu;
+
+    if (throughput_from_fpga > throughput_from_fpga_max_host_to_ssd) {
+    	throughput_from_fpga_max_host_to_ssd = throughput_from_fpga;
+    }
+
+    if (throughput_from_cpu > throughput_from_cpu_max_host_to_ssd) {
+    	throughput_from_cpu_max_host_to_ssd = throughput_from_cpu;
+    }
+
+    return std::make_pair(throughput_from_fpga, throughput_from_cpu);
+}
+
+std::pair<double, double> p2p_ssd_to_host(int& nvmeFd, xrtDeviceHandle device, xrt::kernel& krnl, off_t offset = 0) {
+	Timer timer_from_cpu, timer_from_fpga;
+    size_t vector_size_bytes = sizeof(int) * DATA_SIZE;
+
+    xrt::bo::flags flags = xrt::bo::flags::p2p;
+    //std::cout << "Allocate Buffer in Global Memory : " << global_timer.stop() << std::endl;
+    auto bo = xrt::bo(device, vector_size_bytes, flags, krnl.group_id(0));
+
+    //std::cout << "Map the contents of the buffer object into host memory : " << global_timer.stop() << std::endl;
+    auto bo_map = bo.map<int*>();
+
+    //std::cout << "Start timers : " << global_timer.stop() << std::endl;
+    timer_from_cpu = Timer();
+    timer_from_fpga = Timer();
+    CpuMeter cpu_meter = CpuMeter();
+
+    //std::cout << "Now start P2P Read from SSD to device buffers : " << global_timer.stop() << std::endl;
+    perf_counters.start();
+    if (pread(nvmeFd, (void*)bo_map, vector_size_bytes, offset) <= 0) {
+        std::cerr << "ERR: pread failed: "
+                  << " error: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    perf_counters.stop("read: pread");
+
+    //std::cout << "Stop timer : " << global_timer.stop() << std::endl;
+    long long duration_from_fpga = timer_from_fpga.stop();
+
+    double throughput = vector_size_bytes;
+    throughput *= 1000000;     // convert us to s;
+    throughput /= 1024 * 1024; // convert to MB
+
+    double throughput_from_fpga = throughput / duration_from_fpga;
+
+    if (throughput_from_fpga > throughput_from_fpga_max_ssd_to_host) {
+    	throughput_from_fpga_max_ssd_to_host = throughput_from_fpga;
+    }
+
+    // Get the output data from the device
+    perf_counters.start();
+    bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+    perf_counters.stop("read: sync");
+
+    long long duration_from_cpu = timer_from_cpu.stop();
+    cpu_ssd_to_host.add(cpu_meter.stop(), vector_size_bytes);
+    double throughput_from_cpu = throughput / duration_from_cpu;
+
+    if (throughput_from_cpu > throughput_from_cpu_max_ssd_to_host) {
+    	throughput_from_cpu_max_ssd_to_host = throughput_from_cpu;
+    }
+
+    return std::make_pair(throughput_from_fpga, throughput_from_cpu);
+}
+
+/**
+ * SNIA-style preconditioning of the target span : a sequential fill of the whole span
+ * followed by `loops` x span bytes of random overwrites of `block_size` bytes, all issued
+ * as P2P writes from the device buffer. The bo must already be synced to the device and
+ * `block_size` a multiple of 4 KiB no larger than the span and the buffer, checked in main.
+ */
+void precondition(int nvmeFd, int *bo_map, size_t buffer_size, size_t span, size_t block_size, int loops) {
+    Timer timer = Timer();
+
+    std::cout << "Preconditioning: sequential fill of " << (span >> 20) << " MiB\n";
+    for (size_t offset = 0; offset < span; offset += buffer_size) {
+        size_t len = std::min(buffer_size, span - offset);
+        if (pwrite(nvmeFd, (void*)bo_map, len, offset) != (ssize_t)len) {
+            std::cerr << "ERR: precondition pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    std::cout << "Preconditioning: sequential fill done in " << (timer.stop() / 1000000) << "s\n";
+
+    std::mt19937_64 rng(42);
+    size_t blocks_in_span = span / block_size;
+    size_t blocks_in_buffer = buffer_size / block_size;
+    std::uniform_int_distribution<size_t> target(0, blocks_in_span - 1);
+    std::uniform_int_distribution<size_t> source(0, blocks_in_buffer - 1);
+    char *src = (char*)bo_map;
+
+    size_t total_blocks = blocks_in_span * loops;
+    std::cout << "Preconditioning: " << total_blocks << " random overwrites of " << (block_size >> 10) << " KiB\n";
+    for (size_t i = 0; i < total_blocks; i++) {
+        off_t offset = target(rng) * block_size;
+        if (pwrite(nvmeFd, src + source(rng) * block_size, block_size, offset) != (ssize_t)block_size) {
+            std::cerr << "ERR: precondition pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    std::cout << "Preconditioning done in " << (timer.stop() / 1000000) << "s\n";
+}
+
+// Write the buffer once into `path` opened for P2P, returns the throughput in MiB/s
+double timed_p2p_write(const std::string& path, int *bo_map, size_t size, bool allocate, CpuStats& cpu) {
+    (void)unlink(path.c_str());
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if (fd < 0) {
+        std::cerr << "ERROR: open " << path << " failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (allocate) {
+        int ret = preallocate(fd, size);
+        if (ret != 0) {
+            std::cerr << "ERR: fallocate failed: " << strerror(-ret) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    Timer timer = Timer();
+    CpuMeter cpu_meter = CpuMeter();
+    if (pwrite(fd, (void*)bo_map, size, 0) != (ssize_t)size) {
+        std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    long long duration = timer.stop();
+    cpu.add(cpu_meter.stop(), size);
+    (void)close(fd);
+
+    return ((double)size * 1000000 / (1024 * 1024)) / duration;
+}
+
+/**
+ * Side by side comparison of P2P writes into an empty file, where ext4 allocates blocks
+ * during the measured transfer, and into a file preallocated with fallocate.
+ */
+int layout_benchmark(const std::string& filepath, xrt::bo bo, int *bo_map, size_t size, int num_iter) {
+    std::string scratch = filepath + ".layout";
+    bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+    double sum[2] = {0, 0};
+    double max[2] = {0, 0};
+    double min[2] = {1e300, 1e300};
+    CpuStats cpu[2];
+    std::cout << "\nStarting " << num_iter << " iterations allocating/preallocated W\n";
+    for (int i = 0; i < num_iter; i++) {
+        for (int allocate = 0; allocate < 2; allocate++) {
+            double throughput = timed_p2p_write(scratch, bo_map, size, allocate, cpu[allocate]);
+            sum[allocate] += throughput;
+            max[allocate] = std::max(max[allocate], throughput);
+            min[allocate] = std::min(min[allocate], throughput);
+        }
+        std::cout << "Iteration " << i << " : " << (global_timer.stop()/1000000) << "s\n";
+    }
+
+    int fd = open(scratch.c_str(), O_RDONLY);
+    std::vector<FileExtent> extents = file_extents(fd, size);
+    (void)close(fd);
+    (void)unlink(scratch.c_str());
+
+    const char *names[2] = {"allocating", "preallocated"};
+    for (int allocate = 0; allocate < 2; allocate++) {
+        std::cout << "\nWrite bandwidth " << names[allocate] << " :\n"
+                  << "		Max throughput from fpga: " << max[allocate] << " MiB/s\n"
+                  << "		Min throughput from fpga: " << min[allocate] << " MiB/s\n"
+                  << "		Average throughput from fpga: " << sum[allocate] / num_iter << " MiB/s\n"
+                  << "		";
+        cpu[allocate].print(std::cout);
+        std::cout << "\n";
+    }
+    std::cout << "\nPreallocated file layout: " << extents.size() << " extents, "
+              << count_fragments(extents) << " fragments\n";
+    return 0;
+}
+
+/**
+ * P2P transfers of the buffer through io_uring at several block sizes, comparing plain
+ * submission with a registered file plus the bo_map regions registered as fixed buffers,
+ * and optionally with SQPOLL on top. At small block sizes the per-I/O page pinning and
+ * syscall costs dominate, which is what the registered variants remove.
+ */
+int uring_benchmark(const std::string& filepath, xrt::bo bo, int *bo_map, size_t size, int num_iter,
+                    const std::vector<size_t>& block_sizes, unsigned depth, bool sqpoll) {
+    bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const char *names[3] = {"plain", "registered", "registered+sqpoll"};
+    int variants = sqpoll ? 3 : 2;
+    std::cout << "\nio_uring, queue depth " << depth << ", " << num_iter << " iterations W/R per block size\n";
+    for (size_t bs : block_sizes) {
+        double plain[2] = {0, 0};
+        for (int variant = 0; variant < variants; variant++) {
+            Uring ring(depth, variant == 2 ? 1000 : 0);
+            int ret = ring.error();
+            if (ret == 0 && variant > 0) ret = ring.register_file(nvmeFd);
+            if (ret == 0 && variant > 0) ret = ring.register_buffer(bo_map, size);
+            if (ret != 0) {
+                std::cout << "	" << (bs >> 10) << " KiB " << names[variant] << ": unavailable (" << strerror(-ret) << ")\n";
+                continue;
+            }
+
+            double sum[2] = {0, 0};
+            CpuStats cpu[2];
+            for (int i = 0; i < num_iter; i++) {
+                for (int write = 1; write >= 0; write--) {
+                    Timer timer = Timer();
+                    CpuMeter cpu_meter = CpuMeter();
+                    ssize_t done = ring.transfer(write, nvmeFd, (char*)bo_map, size, 0, bs);
+                    long long duration = timer.stop();
+                    cpu[write].add(cpu_meter.stop(), size);
+                    if (done < 0) {
+                        std::cerr << "ERR: io_uring transfer failed: " << strerror(-done) << std::endl;
+                        (void)close(nvmeFd);
+                        return EXIT_FAILURE;
+                    }
+                    sum[write] += ((double)size * 1000000 / (1024 * 1024)) / duration;
+                }
+            }
+
+            double write_throughput = sum[1] / num_iter;
+            double read_throughput = sum[0] / num_iter;
+            std::cout << "	" << (bs >> 10) << " KiB " << names[variant] << ": write " << write_throughput
+                      << " MiB/s (" << (write_throughput * 1024 * 1024 / bs) << " IOPS), read " << read_throughput
+                      << " MiB/s (" << (read_throughput * 1024 * 1024 / bs) << " IOPS)";
+            if (variant == 0) {
+                plain[1] = write_throughput;
+                plain[0] = read_throughput;
+            } else if (plain[0] > 0) {
+                std::cout << ", delta vs plain: write " << (write_throughput / plain[1] - 1) * 100
+                          << "%, read " << (read_throughput / plain[0] - 1) * 100 << "%";
+            }
+            std::cout << "\n		write ";
+            cpu[1].print(std::cout);
+            std::cout << "\n		read ";
+            cpu[0].print(std::cout);
+            std::cout << "\n";
+        }
+    }
+
+    (void)close(nvmeFd);
+    return 0;
+}
+
+// Fill `size` bytes with the content of `input_file` repeated, or synthetic log lines without one
+void fill_input(char *buf, size_t size, const std::string& input_file) {
+    if (input_file.empty()) {
+        fill_log_lines(buf, size);
+        return;
+    }
+    std::ifstream in(input_file, std::ios::binary);
+    if (!in) {
+        std::cerr << "ERROR: open " << input_file << " failed" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    size_t pos = 0;
+    while (pos < size) {
+        in.read(buf + pos, size - pos);
+        size_t n = in.gcount();
+        if (n == 0) {
+            if (pos == 0) {
+                std::cerr << "ERROR: " << input_file << " is empty" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            in.clear();
+            in.seekg(0);
+        }
+        pos += n;
+    }
+}
+
+// Chunk of records just filled, (buf, len, offset) : buf has room for the padding to 4 KiB
+typedef std::function<void(char*, size_t, size_t)> ChunkHook;
+// Write of a chunk padded to 4 KiB, (fd, buf, write_len, offset)
+typedef std::function<void(int, char*, size_t, size_t)> ChunkWriter;
+
+/**
+ * Write `size` bytes of order records (whole records) to `path` in `chunk` byte steps. Each
+ * chunk is filled by fill_records(), handed to `hook` to change or look at it, padded with
+ * zeros to 4 KiB for O_DIRECT and written at its offset, by `writer` when there is one. The
+ * file is then truncated back to `size`.
+ */
+void write_order_file(const std::string& path, size_t size, size_t chunk, const ChunkHook& hook = nullptr,
+                      const ChunkWriter& writer = nullptr) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if (fd < 0) {
+        std::cerr << "ERROR: open " << path << " failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    char *buf = (char*)aligned_alloc(4096, (chunk + 4095) / 4096 * 4096);
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t len = std::min(chunk, size - offset);
+        size_t write_len = (len + 4095) / 4096 * 4096;
+        fill_records(buf, len, offset / sizeof(OrderRecord));
+        if (hook) hook(buf, len, offset);
+        memset(buf + len, 0, write_len - len);
+        if (writer) {
+            writer(fd, buf, write_len, offset);
+        } else if (pwrite(fd, buf, write_len, offset) != (ssize_t)write_len) {
+            std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(buf);
+    if (ftruncate(fd, size) != 0) {
+        std::cerr << "ERR: ftruncate failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    (void)close(fd);
+}
+
+/**
+ * Compression on the write path : the raw data is synced to the device, compressed block
+ * by block by lz4_compress_kernel into the p2p bo, and the packed blocks are P2P written
+ * to the SSD followed by the block index (lz4block format). Reports the bandwidth seen by
+ * the producer of the raw data and the bandwidth actually written to the SSD.
+ */
+int compress_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                       size_t raw_size, size_t block_size, const std::string& input_file, int num_iter) {
+    auto krnl = xrt::kernel(device, uuid, "lz4_compress_kernel");
+    uint32_t count = (raw_size + block_size - 1) / block_size;
+    if (lz4b_data_bound(raw_size, block_size) > bo.size()) {
+        std::cerr << "ERROR: " << raw_size << " bytes in " << block_size << " byte blocks do not fit in the p2p buffer" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    auto in_bo = xrt::bo(device, raw_size, krnl.group_id(0));
+    auto in_map = in_bo.map<char*>();
+    auto index_bo = xrt::bo(device, count * sizeof(Lz4bIndexEntry), krnl.group_id(2));
+    auto index = index_bo.map<Lz4bIndexEntry*>();
+    fill_input(in_map, raw_size, input_file);
+
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    double sum_raw = 0, sum_disk = 0, sum_p2p = 0;
+    long long sum_sync = 0, sum_kernel = 0, sum_write = 0;
+    size_t data_size = 0, compressed = 0;
+    CpuStats cpu;
+    std::cout << "\nStarting " << num_iter << " iterations of compressed W, " << count << " blocks of "
+              << (block_size >> 10) << " KiB\n";
+    for (int i = 0; i < num_iter; i++) {
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+
+        perf_counters.start();
+        in_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+        perf_counters.stop("compress: sync");
+        long long t_sync = timer.stop();
+
+        perf_counters.start();
+        auto run = krnl(in_bo, bo, index_bo, (unsigned int)raw_size, (unsigned int)block_size);
+        run.wait();
+        index_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+        perf_counters.stop("compress: kernel");
+        long long t_kernel = timer.stop();
+
+        // Blocks are packed 4 KiB aligned, the data region ends after the last one
+        const Lz4bIndexEntry& last = index[count - 1];
+        data_size = last.offset + lz4b_align(last.size & ~LZ4B_RAW_FLAG);
+        compressed = 0;
+        for (uint32_t b = 0; b < count; b++) compressed += index[b].size & ~LZ4B_RAW_FLAG;
+
+        perf_counters.start();
+        if (pwrite(nvmeFd, (void*)bo_map, data_size, LZ4B_ALIGN) != (ssize_t)data_size) {
+            std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        long long t_p2p = timer.stop();
+        int ret = lz4b_write_metadata(nvmeFd, index, count, block_size, raw_size, data_size);
+        if (ret != 0) {
+            std::cerr << "ERR: index write failed: " << strerror(-ret) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        perf_counters.stop("compress: pwrite");
+        long long duration = timer.stop();
+        cpu.add(cpu_meter.stop(), raw_size);
+
+        size_t disk_size = LZ4B_ALIGN + data_size + lz4b_align(count * sizeof(Lz4bIndexEntry));
+        sum_raw += ((double)raw_size * 1000000 / (1024 * 1024)) / duration;
+        sum_disk += ((double)disk_size * 1000000 / (1024 * 1024)) / duration;
+        sum_p2p += ((double)data_size * 1000000 / (1024 * 1024)) / (t_p2p - t_kernel);
+        sum_sync += t_sync;
+        sum_kernel += t_kernel - t_sync;
+        sum_write += duration - t_kernel;
+        std::cout << "Iteration " << i << " : " << (global_timer.stop()/1000000) << "s\n";
+    }
+
+    // Read the file back on the host and check it decodes to the input
+    bool verified = false;
+    Lz4bHeader header;
+    std::vector<Lz4bIndexEntry> disk_index;
+    char *data = (char*)aligned_alloc(LZ4B_ALIGN, data_size);
+    char *out = (char*)malloc(raw_size);
+    if (lz4b_read_metadata(nvmeFd, header, disk_index) == 0 && data && out &&
+        pread(nvmeFd, data, header.data_size, header.data_offset) == (ssize_t)header.data_size) {
+        verified = lz4b_decompress((uint8_t*)data, disk_index.data(), header.block_count, header.block_size, (uint8_t*)out) == 0 &&
+                   memcmp(out, in_map, raw_size) == 0;
+    }
+    free(data);
+    free(out);
+    (void)close(nvmeFd);
+
+    std::cout << "\nCompressed write achieved :\n"
+              << "		Compression ratio: " << (double)raw_size / compressed << " (" << (double)raw_size / data_size << " with 4 KiB alignment)\n"
+              << "		Average raw input throughput: " << sum_raw / num_iter << " MiB/s\n"
+              << "		Average on-disk throughput: " << sum_disk / num_iter << " MiB/s\n"
+              << "		Average P2P write throughput: " << sum_p2p / num_iter << " MiB/s\n"
+              << "		Average time sync/kernel/write: " << sum_sync / num_iter / 1000 << "/" << sum_kernel / num_iter / 1000
+              << "/" << sum_write / num_iter / 1000 << " ms\n"
+              << "		";
+    cpu.print(std::cout);
+    std::cout << "\n		Read back and CPU decompression: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Decompression on the read path of a file written by compress_benchmark : the compressed
+ * blocks are P2P read into the p2p bo and expanded by lz4_decompress_kernel into a second
+ * bo that is synced to the host. Compared with reading the same blocks into host memory
+ * with O_DIRECT and decompressing them on the CPU.
+ */
+int decompress_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map, int num_iter) {
+    auto krnl = xrt::kernel(device, uuid, "lz4_decompress_kernel");
+
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+    Lz4bHeader header;
+    std::vector<Lz4bIndexEntry> disk_index;
+    int ret = lz4b_read_metadata(nvmeFd, header, disk_index);
+    if (ret != 0) {
+        std::cerr << "ERROR: " << filepath << " is not a compressed file, run -m compress first: " << strerror(-ret) << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (header.data_size > bo.size()) {
+        std::cerr << "ERROR: the compressed data does not fit in the p2p buffer" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t raw_size = header.raw_size;
+    size_t data_size = header.data_size;
+    uint32_t count = header.block_count;
+
+    auto out_bo = xrt::bo(device, (size_t)count * header.block_size, krnl.group_id(1));
+    auto out_map = out_bo.map<char*>();
+    auto index_bo = xrt::bo(device, count * sizeof(Lz4bIndexEntry), krnl.group_id(2));
+    memcpy(index_bo.map<Lz4bIndexEntry*>(), disk_index.data(), count * sizeof(Lz4bIndexEntry));
+    index_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+    char *cpu_in = (char*)aligned_alloc(LZ4B_ALIGN, data_size);
+    char *cpu_out = (char*)malloc((size_t)count * header.block_size);
+
+    double sum_fpga = 0, sum_fpga_device = 0, sum_p2p = 0, sum_cpu = 0, sum_cpu_read = 0;
+    CpuStats cpu_fpga, cpu_cpu;
+    std::cout << "\nStarting " << num_iter << " iterations of decompressed R, " << count << " blocks of "
+              << (header.block_size >> 10) << " KiB, ratio " << (double)raw_size / data_size << "\n";
+    for (int i = 0; i < num_iter; i++) {
+        // P2P read then decompression next to the drive
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        perf_counters.start();
+        if (pread(nvmeFd, (void*)bo_map, data_size, header.data_offset) != (ssize_t)data_size) {
+            std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        perf_counters.stop("decompress: pread");
+        long long t_p2p = timer.stop();
+        perf_counters.start();
+        auto run = krnl(bo, out_bo, index_bo, count, header.block_size);
+        run.wait();
+        perf_counters.stop("decompress: kernel");
+        long long t_kernel = timer.stop();
+        perf_counters.start();
+        out_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+        perf_counters.stop("decompress: sync");
+        long long duration = timer.stop();
+        cpu_fpga.add(cpu_meter.stop(), raw_size);
+
+        sum_p2p += ((double)data_size * 1000000 / (1024 * 1024)) / t_p2p;
+        sum_fpga_device += ((double)raw_size * 1000000 / (1024 * 1024)) / t_kernel;
+        sum_fpga += ((double)raw_size * 1000000 / (1024 * 1024)) / duration;
+
+        // Same data read into host memory and decompressed on the CPU
+        timer = Timer();
+        cpu_meter = CpuMeter();
+        if (pread(nvmeFd, cpu_in, data_size, header.data_offset) != (ssize_t)data_size) {
+            std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        long long t_read = timer.stop();
+        if (lz4b_decompress((uint8_t*)cpu_in, disk_index.data(), count, header.block_size, (uint8_t*)cpu_out) != 0) {
+            std::cerr << "ERR: CPU decompression failed, corrupted file" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        duration = timer.stop();
+        cpu_cpu.add(cpu_meter.stop(), raw_size);
+        sum_cpu_read += ((double)data_size * 1000000 / (1024 * 1024)) / t_read;
+        sum_cpu += ((double)raw_size * 1000000 / (1024 * 1024)) / duration;
+
+        std::cout << "Iteration " << i << " : " << (global_timer.stop()/1000000) << "s\n";
+    }
+
+    bool verified = memcmp(out_map, cpu_out, raw_size) == 0;
+    free(cpu_in);
+    free(cpu_out);
+    (void)close(nvmeFd);
+
+    std::cout << "\nDecompressed read achieved :\n"
+              << "		Average P2P read throughput: " << sum_p2p / num_iter << " MiB/s compressed\n"
+              << "		Average fpga throughput, on device: " << sum_fpga_device / num_iter << " MiB/s decompressed\n"
+              << "		Average fpga throughput, end to end: " << sum_fpga / num_iter << " MiB/s decompressed\n"
+              << "		";
+    cpu_fpga.print(std::cout);
+    std::cout << "\n\n		Average host read throughput: " << sum_cpu_read / num_iter << " MiB/s compressed\n"
+              << "		Average cpu throughput, end to end: " << sum_cpu / num_iter << " MiB/s decompressed\n"
+              << "		";
+    cpu_cpu.print(std::cout);
+    std::cout << "\n		FPGA output matches CPU decompression: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Encryption of data at rest : on the write path aes256_ctr_kernel encrypts the synced data
+ * into the p2p bo before the P2P write, on the read path it decrypts the P2P read data into
+ * a bo that is synced to the host. Each iteration also runs the plaintext path on the same
+ * bytes to report the bandwidth penalty.
+ */
+int crypt_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                    size_t size, const std::string& input_file, int num_iter) {
+    if (!aes256_ctr_self_test()) {
+        std::cerr << "ERROR: AES-256-CTR reference failed its known answer test" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (size > bo.size()) {
+        std::cerr << "ERROR: " << size << " bytes do not fit in the p2p buffer" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto krnl = xrt::kernel(device, uuid, "aes256_ctr_kernel");
+
+    // A fresh key and IV per run, the key schedule is done once here
+    std::random_device entropy;
+    uint8_t key[AES256_KEY_SIZE];
+    uint8_t iv[AES_BLOCK_SIZE];
+    for (auto& b : key) b = entropy();
+    for (auto& b : iv) b = entropy();
+    auto keys_bo = xrt::bo(device, AES256_KERNEL_KEYS_SIZE, krnl.group_id(2));
+    auto keys = keys_bo.map<uint8_t*>();
+    aes256_expand_key(key, keys);
+    memcpy(keys + AES256_ROUND_KEYS_SIZE, iv, AES_BLOCK_SIZE);
+    keys_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+
+    auto in_bo = xrt::bo(device, size, krnl.group_id(0));
+    auto in_map = in_bo.map<char*>();
+    auto out_bo = xrt::bo(device, size, krnl.group_id(1));
+    auto out_map = out_bo.map<char*>();
+    fill_input(in_map, size, input_file);
+
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // [plaintext, encrypted] x [write, read]
+    double sum[2][2] = {{0, 0}, {0, 0}};
+    CpuStats cpu[2][2];
+    double throughput = (double)size * 1000000 / (1024 * 1024);
+    std::cout << "\nStarting " << num_iter << " iterations plaintext/encrypted W/R\n";
+    for (int i = 0; i < num_iter; i++) {
+        // The kernel of the previous iteration left the ciphertext in the p2p bo
+        memcpy(bo_map, in_map, size);
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, size, 0);
+        if (pwrite(nvmeFd, (void*)bo_map, size, 0) != (ssize_t)size) {
+            std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        sum[0][0] += throughput / timer.stop();
+        cpu[0][0].add(cpu_meter.stop(), size);
+
+        timer = Timer();
+        cpu_meter = CpuMeter();
+        if (pread(nvmeFd, (void*)bo_map, size, 0) != (ssize_t)size) {
+            std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, size, 0);
+        sum[0][1] += throughput / timer.stop();
+        cpu[0][1].add(cpu_meter.stop(), size);
+
+        timer = Timer();
+        cpu_meter = CpuMeter();
+        perf_counters.start();
+        in_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+        perf_counters.stop("encrypt: sync");
+        perf_counters.start();
+        auto run = krnl(in_bo, bo, keys_bo, (unsigned long long)0, (unsigned int)size);
+        run.wait();
+        perf_counters.stop("encrypt: kernel");
+        perf_counters.start();
+        if (pwrite(nvmeFd, (void*)bo_map, size, 0) != (ssize_t)size) {
+            std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        perf_counters.stop("encrypt: pwrite");
+        sum[1][0] += throughput / timer.stop();
+        cpu[1][0].add(cpu_meter.stop(), size);
+
+        timer = Timer();
+        cpu_meter = CpuMeter();
+        perf_counters.start();
+        if (pread(nvmeFd, (void*)bo_map, size, 0) != (ssize_t)size) {
+            std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        perf_counters.stop("decrypt: pread");
+        perf_counters.start();
+        run = krnl(bo, out_bo, keys_bo, (unsigned long long)0, (unsigned int)size);
+        run.wait();
+        perf_counters.stop("decrypt: kernel");
+        perf_counters.start();
+        out_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+        perf_counters.stop("decrypt: sync");
+        sum[1][1] += throughput / timer.stop();
+        cpu[1][1].add(cpu_meter.stop(), size);
+
+        std::cout << "Iteration " << i << " : " << (global_timer.stop()/1000000) << "s\n";
+    }
+
+    // The file now holds ciphertext : it must match the reference and decrypt back to the input
+    bool roundtrip = memcmp(out_map, in_map, size) == 0;
+    bool reference = false;
+    char *disk = (char*)aligned_alloc(4096, size);
+    char *expected = (char*)malloc(size);
+    if (disk && expected && pread(nvmeFd, disk, size, 0) == (ssize_t)size) {
+        aes256_ctr(keys, iv, 0, (uint8_t*)in_map, (uint8_t*)expected, size);
+        reference = memcmp(disk, expected, size) == 0;
+    }
+    free(disk);
+    free(expected);
+    (void)close(nvmeFd);
+
+    const char *names[2] = {"plaintext", "encrypted"};
+    const char *directions[2] = {"Write", "Read"};
+    for (int dir = 0; dir < 2; dir++) {
+        std::cout << "\n" << directions[dir] << " bandwidth achieved :\n";
+        for (int enc = 0; enc < 2; enc++) {
+            std::cout << "		Average throughput " << names[enc] << ": " << sum[enc][dir] / num_iter << " MiB/s\n		";
+            cpu[enc][dir].print(std::cout);
+            std::cout << "\n";
+        }
+        std::cout << "		Encryption penalty: " << (1 - sum[1][dir] / sum[0][dir]) * 100 << "%\n";
+    }
+    std::cout << "\nCiphertext on disk matches the reference: " << (reference ? "OK" : "MISMATCH")
+              << "\nDecrypted data matches the input: " << (roundtrip ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return reference && roundtrip ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Write `size` bytes of `block_size` blocks where about `dup_ratio` of the blocks repeat one
+ * of a small pool of popular blocks and the others are unique. Goes through host memory,
+ * it only prepares the data of the dedup scan.
+ */
+void write_dedup_data(int fd, size_t size, size_t block_size, double dup_ratio) {
+    const size_t pool_size = 1024;
+    const size_t chunk = std::max(block_size, (size_t)(64 << 20) / block_size * block_size);
+    char *buf = (char*)aligned_alloc(4096, chunk);
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> coin(0, 1);
+
+    std::cout << "Writing " << (size >> 20) << " MiB with " << dup_ratio * 100 << "% duplicate blocks\n";
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t len = std::min(chunk, size - offset);
+        for (size_t pos = 0; pos < len; pos += block_size) {
+            // Block content is a function of its seed : the pool entry or its own index
+            uint64_t block = (offset + pos) / block_size;
+            uint64_t seed = coin(rng) < dup_ratio ? rng() % pool_size : pool_size + block;
+            std::mt19937_64 content(seed);
+            for (size_t i = 0; i + 8 <= block_size; i += 8) {
+                uint64_t word = content();
+                memcpy(buf + pos + i, &word, 8);
+            }
+        }
+        if (pwrite(fd, buf, len, offset) != (ssize_t)len) {
+            std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(buf);
+}
+
+/**
+ * Dedup scan : the file is P2P read chunk by chunk into the p2p bo and sha256_blocks_kernel
+ * fingerprints every block next to the drive. Only the fingerprint array is synced to the
+ * host, where the dedup index counts the duplicate blocks.
+ */
+int dedup_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                    size_t span, size_t block_size, double dup_ratio, int num_iter) {
+    auto krnl = xrt::kernel(device, uuid, "sha256_blocks_kernel");
+    size_t chunk = bo.size() / block_size * block_size;
+    size_t scan_size = span / block_size * block_size;
+    size_t chunk_blocks = chunk / block_size;
+
+    auto digest_bo = xrt::bo(device, chunk_blocks * SHA256_DIGEST_SIZE, krnl.group_id(1));
+    auto digests = digest_bo.map<uint8_t*>();
+
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (dup_ratio >= 0) write_dedup_data(nvmeFd, scan_size, block_size, dup_ratio);
+
+    DedupIndex index;
+    double sum = 0, max = 0;
+    CpuStats cpu;
+    bool verified = true;
+    std::cout << "\nStarting " << num_iter << " dedup scans of " << (scan_size >> 20) << " MiB in "
+              << (block_size >> 10) << " KiB blocks\n";
+    for (int i = 0; i < num_iter; i++) {
+        index.clear();
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        for (size_t offset = 0; offset < scan_size; offset += chunk) {
+            size_t len = std::min(chunk, scan_size - offset);
+            perf_counters.start();
+            if (pread(nvmeFd, (void*)bo_map, len, offset) != (ssize_t)len) {
+                std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            perf_counters.stop("dedup: pread");
+            perf_counters.start();
+            auto run = krnl(bo, digest_bo, (unsigned int)len, (unsigned int)block_size);
+            run.wait();
+            size_t count = len / block_size;
+            digest_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, count * SHA256_DIGEST_SIZE, 0);
+            perf_counters.stop("dedup: kernel");
+            for (size_t b = 0; b < count; b++) {
+                index.add(digests + b * SHA256_DIGEST_SIZE, offset / block_size + b);
+            }
+
+            // Spot check the first fingerprints against the reference
+            if (i == 0 && offset == 0) {
+                for (size_t b = 0; b < std::min(count, (size_t)16); b++) {
+                    uint8_t expected[SHA256_DIGEST_SIZE];
+                    sha256((const uint8_t*)bo_map + b * block_size, block_size, expected);
+                    verified &= memcmp(expected, digests + b * SHA256_DIGEST_SIZE, SHA256_DIGEST_SIZE) == 0;
+                }
+            }
+        }
+        long long duration = timer.stop();
+        cpu.add(cpu_meter.stop(), scan_size);
+        double throughput = ((double)scan_size * 1000000 / (1024 * 1024)) / duration;
+        sum += throughput;
+        max = std::max(max, throughput);
+        std::cout << "Iteration " << i << " : " << (global_timer.stop()/1000000) << "s\n";
+    }
+    (void)close(nvmeFd);
+
+    size_t digest_bytes = index.blocks() * SHA256_DIGEST_SIZE;
+    std::cout << "\nDedup scan achieved :\n"
+              << "		Max scan throughput: " << max << " MiB/s\n"
+              << "		Average scan throughput: " << sum / num_iter << " MiB/s\n"
+              << "		Blocks: " << index.blocks() << ", unique: " << index.unique()
+              << ", duplicate ratio: " << index.duplicate_ratio() * 100 << "%\n"
+              << "		Bytes to host: " << digest_bytes << " instead of " << scan_size << " ("
+              << (1 - (double)digest_bytes / scan_size) * 100 << "% of the PCIe traffic saved)\n"
+              << "		";
+    cpu.print(std::cout);
+    std::cout << "\n		Fingerprints match the reference: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+Schema order_schema() {
+    Schema schema;
+    schema.columns = {{"id", FILTER_INT64, offsetof(OrderRecord, id)},
+                      {"key", FILTER_INT32, offsetof(OrderRecord, key)},
+                      {"category", FILTER_INT32, offsetof(OrderRecord, category)},
+                      {"price", FILTER_FLOAT64, offsetof(OrderRecord, price)},
+                      {"quantity", FILTER_INT64, offsetof(OrderRecord, quantity)}};
+    schema.record_size = sizeof(OrderRecord);
+    return schema;
+}
+
+/**
+ * Predicate pushdown scan : `size` bytes of order records are written to the file, then
+ * scanned with `key < T` predicates of increasing selectivity. The effective bandwidth is
+ * the bytes of records scanned per second, whatever the output, so it shows how the cost of
+ * the results sent to the host grows with the selectivity for the bitmap and row outputs.
+ */
+int scan_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                   size_t size, int num_iter) {
+    static const double selectivities[] = {0.001, 0.01, 0.1, 0.5, 1.0};
+    static const int num_selectivities = sizeof(selectivities) / sizeof(selectivities[0]);
+    const size_t chunk = 64 << 20;
+    Schema schema = order_schema();
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+
+    // Write the records through the host, counting the expected matches on the way
+    std::cout << "Writing " << (size >> 20) << " MiB of " << sizeof(OrderRecord) << " bytes records\n";
+    uint64_t expected[num_selectivities] = {0};
+    write_order_file(filepath, size, chunk, [&](char *buf, size_t len, size_t) {
+        for (size_t pos = 0; pos < len; pos += sizeof(OrderRecord)) {
+            const OrderRecord *record = (const OrderRecord*)(buf + pos);
+            for (int s = 0; s < num_selectivities; s++) {
+                expected[s] += record->key < selectivities[s] * ORDER_KEY_RANGE;
+            }
+        }
+    });
+
+    Scanner scanner(device, uuid, bo, bo_map);
+    bool verified = true;
+    std::cout << "\nStarting " << num_iter << " scans of " << (size >> 20) << " MiB per selectivity and output\n";
+    for (int output = SCAN_BITMAP; output <= SCAN_ROWS; output++) {
+        std::cout << "\nOutput " << (output == SCAN_BITMAP ? "bitmap" : "rows") << " :\n";
+        for (int s = 0; s < num_selectivities; s++) {
+            Predicate predicate = Predicate().where("key", FILTER_LT, selectivities[s] * ORDER_KEY_RANGE);
+            double sum = 0, max = 0;
+            CpuStats cpu;
+            ScanResult result = ScanResult();
+            for (int i = 0; i < num_iter; i++) {
+                Timer timer = Timer();
+                CpuMeter cpu_meter = CpuMeter();
+                perf_counters.start();
+                result = scanner.scan(filepath, schema, predicate, (ScanOutput)output, size);
+                perf_counters.stop(output == SCAN_BITMAP ? "scan: bitmap" : "scan: rows");
+                long long duration = timer.stop();
+                cpu.add(cpu_meter.stop(), result.bytes_scanned);
+                double throughput = ((double)result.bytes_scanned * 1000000 / (1024 * 1024)) / duration;
+                sum += throughput;
+                max = std::max(max, throughput);
+            }
+
+            // Match count against the host reference, rows and bitmap against the predicate
+            bool ok = result.matches == expected[s];
+            std::vector<FilterPredicate> encoded = encode_predicate(schema, predicate);
+            if (output == SCAN_ROWS) {
+                ok &= result.rows.size() == result.matches * sizeof(OrderRecord);
+                for (size_t pos = 0; ok && pos < result.rows.size(); pos += sizeof(OrderRecord)) {
+                    ok &= evaluate(encoded, result.rows.data() + pos);
+                }
+            } else {
+                uint64_t bits = 0;
+                for (uint32_t word : result.bitmap) bits += __builtin_popcount(word);
+                ok &= bits == result.matches;
+            }
+            verified &= ok;
+
+            std::cout << "		Selectivity " << selectivities[s] * 100 << "% (" << result.matches << " of "
+                      << result.records << " records) : max " << max << " MiB/s, average " << sum / num_iter
+                      << " MiB/s, " << (result.bytes_to_host >> 10) << " KiB to host"
+                      << (ok ? "" : " MISMATCH") << "\n		";
+            cpu.print(std::cout);
+            std::cout << "\n";
+        }
+    }
+
+    std::cout << "\nScan results match the reference: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Projected vs full-row scans : `size` bytes of order records are written both as rows to
+ * the file and in the columnar format to <file>.colf, in groups of `group_rows` records.
+ * The full-row scan P2P reads the whole records into the p2p bo, the projected scan only
+ * the column chunks of `projection`. Both deliver the same values to the device, so the
+ * bandwidth is given as logical bytes of the projected columns per second.
+ */
+int columnar_benchmark(const std::string& filepath, xrt::bo bo, int *bo_map, size_t size,
+                       const std::vector<std::string>& projection, int num_iter) {
+    const uint32_t group_rows = 8 << 20;
+    const size_t group_size = (size_t)group_rows * sizeof(OrderRecord);
+    const std::string colf_path = filepath + ".colf";
+    Schema schema = order_schema();
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+
+    std::vector<ColfColumn> columns;
+    std::vector<uint32_t> offsets;
+    for (const Column& column : schema.columns) {
+        columns.push_back(colf_column(column.name, column.type));
+        offsets.push_back(column.offset);
+    }
+
+    ColumnarWriter writer(columns);
+    int ret = writer.open(colf_path);
+    if (ret != 0) {
+        std::cerr << "ERROR: open " << colf_path << "failed: " << strerror(-ret) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Same records in both layouts, one row group per chunk of the row file
+    std::cout << "Writing " << (size >> 20) << " MiB of records as rows and as columns\n";
+    write_order_file(filepath, size, group_size, [&](char *buf, size_t len, size_t) {
+        int ret = writer.write_rows(buf, sizeof(OrderRecord), offsets, len / sizeof(OrderRecord));
+        if (ret != 0) {
+            std::cerr << "ERR: columnar write failed: " << strerror(-ret) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    });
+    if (writer.close() != 0) {
+        std::cerr << "ERR: finishing the files failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    int nvmeFd = open(filepath.c_str(), O_RDONLY | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+    char *buf = (char*)aligned_alloc(4096, group_size);
+
+    ColumnarReader reader;
+    ret = reader.open(colf_path);
+    if (ret != 0) {
+        std::cerr << "ERROR: open " << colf_path << "failed: " << strerror(-ret) << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::vector<int> projected;
+    size_t logical_width = 0;
+    for (const std::string& name : projection) {
+        int c = reader.column_index(name);
+        if (c < 0) {
+            std::cerr << "ERROR: unknown column " << name << std::endl;
+            return EXIT_FAILURE;
+        }
+        projected.push_back(c);
+        logical_width += reader.columns()[c].width;
+    }
+    if (reader.group_bytes(projected) > bo.size() || group_size > bo.size()) {
+        std::cerr << "ERROR: a row group does not fit in the p2p buffer" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    size_t logical = reader.rows() * logical_width;
+    size_t projected_read = 0;
+    double sum[2] = {0, 0}, max[2] = {0, 0};
+    CpuStats cpu[2];
+    bool verified = true;
+    std::vector<size_t> chunk_offsets;
+    std::cout << "\nStarting " << num_iter << " full-row and projected scans of " << reader.rows() << " records\n";
+    for (int i = 0; i < num_iter; i++) {
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        for (size_t offset = 0; offset < size; offset += group_size) {
+            size_t len = std::min(group_size, size - offset);
+            size_t read_len = (len + 4095) / 4096 * 4096;
+            perf_counters.start();
+            if (pread(nvmeFd, (void*)bo_map, read_len, offset) < (ssize_t)len) {
+                std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            perf_counters.stop("columnar: rows");
+        }
+        long long duration = timer.stop();
+        cpu[0].add(cpu_meter.stop(), logical);
+        double throughput = ((double)logical * 1000000 / (1024 * 1024)) / duration;
+        sum[0] += throughput;
+        max[0] = std::max(max[0], throughput);
+
+        timer.reset();
+        cpu_meter.start();
+        projected_read = 0;
+        for (uint32_t g = 0; g < reader.groups(); g++) {
+            perf_counters.start();
+            ssize_t bytes = reader.read_group(g, projected, bo_map, chunk_offsets);
+            perf_counters.stop("columnar: projected");
+            if (bytes < 0) {
+                std::cerr << "ERR: column read failed: " << strerror(-bytes) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            projected_read += bytes;
+
+            // The first group on the device holds the projected fields of the records
+            if (i == 0 && g == 0) {
+                uint32_t rows = reader.chunk(0, 0).rows;
+                fill_records(buf, (size_t)rows * sizeof(OrderRecord), 0);
+                for (size_t p = 0; p < projected.size(); p++) {
+                    const char *values = (const char*)bo_map + chunk_offsets[p];
+                    uint32_t width = reader.columns()[projected[p]].width;
+                    for (uint32_t r = 0; r < rows && verified; r++) {
+                        verified &= memcmp(values + (size_t)r * width, buf + (size_t)r * sizeof(OrderRecord) + offsets[projected[p]], width) == 0;
+                    }
+                }
+            }
+        }
+        duration = timer.stop();
+        cpu[1].add(cpu_meter.stop(), logical);
+        throughput = ((double)logical * 1000000 / (1024 * 1024)) / duration;
+        sum[1] += throughput;
+        max[1] = std::max(max[1], throughput);
+        std::cout << "Iteration " << i << " : " << (global_timer.stop()/1000000) << "s\n";
+    }
+    free(buf);
+    (void)close(nvmeFd);
+
+    static const char *names[] = {"Full-row", "Projected"};
+    size_t ssd_bytes[] = {size, projected_read};
+    std::cout << "\nScans of " << projection.size() << " of " << reader.columns().size() << " columns ("
+              << (logical >> 20) << " MiB of logical output) achieved :\n";
+    for (int s = 0; s < 2; s++) {
+        std::cout << "	" << names[s] << " scan :\n"
+                  << "		Max logical throughput: " << max[s] << " MiB/s\n"
+                  << "		Average logical throughput: " << sum[s] / num_iter << " MiB/s\n"
+                  << "		Bytes read from the SSD: " << (ssd_bytes[s] >> 20) << " MiB\n"
+                  << "		";
+        cpu[s].print(std::cout);
+        std::cout << "\n";
+    }
+    std::cout << "	Projection speedup: " << sum[1] / sum[0] << "x\n"
+              << "\nProjected columns match the records: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Zone map skipping : for random, semi-sorted and sorted keys, `size` bytes of order records
+ * go through the p2p bo where zonemap_kernel computes the min/max key of every `zone_bs`
+ * block before the P2P write, and the zone map is saved next to the file. Range scans on
+ * the key then run with and without the zone map.
+ */
+int zonemap_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                      size_t size, size_t zone_bs, int num_iter) {
+    static const struct { const char *name; double disorder; } orders[] = {{"random", -1}, {"semi-sorted", 0.01}, {"sorted", 0}};
+    static const double widths[] = {0.001, 0.01, 0.1};
+    auto krnl = xrt::kernel(device, uuid, "zonemap_kernel");
+    Schema schema = order_schema();
+    const Column& key = schema.column("key");
+    const std::string zmap_path = filepath + ".zmap";
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+    if (zone_bs == 0 || zone_bs % 4096 != 0) {
+        std::cerr << "ERROR: the zone map block size must be a multiple of 4 KiB" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t chunk = std::min(bo.size(), (size_t)256 << 20) / zone_bs * zone_bs;
+    uint32_t block_records = zone_bs / sizeof(OrderRecord);
+
+    auto zone_bo = xrt::bo(device, chunk / zone_bs * sizeof(ZoneEntry), krnl.group_id(1));
+    auto zone_entries = zone_bo.map<ZoneEntry*>();
+    Scanner scanner(device, uuid, bo, bo_map);
+    bool verified = true;
+
+    for (const auto& order : orders) {
+        // The zone map is computed on the device between the sync and the P2P write
+        std::cout << "\nWriting " << (size >> 20) << " MiB of records with " << order.name << " keys\n";
+        ZoneMap zones(sizeof(OrderRecord), key.offset, key.type, zone_bs);
+        ZoneMap reference(sizeof(OrderRecord), key.offset, key.type, zone_bs);
+        Timer timer = Timer();
+        long long t_kernel = 0;
+        auto hook = [&](char *buf, size_t len, size_t offset) {
+            if (order.disorder >= 0) order_keys(buf, len, offset / sizeof(OrderRecord), size / sizeof(OrderRecord), order.disorder);
+            reference.add_records((const uint8_t*)buf, len);
+        };
+        write_order_file(filepath, size, chunk, hook, [&](int nvmeFd, char *buf, size_t write_len, size_t offset) {
+            memcpy(bo_map, buf, write_len);
+            bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, write_len, 0);
+
+            Timer kernel_timer = Timer();
+            uint32_t records = std::min(write_len, size - offset) / sizeof(OrderRecord);
+            uint32_t count = (records + block_records - 1) / block_records;
+            perf_counters.start();
+            auto run = krnl(bo, zone_bo, (unsigned int)sizeof(OrderRecord), key.offset, (unsigned int)key.type, records, block_records);
+            run.wait();
+            zone_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, count * sizeof(ZoneEntry), 0);
+            perf_counters.stop("zonemap: kernel");
+            t_kernel += kernel_timer.stop();
+            zones.append(zone_entries, count);
+
+            perf_counters.start();
+            if (pwrite(nvmeFd, (void*)bo_map, write_len, offset) != (ssize_t)write_len) {
+                std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            perf_counters.stop("zonemap: pwrite");
+        });
+        long long t_write = timer.stop();
+
+        bool same = zones.blocks() == reference.blocks() &&
+                    memcmp(zones.entries().data(), reference.entries().data(), zones.blocks() * sizeof(ZoneEntry)) == 0;
+        verified &= same;
+        ZoneMap loaded;
+        int ret = zones.save(zmap_path);
+        if (ret == 0) ret = loaded.load(zmap_path);
+        if (ret != 0) {
+            std::cerr << "ERR: zone map " << zmap_path << " failed: " << strerror(-ret) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::cout << "		" << zones.blocks() << " zones of " << (zone_bs >> 10) << " KiB, kernel time "
+                  << t_kernel * 100 / std::max(t_write, 1LL) << "% of the write, match the host reference: "
+                  << (same ? "OK" : "MISMATCH") << "\n";
+
+        // Centered ranges of the key, key >= lo && key < hi
+        for (double width : widths) {
+            double lo = (0.5 - width / 2) * ORDER_KEY_RANGE, hi = (0.5 + width / 2) * ORDER_KEY_RANGE;
+            Predicate predicate = Predicate().where("key", FILTER_GE, lo).where("key", FILTER_LT, hi);
+            double sum[2] = {0, 0};
+            ScanResult result[2] = {ScanResult(), ScanResult()};
+            for (int z = 0; z < 2; z++) {
+                for (int i = 0; i < num_iter; i++) {
+                    Timer scan_timer = Timer();
+                    perf_counters.start();
+                    result[z] = scanner.scan(filepath, schema, predicate, SCAN_BITMAP, size, z ? &loaded : nullptr);
+                    perf_counters.stop(z ? "zonemap: skipping scan" : "zonemap: full scan");
+                    long long duration = scan_timer.stop();
+                    sum[z] += ((double)result[z].bytes_scanned * 1000000 / (1024 * 1024)) / duration;
+                }
+            }
+            bool ok = result[0].matches == result[1].matches && result[0].bitmap == result[1].bitmap;
+            verified &= ok;
+            std::cout << "		Range " << width * 100 << "% (" << result[1].matches << " records) : skipped "
+                      << (double)result[1].bytes_skipped * 100 / size << "%, effective scan throughput "
+                      << sum[1] / num_iter << " MiB/s vs " << sum[0] / num_iter << " MiB/s without the zone map"
+                      << (ok ? "" : " MISMATCH") << "\n";
+        }
+    }
+
+    std::cout << "\nZone maps and skipping scans match the references: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Bloom filter lookups : for each false positive rate, `size` bytes of order records with
+ * scattered ids go through the p2p bo where bloom_build_kernel builds the filter of the ids
+ * of every `segment_bs` segment before the P2P write. `num_lookups` absent and present ids
+ * are then looked up : the filters give the candidate segments and only those are P2P read
+ * and searched by filter_kernel.
+ */
+int bloom_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                    size_t size, size_t segment_bs, const std::vector<double>& fprs, int num_lookups) {
+    auto krnl = xrt::kernel(device, uuid, "bloom_build_kernel");
+    Schema schema = order_schema();
+    const Column& id = schema.column("id");
+    const std::string bloom_path = filepath + ".bloom";
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+    if (segment_bs == 0 || segment_bs % 4096 != 0) {
+        std::cerr << "ERROR: the Bloom filter segment size must be a multiple of 4 KiB" << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t chunk = std::min(bo.size(), (size_t)256 << 20) / segment_bs * segment_bs;
+    uint32_t segment_records = segment_bs / sizeof(OrderRecord);
+    uint64_t total = size / sizeof(OrderRecord);
+
+    Scanner scanner(device, uuid, bo, bo_map);
+    std::mt19937_64 rng(11);
+    bool verified = true;
+
+    for (double fpr : fprs) {
+        BloomIndex bloom(sizeof(OrderRecord), id.offset, 8, segment_records, fpr);
+        BloomIndex reference(sizeof(OrderRecord), id.offset, 8, segment_records, fpr);
+        size_t filter_bytes = bloom.filter_words() * sizeof(uint32_t);
+        auto filter_bo = xrt::bo(device, chunk / segment_bs * filter_bytes, krnl.group_id(1));
+        auto filters = filter_bo.map<uint32_t*>();
+
+        // The filters are built on the device between the sync and the P2P write
+        std::cout << "\nWriting " << (size >> 20) << " MiB of records, Bloom filters for a " << fpr * 100
+                  << "% false positive rate : " << bloom.filter_bits() << " bits and "
+                  << bloom.num_hashes() << " hashes per segment\n";
+        auto hook = [&](char *buf, size_t len, size_t) {
+            scramble_ids(buf, len);
+            reference.add_records((const uint8_t*)buf, len);
+        };
+        write_order_file(filepath, size, chunk, hook, [&](int nvmeFd, char *buf, size_t write_len, size_t offset) {
+            memcpy(bo_map, buf, write_len);
+            bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, write_len, 0);
+
+            uint32_t records = std::min(write_len, size - offset) / sizeof(OrderRecord);
+            uint32_t count = (records + segment_records - 1) / segment_records;
+            perf_counters.start();
+            auto run = krnl(bo, filter_bo, (unsigned int)sizeof(OrderRecord), id.offset, 8u, records, segment_records,
+                            bloom.filter_bits(), bloom.num_hashes());
+            run.wait();
+            filter_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, count * filter_bytes, 0);
+            perf_counters.stop("bloom: kernel");
+            bloom.append(filters, count);
+
+            perf_counters.start();
+            if (pwrite(nvmeFd, (void*)bo_map, write_len, offset) != (ssize_t)write_len) {
+                std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            perf_counters.stop("bloom: pwrite");
+        });
+
+        bool same = bloom.filters() == reference.filters();
+        verified &= same;
+        BloomIndex loaded;
+        int ret = bloom.save(bloom_path);
+        if (ret == 0) ret = loaded.load(bloom_path);
+        if (ret != 0) {
+            std::cerr << "ERR: Bloom index " << bloom_path << " failed: " << strerror(-ret) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::cout << "		" << loaded.segments() << " segments, index of " << (loaded.filters().size() * 4 >> 10)
+                  << " KiB, match the host reference: " << (same ? "OK" : "MISMATCH") << "\n";
+
+        // Absent ids are the scrambled ids past the last record
+        for (int present = 0; present < 2; present++) {
+            size_t reads = 0, untouched = 0, false_segments = 0, found = 0;
+            CpuStats cpu;
+            Timer timer = Timer();
+            CpuMeter cpu_meter = CpuMeter();
+            for (int i = 0; i < num_lookups; i++) {
+                uint64_t key = scramble_id(present ? rng() % total : total + rng() % total);
+                perf_counters.start();
+                std::vector<size_t> candidates = loaded.candidates(key);
+                perf_counters.stop("bloom: probe");
+                Predicate predicate = Predicate().where("id", FILTER_EQ, (double)key);
+                bool hit = false;
+                for (size_t segment : candidates) {
+                    size_t start = segment * segment_bs;
+                    perf_counters.start();
+                    ScanResult result = scanner.scan_range(filepath, schema, predicate, SCAN_ROWS, start,
+                                                           std::min(segment_bs, size - start));
+                    perf_counters.stop("bloom: segment read");
+                    reads++;
+                    if (result.matches > 0) {
+                        hit = true;
+                        break;
+                    }
+                    false_segments++;
+                }
+                untouched += candidates.empty();
+                found += hit;
+            }
+            long long duration = timer.stop();
+            cpu.add(cpu_meter.stop(), reads * segment_bs);
+            bool ok = found == (present ? (size_t)num_lookups : 0);
+            verified &= ok;
+
+            std::cout << "		" << (present ? "Present" : "Absent") << " ids : " << (double)num_lookups * 1000000 / duration
+                      << " lookups/s, " << (double)reads / num_lookups << " segment reads per lookup, "
+                      << (1 - (double)reads / ((double)num_lookups * loaded.segments())) * 100
+                      << "% of the SSD reads avoided";
+            if (!present) {
+                std::cout << ", " << (double)untouched * 100 / num_lookups << "% of the lookups without SSD read"
+                          << ", segment false positive rate " << (double)false_segments * 100 / ((double)num_lookups * loaded.segments())
+                          << "% (expected " << loaded.expected_fpr() * 100 << "%)";
+            }
+            std::cout << (ok ? "" : " MISMATCH") << "\n		";
+            cpu.print(std::cout);
+            std::cout << "\n";
+        }
+    }
+    std::cout << "\nBloom filters and lookups match the references: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Log search : `size` bytes of logs (synthetic or repeated from `input_file`) are written
+ * to the file, then searched for `pattern` by grep_kernel on chunks P2P read into the p2p
+ * bo, and on the host after O_DIRECT reads, with the AVX2 prefilter and with the scalar
+ * automaton alone. Only the offsets of the matching lines come back from the device.
+ */
+int grep_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                   size_t size, const std::string& input_file, const std::string& pattern, bool literal, int num_iter) {
+    static const char *names[] = {"FPGA", "Host AVX2", "Host scalar"};
+    GrepProgram program;
+    if (grep_compile(pattern, program, literal) != 0) {
+        std::cerr << "ERROR: unsupported pattern " << pattern << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Writing " << (size >> 20) << " MiB of logs\n";
+    size_t write_size = (size + 4095) / 4096 * 4096;
+    char *buf = (char*)aligned_alloc(4096, write_size);
+    fill_input(buf, size, input_file);
+    memset(buf + size, '\n', write_size - size);
+    for (size_t offset = 0; offset < write_size; offset += (size_t)64 << 20) {
+        size_t len = std::min((size_t)64 << 20, write_size - offset);
+        if (pwrite(nvmeFd, buf + offset, len, offset) != (ssize_t)len) {
+            std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(buf);
+    if (ftruncate(nvmeFd, size) != 0) {
+        std::cerr << "ERR: ftruncate failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    (void)close(nvmeFd);
+
+    Grepper grepper(device, uuid, bo, bo_map);
+    double sum[3] = {0, 0, 0}, max[3] = {0, 0, 0};
+    CpuStats cpu[3];
+    GrepResult result[3];
+    std::cout << "\nStarting " << num_iter << " searches of " << (size >> 20) << " MiB for '" << pattern << "'"
+              << (grep_has_avx2() ? "" : ", no AVX2 on this CPU") << "\n";
+    for (int i = 0; i < num_iter; i++) {
+        for (int side = 0; side < 3; side++) {
+            Timer timer = Timer();
+            CpuMeter cpu_meter = CpuMeter();
+            perf_counters.start();
+            if (side == 0) result[side] = grepper.search(filepath, program, size);
+            else result[side] = grep_host(filepath, program, side == 1, size);
+            perf_counters.stop(side == 0 ? "grep: fpga" : side == 1 ? "grep: host avx2" : "grep: host scalar");
+            long long duration = timer.stop();
+            cpu[side].add(cpu_meter.stop(), size);
+            double throughput = ((double)size * 1000000 / (1024 * 1024)) / duration;
+            sum[side] += throughput;
+            max[side] = std::max(max[side], throughput);
+        }
+        std::cout << "Iteration " << i << " : " << (global_timer.stop()/1000000) << "s\n";
+    }
+
+    // The kernel may keep fewer offsets than it counts
+    bool verified = result[1].lines == result[2].lines && result[0].matches == result[2].matches &&
+                    std::equal(result[0].lines.begin(), result[0].lines.end(), result[2].lines.begin());
+    std::cout << "\nSearch of " << result[0].matches << " matching lines"
+              << (grep_required_literal(program).empty() ? "" : ", AVX2 prefilter on '" + grep_required_literal(program) + "'")
+              << " achieved :\n";
+    for (int side = 0; side < 3; side++) {
+        std::cout << "	" << names[side] << " :\n"
+                  << "		Max search throughput: " << max[side] << " MiB/s\n"
+                  << "		Average search throughput: " << sum[side] / num_iter << " MiB/s\n"
+                  << "		Bytes to host: " << result[side].bytes_to_host << "\n"
+                  << "		";
+        cpu[side].print(std::cout);
+        std::cout << "\n";
+    }
+    std::cout << "\nMatching lines agree: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Group-by aggregation : for each cardinality, `size` bytes of order records with that many
+ * categories are written to the file, then the count, sum, min and max of the quantity
+ * per category are computed by aggregate_kernel on chunks P2P read into the p2p bo, and
+ * on the host after reading the rows with O_DIRECT.
+ */
+int aggregate_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                        size_t size, const std::vector<size_t>& group_counts, int num_iter) {
+    const size_t chunk = 64 << 20;
+    Schema schema = order_schema();
+    const Column& key = schema.column("category");
+    const Column& value = schema.column("quantity");
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+    uint64_t records = size / sizeof(OrderRecord);
+    char *buf = (char*)aligned_alloc(4096, chunk);
+    bool verified = true;
+
+    for (size_t cardinality : group_counts) {
+        // Write the records through the host, aggregating the reference on the way
+        std::cout << "\nWriting " << (size >> 20) << " MiB of records in " << cardinality << " categories\n";
+        std::unordered_map<int64_t, AggEntry> reference_groups;
+        write_order_file(filepath, size, chunk, [&](char *buf, size_t len, size_t offset) {
+            set_categories(buf, len, cardinality, offset / sizeof(OrderRecord));
+            aggregate_records((const uint8_t*)buf, len, schema, key, value, reference_groups);
+        });
+        int nvmeFd = open(filepath.c_str(), O_RDONLY | O_DIRECT);
+        if (nvmeFd < 0) {
+            std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::vector<AggEntry> reference = sorted_groups(reference_groups);
+
+        Aggregator aggregator(device, uuid, bo, bo_map, cardinality);
+        double sum[2] = {0, 0};
+        size_t to_host[2] = {0, 0};
+        CpuStats cpu[2];
+        bool ok = true;
+        for (int i = 0; i < num_iter; i++) {
+            Timer timer = Timer();
+            CpuMeter cpu_meter = CpuMeter();
+            perf_counters.start();
+            AggResult result = aggregator.aggregate(filepath, schema, "category", "quantity", size);
+            perf_counters.stop("aggregate: fpga");
+            long long duration = timer.stop();
+            cpu[0].add(cpu_meter.stop(), size);
+            sum[0] += (double)records * 1000000 / duration;
+            to_host[0] = result.bytes_to_host;
+            ok &= result.overflow == 0 && result.groups.size() == reference.size() &&
+                  memcmp(result.groups.data(), reference.data(), reference.size() * sizeof(AggEntry)) == 0;
+
+            // Pull the rows to the CPU and aggregate them there
+            timer.reset();
+            cpu_meter.start();
+            perf_counters.start();
+            std::unordered_map<int64_t, AggEntry> host_groups;
+            for (size_t offset = 0; offset < size; offset += chunk) {
+                size_t len = std::min(chunk, size - offset);
+                if (pread(nvmeFd, buf, (len + 4095) / 4096 * 4096, offset) < (ssize_t)len) {
+                    std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+                aggregate_records((const uint8_t*)buf, len, schema, key, value, host_groups);
+            }
+            std::vector<AggEntry> host = sorted_groups(host_groups);
+            perf_counters.stop("aggregate: host");
+            duration = timer.stop();
+            cpu[1].add(cpu_meter.stop(), size);
+            sum[1] += (double)records * 1000000 / duration;
+            to_host[1] = size;
+            ok &= host.size() == reference.size() && memcmp(host.data(), reference.data(), reference.size() * sizeof(AggEntry)) == 0;
+        }
+        (void)close(nvmeFd);
+        verified &= ok;
+
+        std::cout << "		" << reference.size() << " groups, table of " << aggregator.table_slots() << " slots ("
+                  << (aggregator.table_slots() * sizeof(AggEntry) >> 10) << " KiB)" << (ok ? "" : " MISMATCH") << "\n"
+                  << "		FPGA : " << sum[0] / num_iter / 1000000 << " M rows/s, " << to_host[0] << " bytes to host\n"
+                  << "		";
+        cpu[0].print(std::cout);
+        std::cout << "\n		Host : " << sum[1] / num_iter / 1000000 << " M rows/s, " << to_host[1] << " bytes to host\n"
+                  << "		";
+        cpu[1].print(std::cout);
+        std::cout << "\n		Near-storage speedup: " << sum[0] / sum[1] << "x\n";
+    }
+    free(buf);
+
+    std::cout << "\nAggregates match the reference: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+// Order independent checksum of the records, kept by any permutation
+static uint64_t records_checksum(const char *buf, size_t size, size_t record_size) {
+    uint64_t sum = 0;
+    for (size_t pos = 0; pos + record_size <= size; pos += record_size) {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < record_size; i++) h = (h ^ (uint8_t)buf[pos + i]) * 1099511628211ull;
+        sum += h;
+    }
+    return sum;
+}
+
+/**
+ * External merge sort : `size` bytes of order records are written to the file, then sorted
+ * by the `key` column into <path>.sorted. sort_kernel sorts runs of half the p2p bo that are
+ * P2P read and written back to <path>.sorted.runs, or the software model does on the host
+ * with `model`, and the runs are merged on the host. The first iteration also checks the
+ * first run of the kernel against the model, the output is checked once at the end.
+ */
+int sort_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                   size_t size, const std::string& key, bool model, int num_iter) {
+    const size_t chunk = 64 << 20;
+    Schema schema = order_schema();
+    const Column& column = schema.column(key);
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+    std::string output = filepath + ".sorted";
+    char *buf = (char*)aligned_alloc(4096, chunk);
+
+    std::cout << "\nWriting " << (size >> 20) << " MiB of records to sort by " << key << "\n";
+    uint64_t checksum = 0;
+    write_order_file(filepath, size, chunk, [&](char *buf, size_t len, size_t) {
+        checksum += records_checksum(buf, len, sizeof(OrderRecord));
+    });
+
+    ExternalSorter sorter = model ? ExternalSorter(std::min((size_t)256 << 20, bo.size() / 2))
+                                  : ExternalSorter(device, uuid, bo, bo_map);
+    double sum[3] = {0, 0, 0};
+    SortStats stats = SortStats();
+    CpuStats cpu;
+    bool model_match = true;
+    for (int i = 0; i < num_iter; i++) {
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        perf_counters.start();
+        stats = sorter.sort(filepath, output, schema, key, size, !model && i == 0);
+        perf_counters.stop("sort");
+        long long duration = timer.stop();
+        cpu.add(cpu_meter.stop(), size);
+        if (!model && i == 0) model_match = stats.model_match;
+        sum[0] += (double)size / stats.run_us;
+        sum[1] += (double)size / stats.merge_us;
+        sum[2] += (double)size / duration;
+    }
+
+    // Sorted order and the same records as the input
+    int sortedFd = open(output.c_str(), O_RDONLY | O_DIRECT);
+    if (sortedFd < 0) {
+        std::cerr << "ERROR: open " << output << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+    bool ordered = true;
+    uint64_t sorted_checksum = 0, previous = 0;
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t len = std::min(chunk, size - offset);
+        if (pread(sortedFd, buf, (len + 4095) / 4096 * 4096, offset) < (ssize_t)len) {
+            std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        sorted_checksum += records_checksum(buf, len, sizeof(OrderRecord));
+        for (size_t pos = 0; pos < len; pos += sizeof(OrderRecord)) {
+            uint64_t k = sort_key((const uint8_t*)buf + pos + column.offset, column.type);
+            ordered &= offset + pos == 0 || k >= previous;
+            previous = k;
+        }
+    }
+    (void)close(sortedFd);
+    free(buf);
+    bool verified = ordered && sorted_checksum == checksum && model_match;
+
+    std::cout << "		" << stats.records << " records in " << stats.runs << " runs sorted by "
+              << (model ? "the software model" : "sort_kernel") << "\n"
+              << "		Run formation : " << sum[0] / num_iter << " MB/s\n"
+              << "		Merge : " << sum[1] / num_iter << " MB/s\n"
+              << "		Sorted : " << sum[2] / num_iter / 1000 << " GB/s\n"
+              << "		";
+    cpu.print(std::cout);
+    std::cout << "\n";
+    if (!model) std::cout << "		First run of the kernel matches the software model: " << (model_match ? "yes" : "NO") << "\n";
+
+    std::cout << "\nOutput is sorted and matches the input records: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Streaming summaries : `size` bytes of order records are written to the file, then the top
+ * `k` records by `column` and a quantile sketch of it are computed by topk_kernel and
+ * quantile_kernel on chunks P2P read into the p2p bo, and exactly on the host after reading
+ * the rows with O_DIRECT. The host also merges sketches of each chunk to check that they
+ * stay accurate once merged.
+ */
+int sketch_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                     size_t size, const std::string& column, uint32_t k, int num_iter) {
+    const size_t chunk = 64 << 20;
+    const double max_rank_error = 0.01;
+    const double quantiles[] = {0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999};
+    Schema schema = order_schema();
+    const Column& key = schema.column(column);
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+    uint64_t records = size / sizeof(OrderRecord);
+    char *buf = (char*)aligned_alloc(4096, chunk);
+
+    std::cout << "\nWriting " << (size >> 20) << " MiB of records to summarize by " << column << "\n";
+    write_order_file(filepath, size, chunk);
+    int nvmeFd = open(filepath.c_str(), O_RDONLY | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Summarizer summarizer(device, uuid, bo, bo_map, k);
+    SummaryResult result;
+    std::vector<uint64_t> keys(records), sorted;
+    std::vector<TopKEntry> exact_top;
+    std::unique_ptr<KllSketch> merged(new KllSketch), part(new KllSketch);
+    double sum[2] = {0, 0};
+    CpuStats cpu[2];
+    for (int i = 0; i < num_iter; i++) {
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        perf_counters.start();
+        result = summarizer.summarize(filepath, schema, column, size);
+        perf_counters.stop("sketch: fpga");
+        long long duration = timer.stop();
+        cpu[0].add(cpu_meter.stop(), size);
+        sum[0] += (double)size / duration;
+
+        // Exact top K and quantiles from all the keys pulled to the CPU
+        timer.reset();
+        cpu_meter.start();
+        perf_counters.start();
+        kll_init(merged.get(), KLL_SEED);
+        for (size_t offset = 0; offset < size; offset += chunk) {
+            size_t len = std::min(chunk, size - offset);
+            if (pread(nvmeFd, buf, (len + 4095) / 4096 * 4096, offset) < (ssize_t)len) {
+                std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            uint64_t first_row = offset / sizeof(OrderRecord);
+            for (size_t pos = 0; pos < len; pos += sizeof(OrderRecord)) {
+                keys[first_row + pos / sizeof(OrderRecord)] = sort_key((const uint8_t*)buf + pos + key.offset, key.type);
+            }
+            kll_init(part.get(), KLL_SEED + offset);
+            summarize_records((const uint8_t*)buf, len, sizeof(OrderRecord), key, first_row, k, nullptr, part.get());
+            kll_merge(*merged, *part);
+        }
+        sorted = keys;
+        std::sort(sorted.begin(), sorted.end());
+        // Keys above the K-th largest, then the earliest rows equal to it
+        exact_top.clear();
+        size_t top = std::min<uint64_t>(k, records);
+        if (top > 0) {
+            uint64_t threshold = sorted[records - top];
+            size_t above = sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), threshold);
+            size_t ties = top - above;
+            for (uint64_t row = 0; row < records; row++) {
+                if (keys[row] > threshold || (keys[row] == threshold && ties > 0 && ties--)) exact_top.push_back({keys[row], row});
+            }
+            std::sort(exact_top.begin(), exact_top.end(), [](const TopKEntry& a, const TopKEntry& b) { return topk_better(&a, &b); });
+        }
+        perf_counters.stop("sketch: host exact");
+        duration = timer.stop();
+        cpu[1].add(cpu_meter.stop(), size);
+        sum[1] += (double)size / duration;
     }
-    void reset() { mTimeStart = std::chrono::high_resolution_clock::now(); }
-};
+    (void)close(nvmeFd);
+    free(buf);
 
-Timer global_timer;
+    bool top_ok = result.top.size() == exact_top.size() &&
+                  memcmp(result.top.data(), exact_top.data(), exact_top.size() * sizeof(TopKEntry)) == 0;
+    std::cout << "		" << records << " records, top " << k << " by " << column << ", sketch of "
+              << (sizeof(KllSketch) >> 10) << " KiB\n"
+              << "		FPGA : " << sum[0] / num_iter << " MB/s, " << result.bytes_to_host << " bytes to host\n"
+              << "		";
+    cpu[0].print(std::cout);
+    std::cout << "\n		Host exact : " << sum[1] / num_iter << " MB/s, " << size << " bytes to host\n"
+              << "		";
+    cpu[1].print(std::cout);
+    std::cout << "\n		Top " << k << " matches the exact top " << k << ": " << (top_ok ? "yes" : "NO");
+    if (!result.top.empty()) std::cout << ", first " << decode_key(result.top[0].key, key.type) << " at row " << result.top[0].row;
+    std::cout << "\n";
 
-std::pair<double, double> p2p_host_to_ssd(int& nvmeFd, xrt::kernel& krnl, xrt::bo bo, int *bo_map) {
-	Timer timer_from_cpu, timer_from_fpga;
-    int ret = 0;
-    size_t vector_size_bytes = sizeof(int) * DATA_SIZE;
+    double max_error[2] = {0, 0};
+    for (double q : quantiles) {
+        uint64_t estimate = kll_quantile(*result.sketch, q);
+        uint64_t exact = sorted[std::min<uint64_t>(q * records, records - 1)];
+        double rank = (double)(std::lower_bound(sorted.begin(), sorted.end(), estimate) - sorted.begin()) / records;
+        double merged_rank =
+            (double)(std::lower_bound(sorted.begin(), sorted.end(), kll_quantile(*merged, q)) - sorted.begin()) / records;
+        max_error[0] = std::max(max_error[0], std::abs(rank - q));
+        max_error[1] = std::max(max_error[1], std::abs(merged_rank - q));
+        std::cout << "		q" << q << " : " << decode_key(estimate, key.type) << " (exact " << decode_key(exact, key.type)
+                  << ", rank error " << rank - q << ")\n";
+    }
+    std::cout << "		Max rank error : " << max_error[0] << ", merged per-chunk sketches : " << max_error[1] << "\n";
+    bool verified = top_ok && max_error[0] <= max_rank_error && max_error[1] <= max_rank_error;
 
-    //std::cout << "Start cpu timer : " << global_timer.stop() << std::endl;
-    timer_from_cpu = Timer();
+    std::cout << "\nSummaries match the exact computation: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
 
-    //std::cout << "Synchronize input buffer data to device global memory : " << global_timer.stop() << std::endl;
-    bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+// Whether two files have the same contents, read with O_DIRECT
+static bool same_contents(const std::string& a, const std::string& b) {
+    const size_t chunk = 64 << 20;
+    int fds[2] = {open(a.c_str(), O_RDONLY | O_DIRECT), open(b.c_str(), O_RDONLY | O_DIRECT)};
+    char *bufs[2] = {(char*)aligned_alloc(4096, chunk), (char*)aligned_alloc(4096, chunk)};
+    bool same = fds[0] >= 0 && fds[1] >= 0;
+    for (size_t offset = 0; same; offset += chunk) {
+        ssize_t len[2] = {pread(fds[0], bufs[0], chunk, offset), pread(fds[1], bufs[1], chunk, offset)};
+        same = len[0] == len[1] && len[0] >= 0 && memcmp(bufs[0], bufs[1], len[0]) == 0;
+        if (len[0] < (ssize_t)chunk) break;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (fds[i] >= 0) (void)close(fds[i]);
+        free(bufs[i]);
+    }
+    return same;
+}
 
-    //std::cout << "Start fpga timer : " << global_timer.stop() << std::endl;
-    timer_from_fpga = Timer();
+/**
+ * Text parsing : about `size` bytes of order records are written to the file as CSV or JSON
+ * lines, then parsed into a columnar file by parse_kernel between a P2P read and a P2P
+ * write, and on the host (AVX2 when available) between an O_DIRECT read and write. Both
+ * must give the same file.
+ */
+int parse_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                    size_t size, bool json, int num_iter) {
+    const size_t chunk = 64 << 20;
+    std::vector<ColfColumn> columns = {colf_column("id", FILTER_INT64), colf_column("key", FILTER_INT32),
+                                       colf_column("category", FILTER_INT32), colf_column("price", FILTER_FLOAT64),
+                                       colf_column("quantity", FILTER_INT64)};
+    ParseSpec spec = parse_spec(json ? PARSE_JSON : PARSE_CSV, columns);
+    std::string fpga_file = filepath + ".colf";
+    std::string host_file = filepath + ".host.colf";
+    char *buf = (char*)aligned_alloc(4096, chunk);
 
-    //std::cout << "Now start P2P Write from device buffers to SSD : " << global_timer.stop() << std::endl;
-    ret = pwrite(nvmeFd, (void*)bo_map, vector_size_bytes, 0);
-    if (ret == -1) std::cout << "P2P: write() failed, err: " << ret << ", line: " << __LINE__ << std::endl;
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+    // Whole lines, the part of the last 4 KiB that is not written yet moves to the front
+    std::cout << "\nWriting " << (size >> 20) << " MiB of " << (json ? "JSON lines" : "CSV") << " order records\n";
+    uint64_t records = 0;
+    size_t written = 0, pending = 0;
+    while (written + pending < size) {
+        uint64_t rows;
+        pending += fill_order_lines(buf + pending, std::min(chunk, size - written) - pending, json, records, &rows);
+        records += rows;
+        bool last = rows == 0 || written + pending >= size;
+        size_t len = last ? pending : pending / 4096 * 4096;
+        size_t write_len = (len + 4095) / 4096 * 4096;
+        memset(buf + len, 0, write_len - len);
+        if (pwrite(nvmeFd, buf, write_len, written) != (ssize_t)write_len) {
+            std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        written += len;
+        memmove(buf, buf + len, pending - len);
+        pending -= len;
+        if (last) break;
+    }
+    if (ftruncate(nvmeFd, written) != 0) {
+        std::cerr << "ERR: ftruncate failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    (void)close(nvmeFd);
+    free(buf);
 
-    //std::cout << "Stop timers : " << global_timer.stop() << std::endl;
-    long long duration_from_cpu = timer_from_cpu.stop();
-    long long duration_from_fpga = timer_from_fpga.stop();
+    TextParser parser(device, uuid, bo, bo_map);
+    double rows_per_s[2] = {0, 0}, bandwidth[2] = {0, 0};
+    ParseResult results[2];
+    CpuStats cpu[2];
+    for (int i = 0; i < num_iter; i++) {
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        perf_counters.start();
+        results[0] = parser.parse(filepath, spec, fpga_file);
+        perf_counters.stop("parse: fpga");
+        long long duration = timer.stop();
+        cpu[0].add(cpu_meter.stop(), written);
+        rows_per_s[0] += (double)results[0].rows * 1000000 / duration;
+        bandwidth[0] += (double)written / duration;
 
-    //std::cout << "Compute throughputs : " << global_timer.stop() << std::endl;
-    double throughput = vector_size_bytes;
-    throughput *= 1000000;     // convert us to s;
-    throughput /= 1024 * 1024; // convert to MB
+        timer.reset();
+        cpu_meter.start();
+        perf_counters.start();
+        results[1] = parse_host(filepath, spec, host_file, true);
+        perf_counters.stop("parse: host");
+        duration = timer.stop();
+        cpu[1].add(cpu_meter.stop(), written);
+        rows_per_s[1] += (double)results[1].rows * 1000000 / duration;
+        bandwidth[1] += (double)written / duration;
+    }
+    bool verified = same_contents(fpga_file, host_file);
+    for (const ParseResult& result : results) verified &= result.rows == records && result.bad_lines == 0;
 
-    double throughput_from_fpga = throughput / duration_from_fpga;
-    double throughput_from_cpu = throughput / duration_from_cpu;
+    const char *names[2] = {"FPGA", parse_has_avx2() ? "Host AVX2" : "Host scalar"};
+    std::cout << "		" << records << " lines, " << (written >> 20) << " MiB of text\n";
+    for (int s = 0; s < 2; s++) {
+        std::cout << "		" << names[s] << " : " << rows_per_s[s] / num_iter / 1000000 << " M rows/s, "
+                  << bandwidth[s] / num_iter << " MB/s of text, " << results[s].rows << " rows ("
+                  << results[s].bad_lines << " bad lines), " << (results[s].bytes_written >> 20) << " MiB in "
+                  << results[s].groups << " groups written\n"
+                  << "		";
+        cpu[s].print(std::cout);
+        std::cout << "\n";
+    }
+    std::cout << "		Near-storage speedup: " << rows_per_s[0] / rows_per_s[1] << "x\n";
 
-    if (throughput_from_fpga > throughput_from_fpga_max_host_to_ssd) {
-    	throughput_from_fpga_max_host_to_ssd = throughput_from_fpga;
+    std::cout << "\nColumnar files match: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
     }
+    return verified ? 0 : EXIT_FAILURE;
+}
 
-    if (throughput_from_cpu > throughput_from_cpu_max_host_to_ssd) {
-    	throughput_from_cpu_max_host_to_ssd = throughput_from_cpu;
+/**
+ * Row to column transposition on the write path : `size` bytes of order records in a device
+ * bo are synced, transposed by transpose_kernel into row groups of `group_bytes` of records
+ * in the p2p bo and P2P written to <path>.colf. Compared with the plain write of
+ * p2p_host_to_ssd, syncing the rows in the p2p bo and P2P writing them as they are, and
+ * with transposing on the host before an O_DIRECT write (<path>.host.colf).
+ */
+int transpose_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                        size_t size, size_t group_bytes, int num_iter) {
+    Schema schema = order_schema();
+    std::vector<std::string> names;
+    std::vector<ColfColumn> colf_columns;
+    std::vector<uint32_t> offsets;
+    for (const Column& column : schema.columns) {
+        names.push_back(column.name);
+        colf_columns.push_back(colf_column(column.name, column.type));
+        offsets.push_back(column.offset);
+    }
+    std::vector<TransposeColumn> columns = transpose_columns(schema, names);
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+    uint64_t records = size / sizeof(OrderRecord);
+    if (size > bo.size()) {
+        std::cerr << "ERROR: " << size << " bytes of records do not fit in the p2p buffer" << std::endl;
+        return EXIT_FAILURE;
     }
 
-    return std::make_pair(throughput_from_fpga, throughput_from_cpu);
+    Transposer transposer(device, uuid, bo, bo_map, columns, sizeof(OrderRecord));
+    auto krnl = xrt::kernel(device, uuid, "transpose_kernel");
+    auto in_bo = xrt::bo(device, size, krnl.group_id(0));
+    auto in_map = in_bo.map<char*>();
+    fill_records(in_map, size);
+    uint32_t group_rows = std::min<uint64_t>(std::max<uint64_t>(group_bytes / sizeof(OrderRecord), 1), transposer.max_rows());
+
+    std::string colf_file = filepath + ".colf";
+    std::string host_file = filepath + ".host.colf";
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Plain write of the rows, as p2p_host_to_ssd
+    memcpy(bo_map, in_map, size);
+    size_t write_len = (size + 4095) / 4096 * 4096;
+    double sum[3] = {0, 0, 0};
+    long long sum_sync[2] = {0, 0}, sum_write[2] = {0, 0}, sum_kernel = 0;
+    CpuStats cpu[3];
+    for (int i = 0; i < num_iter; i++) {
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        perf_counters.start();
+        bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, write_len, 0);
+        long long t_sync = timer.stop();
+        if (pwrite(nvmeFd, (void*)bo_map, write_len, 0) != (ssize_t)write_len) {
+            std::cerr << "ERR: pwrite failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        perf_counters.stop("transpose: plain write");
+        long long duration = timer.stop();
+        cpu[0].add(cpu_meter.stop(), size);
+        sum[0] += ((double)size * 1000000 / (1024 * 1024)) / duration;
+        sum_sync[0] += t_sync;
+        sum_write[0] += duration - t_sync;
+    }
+    if (ftruncate(nvmeFd, size) != 0) {
+        std::cerr << "ERR: ftruncate failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    (void)close(nvmeFd);
+
+    // Rows synced to the device bo, transposed group by group into the p2p bo and P2P written
+    ColumnarWriter writer(colf_columns);
+    for (int i = 0; i < num_iter; i++) {
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        perf_counters.start();
+        in_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+        long long t_sync = timer.stop();
+        long long t_kernel = 0;
+        int ret = writer.open(colf_file);
+        for (uint64_t row = 0; ret == 0 && row < records; row += group_rows) {
+            uint32_t rows = std::min<uint64_t>(group_rows, records - row);
+            long long before = timer.stop();
+            transposer.transpose(in_bo, row, rows);
+            t_kernel += timer.stop() - before;
+            ret = writer.write_group_data(bo_map, rows);
+        }
+        if (ret == 0) ret = writer.close();
+        if (ret != 0) {
+            std::cerr << "ERR: columnar write failed: " << strerror(-ret) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        perf_counters.stop("transpose: fpga");
+        long long duration = timer.stop();
+        cpu[1].add(cpu_meter.stop(), size);
+        sum[1] += ((double)size * 1000000 / (1024 * 1024)) / duration;
+        sum_sync[1] += t_sync;
+        sum_kernel += t_kernel;
+        sum_write[1] += duration - t_sync - t_kernel;
+    }
+
+    // Host transposition of the same rows before an O_DIRECT write
+    ColumnarWriter host_writer(colf_columns);
+    for (int i = 0; i < num_iter; i++) {
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        perf_counters.start();
+        int ret = host_writer.open(host_file);
+        for (uint64_t row = 0; ret == 0 && row < records; row += group_rows) {
+            uint32_t rows = std::min<uint64_t>(group_rows, records - row);
+            ret = host_writer.write_rows(in_map + row * sizeof(OrderRecord), sizeof(OrderRecord), offsets, rows);
+        }
+        if (ret == 0) ret = host_writer.close();
+        if (ret != 0) {
+            std::cerr << "ERR: columnar write failed: " << strerror(-ret) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        perf_counters.stop("transpose: host");
+        long long duration = timer.stop();
+        cpu[2].add(cpu_meter.stop(), size);
+        sum[2] += ((double)size * 1000000 / (1024 * 1024)) / duration;
+    }
+    bool verified = same_contents(colf_file, host_file);
+
+    std::cout << "\n		" << records << " records, " << colf_columns.size() << " columns, row groups of " << group_rows << " rows\n"
+              << "		Plain P2P write of the rows : " << sum[0] / num_iter << " MiB/s, sync/write "
+              << sum_sync[0] / num_iter / 1000 << "/" << sum_write[0] / num_iter / 1000 << " ms\n"
+              << "		";
+    cpu[0].print(std::cout);
+    std::cout << "\n		Transposed P2P write : " << sum[1] / num_iter << " MiB/s, sync/kernel/write "
+              << sum_sync[1] / num_iter / 1000 << "/" << sum_kernel / num_iter / 1000 << "/"
+              << sum_write[1] / num_iter / 1000 << " ms\n"
+              << "		Transform throughput : " << ((double)size * 1000000 / (1024 * 1024)) / ((double)sum_kernel / num_iter)
+              << " MiB/s, overhead vs plain write : " << (sum[0] / sum[1] - 1) * 100 << "%\n"
+              << "		";
+    cpu[1].print(std::cout);
+    std::cout << "\n		Host transposition and write : " << sum[2] / num_iter << " MiB/s\n"
+              << "		";
+    cpu[2].print(std::cout);
+
+    std::cout << "\n\nColumnar files match: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
 }
 
-std::pair<double, double> p2p_ssd_to_host(int& nvmeFd, xrtDeviceHandle device, xrt::kernel& krnl) {
-	Timer timer_from_cpu, timer_from_fpga;
-    size_t vector_size_bytes = sizeof(int) * DATA_SIZE;
+enum OffloadJob { OFFLOAD_COPY, OFFLOAD_FILTER, OFFLOAD_ZONEMAP, OFFLOAD_CRYPT, OFFLOAD_FINGERPRINT, OFFLOAD_COMPRESS, OFFLOAD_JOBS };
 
-    xrt::bo::flags flags = xrt::bo::flags::p2p;
-    //std::cout << "Allocate Buffer in Global Memory : " << global_timer.stop() << std::endl;
-    auto bo = xrt::bo(device, vector_size_bytes, flags, krnl.group_id(0));
+// Kernels, buffers and parameters of the jobs of the offload mode
+struct OffloadContext {
+    xrt::kernel kernels[OFFLOAD_JOBS];
+    xrt::bo copy_bo, rows_bo, bitmap_bo, count_bo, predicate_bo, zone_bo, keys_bo, cipher_bo, digest_bo, lz4_bo, lz4_index_bo;
+    std::vector<FilterPredicate> predicates;
+    Column zone_column;
+    uint32_t zone_records;
+    uint32_t fingerprint_bs;
+    uint32_t compress_bs;
+    char *host_out; // outputs of the CPU side, a chunk or its compressed blocks
+    std::vector<Lz4bIndexEntry> host_index;
+};
 
-    //std::cout << "Map the contents of the buffer object into host memory : " << global_timer.stop() << std::endl;
-    auto bo_map = bo.map<int*>();
+// Compressed blocks of both sides, the padding between the blocks is left as it is
+static bool same_blocks(const char *a, const Lz4bIndexEntry *a_index, const char *b, const Lz4bIndexEntry *b_index,
+                        uint32_t blocks) {
+    if (memcmp(a_index, b_index, blocks * sizeof(Lz4bIndexEntry)) != 0) return false;
+    for (uint32_t i = 0; i < blocks; i++) {
+        if (memcmp(a + a_index[i].offset, b + b_index[i].offset, a_index[i].size & ~LZ4B_RAW_FLAG) != 0) return false;
+    }
+    return true;
+}
 
-    //std::cout << "Start timers : " << global_timer.stop() << std::endl;
-    timer_from_cpu = Timer();
-    timer_from_fpga = Timer();
+/**
+ * Run `job` on the `len` bytes at `offset` of the file, already in `in` : the p2p bo for the
+ * FPGA side, host memory for the CPU side. Returns the results as they end up in host memory.
+ */
+static std::pair<const char*, size_t> offload_chunk(OffloadContext& ctx, int job, bool fpga, xrt::bo& bo, const char *in,
+                                                    size_t offset, size_t len) {
+    unsigned int records = len / sizeof(OrderRecord);
+    switch (job) {
+    case OFFLOAD_COPY:
+        if (!fpga) {
+            cpu_copy((uint32_t*)ctx.host_out, (const uint32_t*)in, len / sizeof(uint32_t));
+            return {ctx.host_out, len};
+        }
+        ctx.kernels[job](bo, ctx.copy_bo, (unsigned int)(len / sizeof(uint32_t))).wait();
+        ctx.copy_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, len, 0);
+        return {ctx.copy_bo.map<char*>(), len};
+    case OFFLOAD_FILTER: {
+        size_t bytes = (records + 31) / 32 * sizeof(uint32_t);
+        if (!fpga) {
+            cpu_filter((const uint8_t*)in, nullptr, (uint32_t*)ctx.host_out, ctx.predicates.data(), ctx.predicates.size(),
+                       sizeof(OrderRecord), records);
+            return {ctx.host_out, bytes};
+        }
+        ctx.kernels[job](bo, ctx.rows_bo, ctx.bitmap_bo, ctx.count_bo, ctx.predicate_bo, (unsigned int)ctx.predicates.size(),
+                         (unsigned int)sizeof(OrderRecord), records, 0u).wait();
+        ctx.bitmap_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, bytes, 0);
+        ctx.count_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+        return {ctx.bitmap_bo.map<char*>(), bytes};
+    }
+    case OFFLOAD_ZONEMAP: {
+        size_t bytes = (records + ctx.zone_records - 1) / ctx.zone_records * sizeof(ZoneEntry);
+        if (!fpga) {
+            cpu_zonemap((const uint8_t*)in, (ZoneEntry*)ctx.host_out, sizeof(OrderRecord), ctx.zone_column.offset,
+                        ctx.zone_column.type, records, ctx.zone_records);
+            return {ctx.host_out, bytes};
+        }
+        ctx.kernels[job](bo, ctx.zone_bo, (unsigned int)sizeof(OrderRecord), ctx.zone_column.offset,
+                         (unsigned int)ctx.zone_column.type, records, ctx.zone_records).wait();
+        ctx.zone_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, bytes, 0);
+        return {ctx.zone_bo.map<char*>(), bytes};
+    }
+    case OFFLOAD_CRYPT:
+        if (!fpga) {
+            cpu_aes256_ctr((const uint8_t*)in, (uint8_t*)ctx.host_out, ctx.keys_bo.map<uint8_t*>(), offset / AES_BLOCK_SIZE, len);
+            return {ctx.host_out, len};
+        }
+        ctx.kernels[job](bo, ctx.cipher_bo, ctx.keys_bo, (unsigned long long)(offset / AES_BLOCK_SIZE), (unsigned int)len).wait();
+        ctx.cipher_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, len, 0);
+        return {ctx.cipher_bo.map<char*>(), len};
+    case OFFLOAD_COMPRESS: {
+        uint32_t blocks = (len + ctx.compress_bs - 1) / ctx.compress_bs;
+        size_t index_bytes = blocks * sizeof(Lz4bIndexEntry);
+        if (!fpga) {
+            size_t data_size = lz4b_compress((const uint8_t*)in, len, ctx.compress_bs, (uint8_t*)ctx.host_out, ctx.host_index.data());
+            return {ctx.host_out, data_size + index_bytes};
+        }
+        ctx.kernels[job](bo, ctx.lz4_bo, ctx.lz4_index_bo, (unsigned int)len, ctx.compress_bs).wait();
+        // The index first, it gives the end of the data region
+        ctx.lz4_index_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, index_bytes, 0);
+        const Lz4bIndexEntry& last = ctx.lz4_index_bo.map<Lz4bIndexEntry*>()[blocks - 1];
+        size_t data_size = last.offset + lz4b_align(last.size & ~LZ4B_RAW_FLAG);
+        ctx.lz4_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, data_size, 0);
+        return {ctx.lz4_bo.map<char*>(), data_size + index_bytes};
+    }
+    default: {
+        size_t bytes = (len + ctx.fingerprint_bs - 1) / ctx.fingerprint_bs * SHA256_DIGEST_SIZE;
+        if (!fpga) {
+            cpu_sha256_blocks((const uint8_t*)in, (uint8_t*)ctx.host_out, len, ctx.fingerprint_bs);
+            return {ctx.host_out, bytes};
+        }
+        ctx.kernels[job](bo, ctx.digest_bo, (unsigned int)len, ctx.fingerprint_bs).wait();
+        ctx.digest_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, bytes, 0);
+        return {ctx.digest_bo.map<char*>(), bytes};
+    }
+    }
+}
 
-    //std::cout << "Now start P2P Read from SSD to device buffers : " << global_timer.stop() << std::endl;
-    if (pread(nvmeFd, (void*)bo_map, vector_size_bytes, 0) <= 0) {
-        std::cerr << "ERR: pread failed: "
-                  << " error: " << strerror(errno) << std::endl;
+/**
+ * CPU baseline of the offloads : the same jobs over `size` bytes of order records run on the
+ * host, O_DIRECT reads into host memory then the SIMD kernels of simd.h, and next to the
+ * drive, P2P reads into the p2p bo then the FPGA kernels. Each side ends with the results in
+ * host memory : the copy and the ciphertext whole, the filter bitmap, the zone entries, the
+ * block digests and the LZ4 blocks of `compress_bs` with their index. The grep and parse
+ * modes already compare both sides on text.
+ */
+int offload_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                      size_t size, size_t fingerprint_bs, size_t compress_bs, int num_iter) {
+    static const char *names[OFFLOAD_JOBS] = {"copy", "filter", "zonemap", "aes-256-ctr", "sha-256", "lz4"};
+    static const char *kernel_names[OFFLOAD_JOBS] = {"dummy_kernel", "filter_kernel", "zonemap_kernel", "aes256_ctr_kernel",
+                                                     "sha256_blocks_kernel", "lz4_compress_kernel"};
+    const size_t chunk = std::min((size_t)64 << 20, bo.size()) / 4096 * 4096;
+    Schema schema = order_schema();
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+    char *buf = (char*)aligned_alloc(4096, chunk);
+
+    std::cout << "\nWriting " << (size >> 20) << " MiB of records\n";
+    write_order_file(filepath, size, chunk);
+    int nvmeFd = open(filepath.c_str(), O_RDONLY | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    OffloadContext ctx;
+    for (int job = 0; job < OFFLOAD_JOBS; job++) ctx.kernels[job] = xrt::kernel(device, uuid, kernel_names[job]);
+    size_t chunk_records = chunk / sizeof(OrderRecord);
+    ctx.copy_bo = xrt::bo(device, chunk, ctx.kernels[OFFLOAD_COPY].group_id(1));
+    ctx.rows_bo = xrt::bo(device, 4096, ctx.kernels[OFFLOAD_FILTER].group_id(1));
+    ctx.bitmap_bo = xrt::bo(device, (chunk_records + 31) / 32 * sizeof(uint32_t), ctx.kernels[OFFLOAD_FILTER].group_id(2));
+    ctx.count_bo = xrt::bo(device, sizeof(uint32_t), ctx.kernels[OFFLOAD_FILTER].group_id(3));
+    ctx.predicate_bo = xrt::bo(device, FILTER_MAX_PREDICATES * sizeof(FilterPredicate), ctx.kernels[OFFLOAD_FILTER].group_id(4));
+    ctx.predicates = encode_predicate(schema, Predicate().where("key", FILTER_LT, 0.1 * ORDER_KEY_RANGE).where("price", FILTER_GE, 100));
+    memcpy(ctx.predicate_bo.map<FilterPredicate*>(), ctx.predicates.data(), ctx.predicates.size() * sizeof(FilterPredicate));
+    ctx.predicate_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    ctx.zone_column = schema.column("price");
+    ctx.zone_records = 4096;
+    ctx.zone_bo = xrt::bo(device, (chunk_records + ctx.zone_records - 1) / ctx.zone_records * sizeof(ZoneEntry),
+                          ctx.kernels[OFFLOAD_ZONEMAP].group_id(1));
+    ctx.keys_bo = xrt::bo(device, AES256_KERNEL_KEYS_SIZE, ctx.kernels[OFFLOAD_CRYPT].group_id(2));
+    std::random_device entropy;
+    uint8_t key[AES256_KEY_SIZE];
+    for (auto& b : key) b = entropy();
+    uint8_t *keys = ctx.keys_bo.map<uint8_t*>();
+    aes256_expand_key(key, keys);
+    for (int i = 0; i < AES_BLOCK_SIZE; i++) keys[AES256_ROUND_KEYS_SIZE + i] = entropy();
+    ctx.keys_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    ctx.cipher_bo = xrt::bo(device, chunk, ctx.kernels[OFFLOAD_CRYPT].group_id(1));
+    ctx.fingerprint_bs = fingerprint_bs;
+    ctx.digest_bo = xrt::bo(device, (chunk + fingerprint_bs - 1) / fingerprint_bs * SHA256_DIGEST_SIZE,
+                            ctx.kernels[OFFLOAD_FINGERPRINT].group_id(1));
+    ctx.compress_bs = compress_bs;
+    size_t compress_bound = lz4b_data_bound(chunk, compress_bs);
+    size_t compress_blocks = (chunk + compress_bs - 1) / compress_bs;
+    ctx.lz4_bo = xrt::bo(device, compress_bound, ctx.kernels[OFFLOAD_COMPRESS].group_id(1));
+    ctx.lz4_index_bo = xrt::bo(device, compress_blocks * sizeof(Lz4bIndexEntry), ctx.kernels[OFFLOAD_COMPRESS].group_id(2));
+    ctx.host_index.resize(compress_blocks);
+    ctx.host_out = (char*)aligned_alloc(4096, std::max(chunk, compress_bound));
+
+    std::cout << "\nHost equivalents of the kernels at " << simd_name(simd_level()) << " (detected "
+              << simd_name(simd_detect()) << ") :\n";
+    for (const CpuKernel& k : cpu_kernels()) {
+        std::cout << "		" << std::left << std::setw(22) << k.kernel << std::setw(36) << k.function << k.variant << "\n";
+    }
+    std::cout << std::right;
+
+    // Same results chunk by chunk, outside of the measures
+    bool verified = true;
+    bool match[OFFLOAD_JOBS];
+    for (int job = 0; job < OFFLOAD_JOBS; job++) {
+        match[job] = true;
+        for (size_t offset = 0; offset < size && match[job]; offset += chunk) {
+            size_t len = std::min(chunk, size - offset);
+            size_t read_len = (len + 4095) / 4096 * 4096;
+            if (pread(nvmeFd, buf, read_len, offset) < (ssize_t)len || pread(nvmeFd, (void*)bo_map, read_len, offset) < (ssize_t)len) {
+                std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            std::pair<const char*, size_t> cpu_out = offload_chunk(ctx, job, false, bo, buf, offset, len);
+            std::pair<const char*, size_t> fpga_out = offload_chunk(ctx, job, true, bo, (const char*)bo_map, offset, len);
+            if (job == OFFLOAD_COMPRESS) {
+                match[job] = cpu_out.second == fpga_out.second &&
+                             same_blocks(cpu_out.first, ctx.host_index.data(), fpga_out.first,
+                                         ctx.lz4_index_bo.map<Lz4bIndexEntry*>(), (len + compress_bs - 1) / compress_bs);
+            } else {
+                match[job] = cpu_out.second == fpga_out.second && memcmp(cpu_out.first, fpga_out.first, cpu_out.second) == 0;
+            }
+        }
+        verified &= match[job];
+    }
+
+    // [job][cpu, fpga]
+    double sum[OFFLOAD_JOBS][2] = {}, kernel_sum[OFFLOAD_JOBS][2] = {};
+    uint64_t to_host[OFFLOAD_JOBS] = {};
+    CpuStats cpu[OFFLOAD_JOBS][2];
+    std::cout << "\nStarting " << num_iter << " iterations of " << OFFLOAD_JOBS << " jobs over " << (size >> 20)
+              << " MiB, CPU then FPGA\n";
+    for (int i = 0; i < num_iter; i++) {
+        for (int job = 0; job < OFFLOAD_JOBS; job++) {
+            for (int side = 0; side < 2; side++) {
+                bool fpga = side == 1;
+                char *in = fpga ? (char*)bo_map : buf;
+                long long kernel_us = 0;
+                to_host[job] = 0;
+                Timer timer = Timer();
+                CpuMeter cpu_meter = CpuMeter();
+                for (size_t offset = 0; offset < size; offset += chunk) {
+                    size_t len = std::min(chunk, size - offset);
+                    size_t read_len = (len + 4095) / 4096 * 4096;
+                    perf_counters.start();
+                    if (pread(nvmeFd, in, read_len, offset) < (ssize_t)len) {
+                        std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+                        exit(EXIT_FAILURE);
+                    }
+                    perf_counters.stop(fpga ? "offload: p2p pread" : "offload: pread");
+                    Timer kernel_timer = Timer();
+                    perf_counters.start();
+                    to_host[job] += offload_chunk(ctx, job, fpga, bo, in, offset, len).second;
+                    perf_counters.stop(fpga ? "offload: fpga kernel" : "offload: cpu kernel");
+                    kernel_us += kernel_timer.stop();
+                }
+                long long duration = timer.stop();
+                cpu[job][side].add(cpu_meter.stop(), size);
+                sum[job][side] += ((double)size * 1000000 / (1024 * 1024)) / duration;
+                kernel_sum[job][side] += ((double)size * 1000000 / (1024 * 1024)) / std::max(kernel_us, 1ll);
+            }
+        }
+        std::cout << "Iteration " << i << " : " << (global_timer.stop()/1000000) << "s\n";
+    }
+    (void)close(nvmeFd);
+    free(buf);
+    free(ctx.host_out);
+
+    const char *sides[2] = {"CPU", "FPGA"};
+    std::cout << "\nOffload comparison over " << (size >> 20) << " MiB in " << (chunk >> 20) << " MiB chunks :\n";
+    for (int job = 0; job < OFFLOAD_JOBS; job++) {
+        std::cout << "	" << names[job] << " (" << kernel_names[job] << ", " << to_host[job] << " bytes of results to host)"
+                  << (match[job] ? "" : " MISMATCH") << " :\n";
+        for (int side = 0; side < 2; side++) {
+            std::cout << "		" << sides[side] << " : average " << sum[job][side] / num_iter << " MiB/s, kernel and results "
+                      << kernel_sum[job][side] / num_iter << " MiB/s\n		";
+            cpu[job][side].print(std::cout);
+            std::cout << "\n";
+        }
+        std::cout << "		FPGA/CPU throughput: " << sum[job][1] / sum[job][0] << "x, host CPU cost "
+                  << cpu[job][1].cpu_seconds_per_gib() << " vs " << cpu[job][0].cpu_seconds_per_gib() << " cpu-s/GiB\n";
+    }
+    std::cout << "\nCPU and FPGA results match: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Bandwidths of the cost model measured on the first `size` bytes of the file, with the same
+ * chunks, kernel and bitmap syncs as the scans. The kernels run on the data just read.
+ */
+Calibration calibrate_scan(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                           size_t size, const Schema& schema, const Predicate& predicate) {
+    const size_t chunk = std::min((size_t)64 << 20, bo.size()) / 4096 * 4096;
+    auto krnl = xrt::kernel(device, uuid, "filter_kernel");
+    size_t chunk_records = chunk / schema.record_size;
+    auto rows_bo = xrt::bo(device, 4096, krnl.group_id(1));
+    auto bitmap_bo = xrt::bo(device, (chunk_records + 31) / 32 * sizeof(uint32_t), krnl.group_id(2));
+    auto count_bo = xrt::bo(device, sizeof(uint32_t), krnl.group_id(3));
+    auto predicate_bo = xrt::bo(device, FILTER_MAX_PREDICATES * sizeof(FilterPredicate), krnl.group_id(4));
+    std::vector<FilterPredicate> predicates = encode_predicate(schema, predicate);
+    memcpy(predicate_bo.map<FilterPredicate*>(), predicates.data(), predicates.size() * sizeof(FilterPredicate));
+    predicate_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+    std::vector<uint32_t> bitmap((chunk_records + 31) / 32);
+    char *buf = (char*)aligned_alloc(4096, chunk);
+
+    int nvmeFd = open(filepath.c_str(), O_RDONLY | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
         exit(EXIT_FAILURE);
     }
+    // [ssd read, p2p read, sync, fpga kernel, cpu kernel]
+    long long us[5] = {0, 0, 0, 0, 0};
+    size_t synced = 0;
+    for (size_t offset = 0; offset < size; offset += chunk) {
+        size_t len = std::min(chunk, size - offset);
+        size_t read_len = (len + 4095) / 4096 * 4096;
+        unsigned int records = len / schema.record_size;
+        size_t bytes = (records + 31) / 32 * sizeof(uint32_t);
 
-    //std::cout << "Stop timer : " << global_timer.stop() << std::endl;
-    long long duration_from_fpga = timer_from_fpga.stop();
+        Timer timer = Timer();
+        if (pread(nvmeFd, buf, read_len, offset) < (ssize_t)len) {
+            std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        us[0] += timer.stop();
+        timer.reset();
+        cpu_filter((const uint8_t*)buf, nullptr, bitmap.data(), predicates.data(), predicates.size(), schema.record_size, records);
+        us[4] += timer.stop();
 
-    double throughput = vector_size_bytes;
-    throughput *= 1000000;     // convert us to s;
-    throughput /= 1024 * 1024; // convert to MB
+        timer.reset();
+        if (pread(nvmeFd, (void*)bo_map, read_len, offset) < (ssize_t)len) {
+            std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        us[1] += timer.stop();
+        timer.reset();
+        auto run = krnl(bo, rows_bo, bitmap_bo, count_bo, predicate_bo, (unsigned int)predicates.size(),
+                        (unsigned int)schema.record_size, records, 0u);
+        run.wait();
+        us[3] += timer.stop();
+        timer.reset();
+        bitmap_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, bytes, 0);
+        count_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+        us[2] += timer.stop();
+        synced += bytes + sizeof(uint32_t);
+    }
+    (void)close(nvmeFd);
+    free(buf);
 
-    double throughput_from_fpga = throughput / duration_from_fpga;
+    double mib = (double)size / (1024 * 1024);
+    Calibration calibration;
+    calibration.ssd_read = mib * 1000000 / std::max(us[0], 1ll);
+    calibration.p2p_read = mib * 1000000 / std::max(us[1], 1ll);
+    calibration.sync = (double)synced / (1024 * 1024) * 1000000 / std::max(us[2], 1ll);
+    calibration.fpga_kernel = mib * 1000000 / std::max(us[3], 1ll);
+    calibration.cpu_kernel = mib * 1000000 / std::max(us[4], 1ll);
+    calibration.result_ratio = (double)synced / size;
+    return calibration;
+}
 
-    if (throughput_from_fpga > throughput_from_fpga_max_ssd_to_host) {
-    	throughput_from_fpga_max_ssd_to_host = throughput_from_fpga;
+/**
+ * Planned filter scans : `size` bytes of order records are written to the file, then for
+ * predicates of 1 to 8 terms the harness calibrates the cost model on the first GiB, the
+ * planner picks the CPU, the FPGA or a split, and the three are run to compare each
+ * prediction with the throughput achieved.
+ */
+int plan_benchmark(const std::string& filepath, xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map,
+                   size_t size, int num_iter) {
+    static const Comparison terms[] = {{"key", FILTER_LT, 0.5 * ORDER_KEY_RANGE}, {"price", FILTER_GE, 100},
+                                       {"category", FILTER_LT, 90}, {"quantity", FILTER_GT, 5},
+                                       {"id", FILTER_GE, 0}, {"key", FILTER_GE, 0},
+                                       {"price", FILTER_LT, 999}, {"quantity", FILTER_LE, 100}};
+    static const int term_counts[] = {1, 2, 4, 8};
+    const size_t chunk = 64 << 20;
+    Schema schema = order_schema();
+    size = size / sizeof(OrderRecord) * sizeof(OrderRecord);
+    size_t calibration_size = std::min(size, (size_t)1 << 30);
+
+    std::cout << "\nWriting " << (size >> 20) << " MiB of records\n";
+    write_order_file(filepath, size, chunk);
+
+    Scanner scanner(device, uuid, bo, bo_map);
+    bool verified = true;
+    double error_sum = 0;
+    int chosen_best = 0;
+    std::cout << "\nStarting " << num_iter << " scans of " << (size >> 20) << " MiB per predicate and path, CPU kernels at "
+              << simd_name(simd_level()) << "\n";
+    for (int count : term_counts) {
+        Predicate predicate;
+        for (int t = 0; t < count; t++) predicate.terms.push_back(terms[t]);
+        Calibration calibration = calibrate_scan(filepath, device, uuid, bo, bo_map, calibration_size, schema, predicate);
+        Plan plan = plan_scan(calibration);
+
+        std::cout << "\nPredicate of " << count << " terms, calibrated on " << (calibration_size >> 20) << " MiB :\n"
+                  << "		Reads: " << calibration.ssd_read << " MiB/s to host, " << calibration.p2p_read << " MiB/s P2P\n"
+                  << "		Kernels: " << calibration.fpga_kernel << " MiB/s filter_kernel, " << calibration.cpu_kernel
+                  << " MiB/s cpu_filter\n"
+                  << "		Results: " << calibration.result_ratio * 100 << "% of the bytes synced at " << calibration.sync
+                  << " MiB/s\n";
+
+        // Every path with the share of the model, the planner's choice among them
+        double achieved[3] = {0, 0, 0};
+        uint64_t matches[3] = {0, 0, 0};
+        std::vector<uint32_t> bitmaps[3];
+        for (int kind = PLAN_CPU; kind <= PLAN_SPLIT; kind++) {
+            Plan path = plan;
+            path.kind = (PlanKind)kind;
+            path.fpga_share = kind == PLAN_CPU ? 0 : kind == PLAN_FPGA ? 1 : plan.fpga / (plan.cpu + plan.fpga);
+            path.predicted = kind == PLAN_CPU ? plan.cpu : kind == PLAN_FPGA ? plan.fpga : plan.split;
+            double sum = 0;
+            CpuStats cpu;
+            ScanResult result = ScanResult();
+            for (int i = 0; i < num_iter; i++) {
+                Timer timer = Timer();
+                CpuMeter cpu_meter = CpuMeter();
+                perf_counters.start();
+                result = planned_scan(scanner, path, filepath, schema, predicate, size);
+                perf_counters.stop(kind == PLAN_CPU ? "plan: cpu" : kind == PLAN_FPGA ? "plan: fpga" : "plan: split");
+                long long duration = timer.stop();
+                cpu.add(cpu_meter.stop(), size);
+                sum += ((double)size * 1000000 / (1024 * 1024)) / duration;
+            }
+            achieved[kind] = sum / num_iter;
+            matches[kind] = result.matches;
+            bitmaps[kind] = result.bitmap;
+            std::cout << "		" << plan_name((PlanKind)kind);
+            if (kind == PLAN_SPLIT) std::cout << " " << path.fpga_share * 100 << "% on the FPGA";
+            std::cout << " : predicted " << path.predicted << " MiB/s, achieved " << achieved[kind] << " MiB/s ("
+                      << (achieved[kind] / path.predicted - 1) * 100 << "%)" << (kind == plan.kind ? " <- plan" : "")
+                      << "\n		";
+            cpu.print(std::cout);
+            std::cout << "\n";
+        }
+
+        bool ok = matches[0] == matches[1] && matches[0] == matches[2] && bitmaps[0] == bitmaps[1] && bitmaps[0] == bitmaps[2];
+        verified &= ok;
+        int best = std::max_element(achieved, achieved + 3) - achieved;
+        chosen_best += best == plan.kind || achieved[plan.kind] >= 0.95 * achieved[best];
+        error_sum += std::abs(achieved[plan.kind] / plan.predicted - 1);
+        std::cout << "		Plan " << plan_name(plan.kind) << ", fastest " << plan_name((PlanKind)best) << ", "
+                  << matches[0] << " matches" << (ok ? "" : " MISMATCH") << "\n";
     }
 
-    // Get the output data from the device
-    bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE);
+    int jobs = sizeof(term_counts) / sizeof(term_counts[0]);
+    std::cout << "\nPlanner within 5% of the fastest path: " << chosen_best << " of " << jobs << " predicates, mean prediction error "
+              << error_sum / jobs * 100 << "%\n"
+              << "Bitmaps of the three paths match: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
 
-    long long duration_from_cpu = timer_from_cpu.stop();
-    double throughput_from_cpu = throughput / duration_from_cpu;
+static void print_latencies(const char *name, std::vector<double>& us, double throughput) {
+    std::sort(us.begin(), us.end());
+    std::cout << "		" << name << " : p50 " << percentile(us, 0.5) << " us, p99 " << percentile(us, 0.99)
+              << " us, max " << (us.empty() ? 0 : us.back()) << " us, " << throughput << " MiB/s\n";
+}
 
-    if (throughput_from_cpu > throughput_from_cpu_max_ssd_to_host) {
-    	throughput_from_cpu_max_ssd_to_host = throughput_from_cpu;
+/**
+ * Per-chunk launches vs the persistent ring_kernel : for each block size, `num_chunks` copies
+ * of one block each, cycling over the first bytes of the p2p bo. Launches run dummy_kernel on
+ * sub-buffers made beforehand and wait for each run. The ring publishes one command at a
+ * time and waits for it (latency), then keeps the ring full (throughput). The emulated ring
+ * gives the cost of the protocol alone on the host.
+ */
+int ring_benchmark(xrt::device& device, const xrt::uuid& uuid, xrt::bo bo, int *bo_map, const std::vector<size_t>& block_sizes,
+                   int num_chunks) {
+    const size_t window = std::min((size_t)256 << 20, bo.size());
+    const size_t max_buffers = 1024;
+    auto krnl = xrt::kernel(device, uuid, "dummy_kernel");
+    auto out_bo = xrt::bo(device, window, krnl.group_id(1));
+    char *out_map = out_bo.map<char*>();
+    for (size_t i = 0; i < window / sizeof(int); i++) bo_map[i] = i * 2654435761u;
+    bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, window, 0);
+    char *host_out = (char*)aligned_alloc(4096, window);
+
+    bool verified = true;
+    std::cout << "\nStarting " << num_chunks << " chunks per block size and path\n";
+    for (size_t block : block_sizes) {
+        block = (std::min(block, window) + 3) / 4 * 4;
+        size_t buffers = std::min(window / block, max_buffers);
+        std::vector<xrt::bo> in_subs, out_subs;
+        for (size_t b = 0; b < buffers; b++) {
+            in_subs.push_back(xrt::bo(bo, block, b * block));
+            out_subs.push_back(xrt::bo(out_bo, block, b * block));
+        }
+        size_t bytes = (size_t)num_chunks * block;
+        // Chunk c copies block c % buffers, fewer chunks than buffers leave the last blocks untouched
+        size_t copied = std::min((size_t)num_chunks, buffers) * block;
+        double mib = (double)bytes / (1024 * 1024);
+
+        std::vector<double> launch_us, ring_us, emulated_us;
+        Timer timer = Timer();
+        CpuMeter cpu_meter = CpuMeter();
+        perf_counters.start();
+        for (int c = 0; c < num_chunks; c++) {
+            Timer chunk_timer = Timer();
+            auto run = krnl(in_subs[c % buffers], out_subs[c % buffers], (unsigned int)(block / sizeof(int)));
+            run.wait();
+            launch_us.push_back(chunk_timer.elapsed_us());
+        }
+        perf_counters.stop("ring: launches");
+        double launch_throughput = mib * 1000000 / std::max(timer.stop(), 1ll);
+        CpuStats launch_cpu;
+        launch_cpu.add(cpu_meter.stop(), bytes);
+
+        // The ring starts once, outside of the measures, and its output is checked
+        memset(out_map, 0, copied);
+        if (copied > 0) out_bo.sync(XCL_BO_SYNC_BO_TO_DEVICE, copied, 0);
+        timer.reset();
+        CommandRing ring(device, uuid, bo, out_bo);
+        long long start_us = timer.stop();
+        timer.reset();
+        cpu_meter.start();
+        perf_counters.start();
+        for (int c = 0; c < num_chunks; c++) {
+            Timer chunk_timer = Timer();
+            ring.wait(ring.submit(RING_COPY, (c % buffers) * block, block));
+            ring_us.push_back(chunk_timer.elapsed_us());
+        }
+        perf_counters.stop("ring: latency");
+        double ring_throughput = mib * 1000000 / std::max(timer.stop(), 1ll);
+        CpuStats ring_cpu;
+        ring_cpu.add(cpu_meter.stop(), bytes);
+
+        timer.reset();
+        cpu_meter.start();
+        perf_counters.start();
+        uint32_t last = 0;
+        for (int c = 0; c < num_chunks; c++) last = ring.submit(RING_COPY, (c % buffers) * block, block);
+        ring.wait(last);
+        perf_counters.stop("ring: streaming");
+        double streaming_throughput = mib * 1000000 / std::max(timer.stop(), 1ll);
+        CpuStats streaming_cpu;
+        streaming_cpu.add(cpu_meter.stop(), bytes);
+        uint64_t polls = ring.polls();
+        ring.stop();
+        if (copied > 0) out_bo.sync(XCL_BO_SYNC_BO_FROM_DEVICE, copied, 0);
+        bool ok = memcmp(out_map, bo_map, copied) == 0;
+
+        // Same protocol between host buffers
+        memset(host_out, 0, copied);
+        CommandRing emulated((const char*)bo_map, host_out);
+        timer.reset();
+        for (int c = 0; c < num_chunks; c++) {
+            Timer chunk_timer = Timer();
+            emulated.wait(emulated.submit(RING_COPY, (c % buffers) * block, block));
+            emulated_us.push_back(chunk_timer.elapsed_us());
+        }
+        double emulated_throughput = mib * 1000000 / std::max(timer.stop(), 1ll);
+        emulated.stop();
+        ok &= memcmp(host_out, bo_map, copied) == 0;
+        verified &= ok;
+
+        std::cout << "\n	Blocks of " << block << " bytes, per chunk latency" << (ok ? "" : " MISMATCH") << " :\n";
+        print_latencies("Kernel launch per chunk", launch_us, launch_throughput);
+        std::cout << "		";
+        launch_cpu.print(std::cout);
+        std::cout << "\n";
+        print_latencies("Persistent kernel ring", ring_us, ring_throughput);
+        std::cout << "		";
+        ring_cpu.print(std::cout);
+        std::cout << "\n		Persistent kernel ring, " << RING_SLOTS << " in flight : " << streaming_throughput << " MiB/s, "
+                  << polls << " tail polls, started in " << start_us << " us\n		";
+        streaming_cpu.print(std::cout);
+        std::cout << "\n";
+        print_latencies("Emulated ring", emulated_us, emulated_throughput);
+        std::cout << "		Launch overhead removed: " << percentile(launch_us, 0.5) - percentile(ring_us, 0.5) << " us per chunk (p50)\n";
     }
+    free(host_out);
 
-    return std::make_pair(throughput_from_fpga, throughput_from_cpu);
+    std::cout << "\nRing copies match the input: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * Host to SSD writes of the buffer staged through 1 to 4 buffers of `chunk` bytes of the
+ * p2p bo. Each chunk is copied from a host source, stamped with its index, synced then P2P
+ * written at its offset of the file. One buffer runs the steps one after the other like
+ * p2p_host_to_ssd, more let the fill, the sync and the write of different chunks overlap.
+ */
+int staging_benchmark(const std::string& filepath, xrt::bo bo, int *bo_map, size_t size, size_t chunk, int num_iter) {
+    const int max_buffers = 4;
+    chunk = std::max(chunk / 4096, (size_t)1) * 4096;
+    if (chunk * max_buffers > size) {
+        std::cerr << "ERROR: " << max_buffers << " staging buffers of " << chunk << " bytes do not fit in the bo" << std::endl;
+        return EXIT_FAILURE;
+    }
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_DIRECT);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << " failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    char *source = (char*)aligned_alloc(4096, chunk);
+    std::mt19937_64 rng(49);
+    for (size_t i = 0; i < chunk / sizeof(uint64_t); i++) ((uint64_t*)source)[i] = rng();
+    auto fill = [source](size_t c, char *dst, size_t len) {
+        memcpy(dst, source, len);
+        memcpy(dst, &c, std::min(len, sizeof(c)));
+    };
+
+    bool verified = true;
+    double serial = 0;
+    char *check = (char*)aligned_alloc(4096, chunk);
+    std::cout << "\nStarting " << num_iter << " iterations of staged writes of " << size << " bytes in chunks of "
+              << chunk << " bytes\n";
+    for (int buffers = 1; buffers <= max_buffers; buffers++) {
+        StagingPipeline pipeline(bo, (char*)bo_map, chunk, buffers);
+        StagingResult total = StagingResult();
+        double sum = 0, max = 0;
+        CpuStats cpu;
+        for (int i = 0; i < num_iter; i++) {
+            CpuMeter cpu_meter = CpuMeter();
+            perf_counters.start();
+            StagingResult result = pipeline.write(nvmeFd, 0, size, fill);
+            perf_counters.stop("staging: " + std::to_string(buffers) + " buffers");
+            cpu.add(cpu_meter.stop(), size);
+            if (result.error != 0) {
+                std::cerr << "ERR: pwrite failed: " << strerror(result.error) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            double throughput = (double)size / (1024 * 1024) / result.wall;
+            sum += throughput;
+            max = std::max(max, throughput);
+            total.wall += result.wall;
+            total.busy.fill += result.busy.fill;
+            total.busy.sync += result.busy.sync;
+            total.busy.write += result.busy.write;
+        }
+
+        // Every chunk of the file holds the source stamped with its index
+        bool ok = true;
+        for (size_t c = 0; ok && c * chunk < size; c++) {
+            size_t len = std::min(chunk, size - c * chunk);
+            size_t read_len = (len + 4095) / 4096 * 4096;
+            if (pread(nvmeFd, check, read_len, c * chunk) < (ssize_t)len) {
+                std::cerr << "ERR: pread failed: " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            ok = memcmp(check, &c, sizeof(c)) == 0 && memcmp(check + sizeof(c), source + sizeof(c), len - sizeof(c)) == 0;
+        }
+        verified &= ok;
+
+        double average = sum / num_iter;
+        if (buffers == 1) serial = average;
+        std::cout << "\n	" << buffers << (buffers == 1 ? " buffer, serial" : " buffers") << (ok ? "" : " MISMATCH") << " :\n"
+                  << "		Max throughput from cpu: " << max << " MiB/s\n"
+                  << "		Average throughput from cpu: " << average << " MiB/s";
+        if (buffers > 1) std::cout << ", x" << average / serial << " vs serial";
+        std::cout << "\n		Busy per iteration: fill " << total.busy.fill / num_iter << " s, sync " << total.busy.sync / num_iter
+                  << " s, write " << total.busy.write / num_iter << " s, wall " << total.wall / num_iter << " s\n"
+                  << "		Overlap: " << total.concurrency() << " steps running on average, " << total.overlap() * 100
+                  << "% of the steps other than the slowest hidden\n		";
+        cpu.print(std::cout);
+        std::cout << "\n";
+    }
+    free(check);
+    free(source);
+    (void)close(nvmeFd);
+
+    std::cout << "\nStaged writes match the source: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+static void print_stream(const char *name, StreamResult& result, const CpuStats& cpu) {
+    std::sort(result.per_second.begin(), result.per_second.end());
+    std::cout << "		" << name << " : " << result.throughput() << " MiB/s over " << result.bytes / (1 << 30) << " GiB in "
+              << result.seconds << " s, per second min " << percentile(result.per_second, 0) << " p1 "
+              << percentile(result.per_second, 0.01) << " p50 " << percentile(result.per_second, 0.5) << " MiB/s\n		";
+    cpu.print(std::cout);
+    std::cout << "\n";
+}
+
+/**
+ * Streaming of `size` bytes of the file, larger than the device memory, through a window of
+ * `window` bytes at the start of the p2p bo cut in `slots` regions reused in turn. Each
+ * iteration is a write pass of the whole file followed by a read pass checking the stamp of
+ * every chunk. Progress is printed every 30 s, the report gives the sustained throughput
+ * of each pass and its slowest seconds. A pass over hundreds of GB takes minutes, main runs
+ * one iteration unless -i is given.
+ */
+int stream_benchmark(const std::string& filepath, xrt::bo bo, int *bo_map, size_t size, size_t window, int slots, int num_iter) {
+    if (window > bo.size()) {
+        std::cerr << "ERROR: the window of " << window << " bytes is larger than the bo" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (slots < 1 || window / slots < 4096) {
+        std::cerr << "ERROR: " << slots << " slots leave less than 4 KiB per slot of the window" << std::endl;
+        return EXIT_FAILURE;
+    }
+    StreamWindow stream(bo, (char*)bo_map, window, slots);
+    size = size / 4096 * 4096;
+    int nvmeFd = open(filepath.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if (nvmeFd < 0) {
+        std::cerr << "ERROR: open " << filepath << " failed: " << strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    stream.set_progress(30, [size](size_t bytes, double seconds) {
+        std::cout << "		" << bytes / (1 << 30) << " of " << size / (1 << 30) << " GiB, "
+                  << (double)bytes / (1024 * 1024) / seconds << " MiB/s so far\n";
+    });
+
+    bool verified = true;
+    std::cout << "\nStarting " << num_iter << " iterations W/R of " << size / (1 << 30) << " GiB through a window of "
+              << window / (1 << 20) << " MiB, " << slots << " slots of " << stream.chunk() << " bytes\n";
+    for (int i = 0; i < num_iter; i++) {
+        std::cout << "\n	Iteration " << i << " : " << (global_timer.stop() / 1000000) << "s\n";
+        StreamResult result[2];
+        CpuStats cpu[2];
+        for (int write = 1; write >= 0; write--) {
+            CpuMeter cpu_meter = CpuMeter();
+            perf_counters.start();
+            result[write] = write ? stream.write(nvmeFd, size, i) : stream.read(nvmeFd, size, i);
+            perf_counters.stop(write ? "stream: write" : "stream: read");
+            cpu[write].add(cpu_meter.stop(), result[write].bytes);
+            if (result[write].error != 0) {
+                std::cerr << "ERR: " << (write ? "pwrite" : "pread") << " failed: " << strerror(result[write].error) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+        print_stream("Write", result[1], cpu[1]);
+        print_stream("Read", result[0], cpu[0]);
+        if (result[0].mismatches > 0) {
+            std::cout << "		" << result[0].mismatches << " chunks read back with the wrong stamp\n";
+        }
+        verified &= result[0].mismatches == 0;
+    }
+    (void)close(nvmeFd);
+
+    std::cout << "\nStreamed chunks read back at their offsets: " << (verified ? "OK" : "MISMATCH") << "\n";
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
+    return verified ? 0 : EXIT_FAILURE;
 }
 
 int main(int argc, char** argv) {
@@ -164,8 +2888,44 @@ int main(int argc, char** argv) {
     //**************//"<Full Arg>",  "<Short Arg>", "<Description>", "<Default>"
     parser.addSwitch("--xclbin_file", "-x", "input binary file string", "");
     parser.addSwitch("--device_id", "-d", "device index", "0");
-    parser.addSwitch("--iterations", "-i", "number of iterations", "1000");
+    parser.addSwitch("--iterations", "-i", "number of iterations, 1 unless given for the stream mode", "1000");
     parser.addSwitch("--file_path", "-p", "file path string", "");
+    parser.addSwitch("--mode", "-m", "benchmark mode: rw, layout, uring, compress, decompress, crypt, dedup, scan, columnar, zonemap, bloom, grep, aggregate, sort, sketch, parse, transpose, offload, plan, ring, staging, stream", "rw");
+    parser.addSwitch("--span", "-s", "size of the file span the writes rotate over (K/M/G suffix)", "2000000000");
+    parser.addSwitch("--precondition", "-c", "sequential fill then random overwrite of the span before measuring", "", true);
+    parser.addSwitch("--precondition_bs", "-cb", "block size of the random overwrites", "128K");
+    parser.addSwitch("--precondition_loops", "-cl", "random overwrite passes over the span", "2");
+    parser.addSwitch("--steady_state", "-ss", "only measure once write bandwidth reaches SNIA steady state", "", true);
+    parser.addSwitch("--steady_state_rounds", "-sr", "maximum number of rounds to wait for steady state", "25");
+    parser.addSwitch("--preallocate", "-pa", "preallocate the span of the file and report its extents", "", true);
+    parser.addSwitch("--contiguous_attempts", "-ca", "re-create the file up to N times until it is contiguous", "0");
+    parser.addSwitch("--block_sizes", "-bs", "comma separated block sizes of the io_uring and ring modes", "4K,16K,64K,256K,1M");
+    parser.addSwitch("--queue_depth", "-qd", "io_uring queue depth", "32");
+    parser.addSwitch("--sqpoll", "-sq", "also run io_uring with SQPOLL", "", true);
+    parser.addSwitch("--perf", "-pf", "collect perf counters around each phase of the transfers", "", true);
+    parser.addSwitch("--input_file", "-if", "host file with the data of the offload modes, synthetic logs if empty", "");
+    parser.addSwitch("--data_size", "-ds", "raw bytes processed per iteration by the offload modes", "1G");
+    parser.addSwitch("--compress_bs", "-zb", "compression block size", "256K");
+    parser.addSwitch("--fingerprint_bs", "-fb", "dedup fingerprint block size", "4K");
+    parser.addSwitch("--dup_ratio", "-dr", "write the span with this fraction of duplicate blocks before the dedup scan", "-1");
+    parser.addSwitch("--columns", "-cs", "comma separated columns of the projected scans", "key,price");
+    parser.addSwitch("--zone_bs", "-zs", "bytes of records per zone map block", "1M");
+    parser.addSwitch("--bloom_segment", "-bg", "bytes of records per Bloom filter segment", "1M");
+    parser.addSwitch("--bloom_fpr", "-bp", "comma separated false positive rates of the Bloom filters", "0.1,0.01,0.001");
+    parser.addSwitch("--pattern", "-pt", "pattern of the grep mode", "status=5\\d\\d latency_ms=9\\d\\d");
+    parser.addSwitch("--fixed_strings", "-fs", "take the grep pattern as a literal string", "", true);
+    parser.addSwitch("--group_counts", "-gc", "comma separated group cardinalities of the aggregate mode", "16,1K,64K,1M");
+    parser.addSwitch("--sort_key", "-sk", "column the sort mode orders the records by", "key");
+    parser.addSwitch("--sort_model", "-sm", "sort the runs on the host with the software model of sort_kernel", "", true);
+    parser.addSwitch("--summary_column", "-sc", "column summarized by the sketch mode", "price");
+    parser.addSwitch("--top_k", "-tk", "records kept by the top-K of the sketch mode", "100");
+    parser.addSwitch("--text_format", "-tf", "text of the parse mode: csv or json", "csv");
+    parser.addSwitch("--row_group", "-rg", "bytes of records per row group of the transpose mode", "64M");
+    parser.addSwitch("--simd", "-sd", "highest SIMD level of the CPU kernels: auto, avx512, avx2 or scalar", "auto");
+    parser.addSwitch("--staging_bs", "-sb", "bytes per buffer of the staging mode", "64M");
+    parser.addSwitch("--stream_size", "-st", "bytes of the file streamed by the stream mode", "256G");
+    parser.addSwitch("--window", "-wn", "bytes of the p2p bo the stream mode goes through", "1G");
+    parser.addSwitch("--window_slots", "-wc", "regions of the window, each with one transfer in flight", "4");
     parser.parse(argc, argv);
 
     // Read settings
@@ -173,6 +2933,48 @@ int main(int argc, char** argv) {
     int device_index = stoi(parser.value("device_id"));
     int num_iter = stoi(parser.value("iterations"));
     std::string filepath = parser.value("file_path");
+    std::string mode = parser.value("mode");
+    size_t span = parse_size(parser.value("span"));
+    bool do_precondition = parser.value_to_bool("precondition");
+    size_t precondition_bs = parse_size(parser.value("precondition_bs"));
+    int precondition_loops = stoi(parser.value("precondition_loops"));
+    bool do_steady_state = parser.value_to_bool("steady_state");
+    int steady_state_rounds = stoi(parser.value("steady_state_rounds"));
+    bool do_preallocate = parser.value_to_bool("preallocate");
+    int contiguous_attempts = stoi(parser.value("contiguous_attempts"));
+    std::vector<size_t> block_sizes = parse_size_list(parser.value("block_sizes"));
+    unsigned queue_depth = stoi(parser.value("queue_depth"));
+    bool sqpoll = parser.value_to_bool("sqpoll");
+    bool do_perf = parser.value_to_bool("perf");
+    std::string input_file = parser.value("input_file");
+    size_t data_size = parse_size(parser.value("data_size"));
+    size_t compress_bs = parse_size(parser.value("compress_bs"));
+    size_t fingerprint_bs = parse_size(parser.value("fingerprint_bs"));
+    double dup_ratio = stod(parser.value("dup_ratio"));
+    std::vector<std::string> projection = split_list(parser.value("columns"));
+    size_t zone_bs = parse_size(parser.value("zone_bs"));
+    size_t bloom_segment = parse_size(parser.value("bloom_segment"));
+    std::vector<double> bloom_fprs;
+    for (const std::string& fpr : split_list(parser.value("bloom_fpr"))) bloom_fprs.push_back(stod(fpr));
+    std::string pattern = parser.value("pattern");
+    bool fixed_strings = parser.value_to_bool("fixed_strings");
+    std::vector<size_t> group_counts = parse_size_list(parser.value("group_counts"));
+    std::string sort_column = parser.value("sort_key");
+    bool sort_model = parser.value_to_bool("sort_model");
+    std::string summary_column = parser.value("summary_column");
+    uint32_t top_k = stoi(parser.value("top_k"));
+    std::string text_format = parser.value("text_format");
+    size_t row_group = parse_size(parser.value("row_group"));
+    size_t staging_bs = parse_size(parser.value("staging_bs"));
+    size_t stream_size = parse_size(parser.value("stream_size"));
+    size_t window = parse_size(parser.value("window"));
+    int window_slots = stoi(parser.value("window_slots"));
+    SimdLevel simd_cap;
+    if (!simd_parse(parser.value("simd"), simd_cap)) {
+        std::cerr << "ERROR: unknown SIMD level " << parser.value("simd") << std::endl;
+        return EXIT_FAILURE;
+    }
+    simd_set_level(simd_cap);
 
     if (argc < 5) {
         parser.printHelp();
@@ -197,8 +2999,140 @@ int main(int argc, char** argv) {
 
     std::fill(bo_map, bo_map + DATA_SIZE, 1);
 
-    std::cout << "\nStarting " << num_iter << " iterations W/R\n";
+    if (do_perf && perf_counters.open() == 0) {
+        std::cout << "WARNING: no perf counter available, continuing without\n";
+    }
+
+    if (mode == "layout") {
+        return layout_benchmark(filepath, bo, bo_map, vector_size_bytes, num_iter);
+    }
+    if (mode == "uring") {
+        return uring_benchmark(filepath, bo, bo_map, vector_size_bytes, num_iter, block_sizes, queue_depth, sqpoll);
+    }
+    if (mode == "compress") {
+        return compress_benchmark(filepath, device, uuid, bo, bo_map, data_size, compress_bs, input_file, num_iter);
+    }
+    if (mode == "crypt") {
+        return crypt_benchmark(filepath, device, uuid, bo, bo_map, data_size, input_file, num_iter);
+    }
+    if (mode == "dedup") {
+        return dedup_benchmark(filepath, device, uuid, bo, bo_map, span, fingerprint_bs, dup_ratio, num_iter);
+    }
+    if (mode == "scan") {
+        return scan_benchmark(filepath, device, uuid, bo, bo_map, data_size, num_iter);
+    }
+    if (mode == "columnar") {
+        return columnar_benchmark(filepath, bo, bo_map, data_size, projection, num_iter);
+    }
+    if (mode == "zonemap") {
+        return zonemap_benchmark(filepath, device, uuid, bo, bo_map, data_size, zone_bs, num_iter);
+    }
+    if (mode == "bloom") {
+        return bloom_benchmark(filepath, device, uuid, bo, bo_map, data_size, bloom_segment, bloom_fprs, num_iter);
+    }
+    if (mode == "grep") {
+        return grep_benchmark(filepath, device, uuid, bo, bo_map, data_size, input_file, pattern, fixed_strings, num_iter);
+    }
+    if (mode == "aggregate") {
+        return aggregate_benchmark(filepath, device, uuid, bo, bo_map, data_size, group_counts, num_iter);
+    }
+    if (mode == "sort") {
+        return sort_benchmark(filepath, device, uuid, bo, bo_map, data_size, sort_column, sort_model, num_iter);
+    }
+    if (mode == "sketch") {
+        return sketch_benchmark(filepath, device, uuid, bo, bo_map, data_size, summary_column, top_k, num_iter);
+    }
+    if (mode == "parse") {
+        return parse_benchmark(filepath, device, uuid, bo, bo_map, data_size, text_format == "json", num_iter);
+    }
+    if (mode == "transpose") {
+        return transpose_benchmark(filepath, device, uuid, bo, bo_map, data_size, row_group, num_iter);
+    }
+    if (mode == "offload") {
+        return offload_benchmark(filepath, device, uuid, bo, bo_map, data_size, fingerprint_bs, compress_bs, num_iter);
+    }
+    if (mode == "plan") {
+        return plan_benchmark(filepath, device, uuid, bo, bo_map, data_size, num_iter);
+    }
+    if (mode == "ring") {
+        return ring_benchmark(device, uuid, bo, bo_map, block_sizes, num_iter);
+    }
+    if (mode == "staging") {
+        return staging_benchmark(filepath, bo, bo_map, vector_size_bytes, staging_bs, num_iter);
+    }
+    if (mode == "stream") {
+        return stream_benchmark(filepath, bo, bo_map, stream_size, window, window_slots,
+                                parser.isValid("iterations") ? num_iter : 1);
+    }
+    if (mode == "decompress") {
+        return decompress_benchmark(filepath, device, uuid, bo, bo_map, num_iter);
+    }
+
+    // Writes rotate over the span in buffer sized steps
+    span = std::max(span / vector_size_bytes, (size_t)1) * vector_size_bytes;
+    size_t span_steps = span / vector_size_bytes;
+    if (do_precondition && (precondition_bs == 0 || precondition_bs % 4096 != 0 || precondition_bs > std::min(span, vector_size_bytes))) {
+        std::cerr << "ERROR: the precondition block size must be a non-zero multiple of 4 KiB, at most the span and the buffer"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
     int nvmeFd = -1;
+    if (contiguous_attempts > 0) {
+        size_t fragments = create_contiguous(filepath, span, contiguous_attempts);
+        if (fragments == 0) return EXIT_FAILURE;
+        if (fragments > 1) std::cout << "WARNING: " << filepath << " is still in " << fragments << " fragments\n";
+    } else if (do_preallocate) {
+        nvmeFd = open(filepath.c_str(), O_RDWR | O_CREAT, 0644);
+        int ret = nvmeFd < 0 ? -errno : preallocate(nvmeFd, span);
+        if (ret != 0) {
+            std::cerr << "ERROR: preallocate " << filepath << " failed: " << strerror(-ret) << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::vector<FileExtent> extents = file_extents(nvmeFd, span);
+        std::cout << "Preallocated " << (span >> 20) << " MiB: " << extents.size() << " extents, "
+                  << count_fragments(extents) << " fragments\n";
+        (void)close(nvmeFd);
+    }
+    if (do_precondition || do_steady_state) {
+        nvmeFd = open(filepath.c_str(), O_RDWR | O_DIRECT);
+        if (nvmeFd < 0) {
+            std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
+            return EXIT_FAILURE;
+        }
+        bo.sync(XCL_BO_SYNC_BO_TO_DEVICE);
+        if (do_precondition) {
+            precondition(nvmeFd, bo_map, vector_size_bytes, span, precondition_bs, precondition_loops);
+        }
+        if (do_steady_state) {
+            // One round writes the whole span once
+            SteadyStateDetector detector;
+            std::cout << "\nWaiting for steady state (at most " << steady_state_rounds << " rounds)\n";
+            for (int round = 0; round < steady_state_rounds && !detector.reached(); round++) {
+                double sum = 0;
+                for (size_t step = 0; step < span_steps; step++) {
+                    sum += p2p_host_to_ssd(nvmeFd, krnl, bo, bo_map, step * vector_size_bytes).first;
+                }
+                detector.add(sum / span_steps);
+                std::cout << "Round " << round << " : " << (sum / span_steps) << " MiB/s\n";
+            }
+            if (detector.reached()) {
+                std::cout << "Steady state reached after " << detector.rounds() << " rounds";
+            } else {
+                std::cout << "WARNING: steady state not reached after " << detector.rounds() << " rounds";
+            }
+            std::cout << ", window average " << detector.average() << " MiB/s, range "
+                      << detector.range_pct() << "%, slope " << detector.slope_pct() << "%\n";
+            // Only report the measured iterations
+            throughput_from_fpga_max_host_to_ssd = 0;
+            throughput_from_cpu_max_host_to_ssd = 0;
+            cpu_host_to_ssd.reset();
+            perf_counters.reset();
+        }
+        (void)close(nvmeFd);
+    }
+
+    std::cout << "\nStarting " << num_iter << " iterations W/R\n";
     double sum_write_throughput_from_fpga = 0;
     double sum_read_throughput_from_fpga = 0;
     double sum_write_throughput_from_cpu = 0;
@@ -212,7 +3146,8 @@ int main(int argc, char** argv) {
             std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
             return EXIT_FAILURE;
         }
-        auto p1 = p2p_host_to_ssd(nvmeFd, krnl, bo, bo_map);
+        off_t offset = (i % span_steps) * vector_size_bytes;
+        auto p1 = p2p_host_to_ssd(nvmeFd, krnl, bo, bo_map, offset);
         sum_write_throughput_from_fpga += p1.first;
         sum_write_throughput_from_cpu += p1.second;
         (void)close(nvmeFd);
@@ -223,7 +3158,7 @@ int main(int argc, char** argv) {
             std::cerr << "ERROR: open " << filepath << "failed: " << std::endl;
             return EXIT_FAILURE;
         }
-        auto p2 = p2p_ssd_to_host(nvmeFd, device, krnl);
+        auto p2 = p2p_ssd_to_host(nvmeFd, device, krnl, offset);
         sum_read_throughput_from_fpga += p2.first;
         sum_read_throughput_from_cpu += p2.second;
         (void)close(nvmeFd);
@@ -238,13 +3173,24 @@ int main(int argc, char** argv) {
     		  << "		Max throughput from cpu: " << throughput_from_cpu_max_host_to_ssd << " MiB/s\n"
               << "		Average throughput from cpu: " << average_write_throughput_from_cpu << " MiB/s\n\n"
     		  << "		Max throughput from fpga: " << throughput_from_fpga_max_host_to_ssd << " MiB/s\n"
-              << "		Average throughput from fpga: " << average_write_throughput_from_fpga << " MiB/s\n";
+              << "		Average throughput from fpga: " << average_write_throughput_from_fpga << " MiB/s\n\n"
+              << "		";
+    cpu_host_to_ssd.print(std::cout);
+    std::cout << "\n";
 
     std::cout << "\nRead bandwidth achieved :\n"
     		  << "		Max throughput from cpu: " << throughput_from_cpu_max_ssd_to_host << " MiB/s\n"
               << "		Average throughput from cpu: " << average_read_throughput_from_cpu << " MiB/s\n\n"
     		  << "		Max throughput from fpga: " << throughput_from_fpga_max_ssd_to_host << " MiB/s\n"
-              << "		Average throughput from fpga: " << average_read_throughput_from_fpga << " MiB/s\n";
+              << "		Average throughput from fpga: " << average_read_throughput_from_fpga << " MiB/s\n\n"
+              << "		";
+    cpu_ssd_to_host.print(std::cout);
+    std::cout << "\n";
+
+    if (perf_counters.enabled()) {
+        std::cout << "\nPerf counters per phase :\n";
+        perf_counters.print(std::cout);
+    }
 
     long long seconds = timer.stop() / 1000000;// convert us to s;   
     long long minutes = seconds / 60;
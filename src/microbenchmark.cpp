@@ -0,0 +1,119 @@
+/**
+ * @brief Microbenchmarks of the fixed costs of the XRT path : kernel construction, run
+ *        creation, reused runs, empty kernel round trips and tiny bo.sync.
+ */
+
+/**
+ * Can be compiled with :
+ * g++ -o bin/microbenchmark includes/cmdparser/cmdlineparser.cpp includes/logger/logger.cpp includes/latency/latency.cpp includes/microbench/microbench.cpp includes/sizes/sizes.cpp src/microbenchmark.cpp -I/opt/xilinx/xrt/include -Wall -O0 -g -std=c++1y -I includes/cmdparser -I includes/logger -I includes/latency -I includes/microbench -I includes/sizes -fmessage-length=0  -L/opt/xilinx/xrt/lib -pthread -lOpenCL -lrt -lstdc++  -luuid -lxrt_coreutil
+ *
+ * Can be run with :
+ * bin/microbenchmark -x bin/pipeline_kernel.xclbin -r <# of repetitions> -ss 64,4K
+ *
+ * Without a card, same suite against the emulated backend :
+ * bin/microbenchmark -e -r <# of repetitions>
+ */
+
+#include "cmdlineparser.h"
+#include "latency.h"
+#include "microbench.h"
+#include "sizes.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Words copied by the reused runs, checked at the end
+#define CHECK_WORDS 16
+
+/**
+ * `warmup` untimed calls of `op`, then `repetitions` calls timed one by one. Returns the
+ * samples in microseconds.
+ */
+static LatencySamples measure(const std::function<void()>& op, int warmup, int repetitions) {
+    LatencySamples samples;
+    samples.reserve(repetitions);
+    for (int i = 0; i < warmup; i++) op();
+    for (int i = 0; i < repetitions; i++) {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        op();
+        std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        samples.add(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    return samples;
+}
+
+static void report(const std::string& name, LatencySamples samples) {
+    std::cout << "\t" << name << " : ";
+    samples.print(std::cout);
+    std::cout << "\n";
+}
+
+int run_suite(LaunchBackend& backend, const std::vector<size_t>& sync_sizes, int warmup, int repetitions) {
+    std::cout << "\nFixed costs on the " << backend.name() << " backend, " << repetitions << " repetitions after "
+              << warmup << " warmup calls :\n";
+
+    report("xrt::kernel construction", measure([&] { backend.create_kernel(); }, warmup, repetitions));
+    report("xrt::run creation", measure([&] { backend.create_run(); }, warmup, repetitions));
+    LatencySamples reuse = measure([&] { backend.reuse_run(CHECK_WORDS); }, warmup, repetitions);
+    report("set_arg + start/wait, reused run", reuse);
+    LatencySamples round_trip = measure([&] { backend.round_trip(0); }, warmup, repetitions);
+    report("Empty kernel round trip", round_trip);
+    for (size_t bytes : sync_sizes) {
+        report("bo.sync to device, " + std::to_string(bytes) + " bytes",
+               measure([&] { backend.sync(bytes, true); }, warmup, repetitions));
+        report("bo.sync from device, " + std::to_string(bytes) + " bytes",
+               measure([&] { backend.sync(bytes, false); }, warmup, repetitions));
+    }
+    std::cout << "\tRun reuse saves " << round_trip.percentile(0.5) - reuse.percentile(0.5) << " us per launch (p50)\n";
+
+    bool verified = backend.verify(CHECK_WORDS);
+    std::cout << "\nOutput of the runs matches the input: " << (verified ? "OK" : "MISMATCH") << "\n";
+    return verified ? 0 : EXIT_FAILURE;
+}
+
+int main(int argc, char** argv) {
+    // Command Line Parser
+    sda::utils::CmdLineParser parser;
+
+    // Switches
+    //**************//"<Full Arg>",  "<Short Arg>", "<Description>", "<Default>"
+    parser.addSwitch("--xclbin_file", "-x", "input binary file string, with dummy_kernel", "");
+    parser.addSwitch("--device_id", "-d", "device index", "0");
+    parser.addSwitch("--repetitions", "-r", "timed calls per operation", "10000");
+    parser.addSwitch("--warmup", "-w", "untimed calls per operation before the timed ones", "100");
+    parser.addSwitch("--sync_sizes", "-ss", "comma separated sizes of the bo.sync calls", "64,4K");
+    parser.addSwitch("--emulated", "-e", "run the suite on the emulated backend, without a card", "", true);
+    parser.parse(argc, argv);
+
+    // Read settings
+    std::string binaryFile = parser.value("xclbin_file");
+    int device_index = stoi(parser.value("device_id"));
+    int repetitions = stoi(parser.value("repetitions"));
+    int warmup = stoi(parser.value("warmup"));
+    bool emulated = parser.value_to_bool("emulated");
+    std::vector<size_t> sync_sizes = parse_size_list(parser.value("sync_sizes"));
+    size_t max_size = CHECK_WORDS * sizeof(uint32_t);
+    for (size_t size : sync_sizes) max_size = std::max(max_size, size);
+
+    if (!emulated && binaryFile.empty()) {
+        parser.printHelp();
+        return EXIT_FAILURE;
+    }
+
+    if (emulated) {
+        EmulatedBackend backend(max_size);
+        return run_suite(backend, sync_sizes, warmup, repetitions);
+    }
+
+    std::cout << "Open the device" << device_index << std::endl;
+    auto device = xrt::device(device_index);
+    std::cout << "Load the xclbin " << binaryFile << std::endl;
+    auto uuid = device.load_xclbin(binaryFile);
+    XrtBackend backend(device, uuid, max_size);
+    return run_suite(backend, sync_sizes, warmup, repetitions);
+}
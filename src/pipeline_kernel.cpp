@@ -14,6 +14,259 @@
 * under the License.
 */
 
+/**
+ * Kernels are plain C++ so they also build for software emulation (-t sw_emu).
+ * Can be compiled with :
+ * v++ -c -t <hw|sw_emu> --platform <platform> -k <kernel> -I includes/lz4block -I includes/aes -I includes/scan -I includes/zonemap -I includes/bloom -I includes/grep -I includes/aggregate -I includes/extsort -I includes/sketch -I includes/textparse -I includes/columnar -I includes/transpose -I includes/cmdring -o bin/<kernel>.xo src/pipeline_kernel.cpp
+ */
+
+#include "aes.h"
+#include "aggregate_table.h"
+#include "bloom.h"
+#include "filter.h"
+#include "grep_program.h"
+#include "lz4block.h"
+#include "parse_spec.h"
+#include "ring_layout.h"
+#include "sketch_state.h"
+#include "transpose_layout.h"
+#include "sort_network.h"
+#include "zonemap.h"
+
+static unsigned int read32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+// Length continuation bytes of the LZ4 format
+static unsigned int write_length(unsigned char* op, unsigned int length) {
+    unsigned int n = 0;
+length_bytes:
+    while (length >= 255) {
+        op[n++] = 255;
+        length -= 255;
+    }
+    op[n++] = length;
+    return n;
+}
+
+/**
+ * Compress one block in the LZ4 block format with a greedy single pass over a hash table
+ * of the last position of each 4-byte sequence. Returns the compressed size, or 0 when
+ * the block does not fit in `limit` bytes and must be stored raw.
+ */
+static unsigned int compress_block(const unsigned char* in, unsigned int len, unsigned char* out, unsigned int limit) {
+    unsigned int table[1 << LZ4B_HASH_LOG];
+clear:
+    for (unsigned int i = 0; i < (1 << LZ4B_HASH_LOG); i++) table[i] = 0;
+
+    unsigned int ip = 0, anchor = 0, op = 0;
+    if (len > LZ4B_MF_LIMIT) {
+    search:
+        while (ip < len - LZ4B_MF_LIMIT) {
+            unsigned int seq = read32(in + ip);
+            unsigned int h = (seq * 2654435761u) >> (32 - LZ4B_HASH_LOG);
+            // Positions are stored + 1 so 0 means empty
+            unsigned int ref = table[h];
+            table[h] = ip + 1;
+            if (ref == 0 || ip + 1 - ref > LZ4B_MAX_OFFSET || read32(in + ref - 1) != seq) {
+                ip++;
+                continue;
+            }
+            ref--;
+
+            unsigned int match = LZ4B_MIN_MATCH;
+        extend:
+            while (ip + match < len - LZ4B_LAST_LITERALS && in[ref + match] == in[ip + match]) match++;
+
+            unsigned int literals = ip - anchor;
+            // token + lengths + literals + offset
+            if (op + 1 + literals / 255 + 1 + literals + 2 + match / 255 + 1 > limit) return 0;
+
+            unsigned int token = op++;
+            unsigned int lit_code = literals < 15 ? literals : 15;
+            unsigned int match_code = match - LZ4B_MIN_MATCH < 15 ? match - LZ4B_MIN_MATCH : 15;
+            out[token] = (lit_code << 4) | match_code;
+            if (lit_code == 15) op += write_length(out + op, literals - 15);
+        copy_literals:
+            for (unsigned int i = 0; i < literals; i++) out[op++] = in[anchor + i];
+            out[op++] = (ip - ref) & 0xFF;
+            out[op++] = (ip - ref) >> 8;
+            if (match_code == 15) op += write_length(out + op, match - LZ4B_MIN_MATCH - 15);
+
+            ip += match;
+            anchor = ip;
+        }
+    }
+
+    // Last literals
+    unsigned int literals = len - anchor;
+    if (op + 1 + literals / 255 + 1 + literals > limit) return 0;
+    unsigned int lit_code = literals < 15 ? literals : 15;
+    out[op++] = lit_code << 4;
+    if (lit_code == 15) op += write_length(out + op, literals - 15);
+last_literals:
+    for (unsigned int i = 0; i < literals; i++) out[op++] = in[anchor + i];
+    return op;
+}
+
+static const unsigned char AES_SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16};
+
+static unsigned char aes_xtime(unsigned char x) {
+    return (x << 1) ^ ((x & 0x80) ? 0x1b : 0x00);
+}
+
+// One AES-256 block encryption, fully unrollable : 14 rounds over a 16-byte state
+static void aes256_block(const unsigned char round_keys[AES256_ROUND_KEYS_SIZE], const unsigned char in[AES_BLOCK_SIZE],
+                         unsigned char out[AES_BLOCK_SIZE]) {
+    unsigned char state[AES_BLOCK_SIZE];
+add_key:
+    for (int i = 0; i < AES_BLOCK_SIZE; i++) state[i] = in[i] ^ round_keys[i];
+
+rounds:
+    for (int round = 1; round <= AES256_ROUNDS; round++) {
+        unsigned char shifted[AES_BLOCK_SIZE];
+    sub_shift:
+        for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+            int c = i / 4, r = i % 4;
+            shifted[i] = AES_SBOX[state[4 * ((c + r) % 4) + r]];
+        }
+    mix_columns:
+        for (int c = 0; c < 4; c++) {
+            unsigned char a0 = shifted[4 * c], a1 = shifted[4 * c + 1], a2 = shifted[4 * c + 2], a3 = shifted[4 * c + 3];
+            if (round != AES256_ROUNDS) {
+                unsigned char all = a0 ^ a1 ^ a2 ^ a3;
+                shifted[4 * c] = a0 ^ all ^ aes_xtime(a0 ^ a1);
+                shifted[4 * c + 1] = a1 ^ all ^ aes_xtime(a1 ^ a2);
+                shifted[4 * c + 2] = a2 ^ all ^ aes_xtime(a2 ^ a3);
+                shifted[4 * c + 3] = a3 ^ all ^ aes_xtime(a3 ^ a0);
+            }
+        }
+    round_key:
+        for (int i = 0; i < AES_BLOCK_SIZE; i++) state[i] = shifted[i] ^ round_keys[AES_BLOCK_SIZE * round + i];
+    }
+
+copy_out:
+    for (int i = 0; i < AES_BLOCK_SIZE; i++) out[i] = state[i];
+}
+
+static const unsigned int SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+// Size of a SHA-256 digest in the fingerprint array
+#define SHA256_BYTES 32
+
+static unsigned int rotr32(unsigned int x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+// One 64-byte SHA-256 compression round on the state h
+static void sha256_chunk(unsigned int h[8], const unsigned char chunk[64]) {
+    unsigned int w[64];
+schedule_load:
+    for (int i = 0; i < 16; i++) {
+        w[i] = (unsigned int)chunk[4 * i] << 24 | (unsigned int)chunk[4 * i + 1] << 16 | (unsigned int)chunk[4 * i + 2] << 8 | chunk[4 * i + 3];
+    }
+schedule_extend:
+    for (int i = 16; i < 64; i++) {
+        unsigned int s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        unsigned int s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    unsigned int v[8];
+init:
+    for (int i = 0; i < 8; i++) v[i] = h[i];
+rounds:
+    for (int i = 0; i < 64; i++) {
+        unsigned int t1 = v[7] + (rotr32(v[4], 6) ^ rotr32(v[4], 11) ^ rotr32(v[4], 25)) + ((v[4] & v[5]) ^ (~v[4] & v[6])) + SHA256_K[i] + w[i];
+        unsigned int t2 = (rotr32(v[0], 2) ^ rotr32(v[0], 13) ^ rotr32(v[0], 22)) + ((v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]));
+        v[7] = v[6];
+        v[6] = v[5];
+        v[5] = v[4];
+        v[4] = v[3] + t1;
+        v[3] = v[2];
+        v[2] = v[1];
+        v[1] = v[0];
+        v[0] = t1 + t2;
+    }
+accumulate:
+    for (int i = 0; i < 8; i++) h[i] += v[i];
+}
+
+// Little-endian load of `bytes` bytes
+static unsigned long long load_le(const unsigned char* p, unsigned int bytes) {
+    unsigned long long v = 0;
+load:
+    for (unsigned int i = 0; i < bytes; i++) v |= (unsigned long long)p[i] << (8 * i);
+    return v;
+}
+
+template <typename T>
+static bool compare(T a, T b, unsigned int op) {
+    switch (op) {
+    case FILTER_EQ: return a == b;
+    case FILTER_NE: return a != b;
+    case FILTER_LT: return a < b;
+    case FILTER_LE: return a <= b;
+    case FILTER_GT: return a > b;
+    default: return a >= b;
+    }
+}
+
+// a < b in the order of the column type
+static bool less_than(long long a, long long b, unsigned int type) {
+    union { long long i; double d; } x, y;
+    x.i = a;
+    y.i = b;
+    return type == FILTER_FLOAT64 ? x.d < y.d : a < b;
+}
+
+// Conjunction of the predicates over one record
+static bool match_record(const unsigned char* record, const FilterPredicate* predicates, unsigned int num_predicates) {
+    bool match = true;
+terms:
+    for (unsigned int p = 0; p < num_predicates; p++) {
+        const FilterPredicate& pred = predicates[p];
+        const unsigned char* field = record + pred.offset;
+        bool term;
+        if (pred.type == FILTER_INT32) {
+            term = compare<long long>((int)load_le(field, 4), pred.value, pred.op);
+        } else if (pred.type == FILTER_INT64) {
+            term = compare<long long>((long long)load_le(field, 8), pred.value, pred.op);
+        } else {
+            union { unsigned long long u; double d; } a, b;
+            a.u = load_le(field, 8);
+            b.u = pred.value;
+            term = compare<double>(a.d, b.d, pred.op);
+        }
+        match = match && term;
+    }
+    return match;
+}
+
 extern "C" {
 void dummy_kernel(unsigned int* buffer0, unsigned int* buffer1, unsigned int size) {
 // Intentional empty kernel as this example doesn't require actual
@@ -25,4 +278,557 @@ dummy:
         buffer1[i] = buffer0[i];
     }
 }
+
+/**
+ * Compress `size` bytes of `in` block by block into the lz4block format (see lz4block.h).
+ * Blocks are packed in `out` each starting LZ4B_ALIGN aligned, so the used part of `out`
+ * can be written to the SSD in a single P2P pwrite. `index` receives one
+ * (offset, size, raw_size) triple per block.
+ */
+void lz4_compress_kernel(const unsigned char* in, unsigned char* out, unsigned int* index, unsigned int size, unsigned int block_size) {
+    unsigned int offset = 0;
+    unsigned int count = (size + block_size - 1) / block_size;
+
+blocks:
+    for (unsigned int b = 0; b < count; b++) {
+        unsigned int start = b * block_size;
+        unsigned int len = size - start < block_size ? size - start : block_size;
+
+        // Only keep the compressed block when it is actually smaller
+        unsigned int csize = compress_block(in + start, len, out + offset, len - 1);
+        if (csize == 0) {
+        store:
+            for (unsigned int i = 0; i < len; i++) out[offset + i] = in[start + i];
+            csize = len | LZ4B_RAW_FLAG;
+        }
+
+        index[3 * b + 0] = offset;
+        index[3 * b + 1] = csize;
+        index[3 * b + 2] = len;
+        offset += ((csize & ~LZ4B_RAW_FLAG) + LZ4B_ALIGN - 1) / LZ4B_ALIGN * LZ4B_ALIGN;
+    }
+}
+
+/**
+ * Expand `count` blocks of the lz4block data region `in` (as read from the SSD) into `out`,
+ * block i landing at i * block_size. `index` is the (offset, size, raw_size) triple per block
+ * from the file. Malformed sequences stop the decoding of their block instead of writing
+ * outside of it.
+ */
+void lz4_decompress_kernel(const unsigned char* in, unsigned char* out, const unsigned int* index, unsigned int count, unsigned int block_size) {
+blocks:
+    for (unsigned int b = 0; b < count; b++) {
+        const unsigned char* src = in + index[3 * b + 0];
+        unsigned int size = index[3 * b + 1];
+        unsigned int raw_size = index[3 * b + 2];
+        unsigned char* dst = out + b * block_size;
+        if (raw_size > block_size) continue;
+
+        if (size & LZ4B_RAW_FLAG) {
+        copy_raw:
+            for (unsigned int i = 0; i < raw_size; i++) dst[i] = src[i];
+            continue;
+        }
+
+        unsigned int ip = 0, op = 0;
+    sequences:
+        while (ip < size) {
+            unsigned int token = src[ip++];
+
+            unsigned int literals = token >> 4;
+            if (literals == 15) {
+                unsigned int byte = 255;
+            literal_length:
+                while (byte == 255 && ip < size) {
+                    byte = src[ip++];
+                    literals += byte;
+                }
+            }
+            if (ip + literals > size || op + literals > raw_size) break;
+        copy_literals:
+            for (unsigned int i = 0; i < literals; i++) dst[op++] = src[ip++];
+
+            // The last sequence only has literals
+            if (ip + 2 > size) break;
+            unsigned int offset = src[ip] | (src[ip + 1] << 8);
+            ip += 2;
+            if (offset == 0 || offset > op) break;
+
+            unsigned int match = token & 15;
+            if (match == 15) {
+                unsigned int byte = 255;
+            match_length:
+                while (byte == 255 && ip < size) {
+                    byte = src[ip++];
+                    match += byte;
+                }
+            }
+            match += LZ4B_MIN_MATCH;
+            if (op + match > raw_size) break;
+
+            // Byte by byte, the match may overlap the output
+        copy_match:
+            for (unsigned int i = 0; i < match; i++, op++) dst[op] = dst[op - offset];
+        }
+    }
+}
+
+/**
+ * AES-256 in CTR mode over `size` bytes, the same operation encrypts and decrypts.
+ * `keys` holds the expanded round keys followed by the IV (AES256_KERNEL_KEYS_SIZE bytes),
+ * the key schedule is done once by the host. `first_block` is the index of the first
+ * 16-byte block in the file so any aligned range can be processed on its own.
+ */
+void aes256_ctr_kernel(const unsigned char* in, unsigned char* out, const unsigned char* keys, unsigned long long first_block, unsigned int size) {
+    unsigned char round_keys[AES256_ROUND_KEYS_SIZE];
+    unsigned char counter[AES_BLOCK_SIZE];
+load_keys:
+    for (int i = 0; i < AES256_ROUND_KEYS_SIZE; i++) round_keys[i] = keys[i];
+load_iv:
+    for (int i = 0; i < AES_BLOCK_SIZE; i++) counter[i] = keys[AES256_ROUND_KEYS_SIZE + i];
+
+    // counter = iv + first_block, 128-bit big-endian
+    unsigned long long carry = first_block;
+add_offset:
+    for (int i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
+        unsigned long long sum = counter[i] + (carry & 0xFF);
+        counter[i] = sum & 0xFF;
+        carry = (carry >> 8) + (sum >> 8);
+    }
+
+blocks:
+    for (unsigned int pos = 0; pos < size; pos += AES_BLOCK_SIZE) {
+        unsigned char stream[AES_BLOCK_SIZE];
+        aes256_block(round_keys, counter, stream);
+    xor_stream:
+        for (unsigned int i = 0; i < AES_BLOCK_SIZE; i++) {
+            if (pos + i < size) out[pos + i] = in[pos + i] ^ stream[i];
+        }
+        unsigned int increment = 1;
+    increment:
+        for (int i = AES_BLOCK_SIZE - 1; i >= 0; i--) {
+            unsigned int sum = counter[i] + increment;
+            counter[i] = sum & 0xFF;
+            increment = sum >> 8;
+        }
+    }
+}
+
+/**
+ * SHA-256 fingerprint of every `block_size` block of `in` (the last one may be shorter),
+ * written as SHA256_BYTES big-endian bytes per block in `digests`. Only this array has
+ * to cross PCIe to find duplicate blocks.
+ */
+void sha256_blocks_kernel(const unsigned char* in, unsigned char* digests, unsigned int size, unsigned int block_size) {
+    unsigned int count = (size + block_size - 1) / block_size;
+
+blocks:
+    for (unsigned int b = 0; b < count; b++) {
+        const unsigned char* data = in + b * block_size;
+        unsigned int len = size - b * block_size < block_size ? size - b * block_size : block_size;
+        unsigned int h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+        unsigned int pos = 0;
+    chunks:
+        for (; pos + 64 <= len; pos += 64) sha256_chunk(h, data + pos);
+
+        // Padding : 0x80, zeros, then the length in bits big-endian, in one or two chunks
+        unsigned char tail[128];
+        unsigned int rest = len - pos;
+        unsigned int tail_len = rest + 1 + 8 <= 64 ? 64 : 128;
+        unsigned long long bits = (unsigned long long)len * 8;
+    padding:
+        for (unsigned int i = 0; i < 128; i++) {
+            unsigned char byte = 0;
+            if (i < rest) byte = data[pos + i];
+            else if (i == rest) byte = 0x80;
+            else if (i >= tail_len - 8 && i < tail_len) byte = bits >> (8 * (tail_len - 1 - i));
+            tail[i] = byte;
+        }
+        sha256_chunk(h, tail);
+        if (tail_len == 128) sha256_chunk(h, tail + 64);
+
+        unsigned char* digest = digests + b * SHA256_BYTES;
+    store:
+        for (int i = 0; i < 8; i++) {
+            digest[4 * i] = h[i] >> 24;
+            digest[4 * i + 1] = h[i] >> 16;
+            digest[4 * i + 2] = h[i] >> 8;
+            digest[4 * i + 3] = h[i];
+        }
+    }
+}
+
+/**
+ * Filter `num_records` fixed-width records of `record_size` bytes with the conjunction of
+ * `num_predicates` comparisons (see filter.h). Always writes the selection bitmap, bit i of
+ * word i / 32 for record i, and the number of matches in count[0]. With `emit_rows` the
+ * matching records are also compacted back to back in `rows`.
+ */
+void filter_kernel(const unsigned char* in, unsigned char* rows, unsigned int* bitmap, unsigned int* count,
+                   const FilterPredicate* predicates, unsigned int num_predicates, unsigned int record_size,
+                   unsigned int num_records, unsigned int emit_rows) {
+    FilterPredicate local[FILTER_MAX_PREDICATES];
+    if (num_predicates > FILTER_MAX_PREDICATES) num_predicates = FILTER_MAX_PREDICATES;
+load_predicates:
+    for (unsigned int p = 0; p < num_predicates; p++) local[p] = predicates[p];
+
+    unsigned int matches = 0;
+    unsigned int word = 0;
+records:
+    for (unsigned int r = 0; r < num_records; r++) {
+        const unsigned char* record = in + (unsigned long long)r * record_size;
+        bool match = match_record(record, local, num_predicates);
+        if (match) {
+            word |= 1u << (r % 32);
+            if (emit_rows) {
+            copy_row:
+                for (unsigned int i = 0; i < record_size; i++) rows[(unsigned long long)matches * record_size + i] = record[i];
+            }
+            matches++;
+        }
+        if (r % 32 == 31 || r == num_records - 1) {
+            bitmap[r / 32] = word;
+            word = 0;
+        }
+    }
+    count[0] = matches;
+}
+
+/**
+ * Min/max of the column at `column_offset` over each block of `block_records` records,
+ * run on the data in the p2p bo before it is P2P written. zones gets one ZoneEntry per block.
+ */
+void zonemap_kernel(const unsigned char* in, ZoneEntry* zones, unsigned int record_size, unsigned int column_offset,
+                    unsigned int type, unsigned int num_records, unsigned int block_records) {
+    unsigned int width = type == FILTER_INT32 ? 4 : 8;
+    long long min = 0, max = 0;
+records:
+    for (unsigned int r = 0; r < num_records; r++) {
+        unsigned long long bits = load_le(in + (unsigned long long)r * record_size + column_offset, width);
+        long long v = type == FILTER_INT32 ? (long long)(int)bits : (long long)bits;
+        if (r % block_records == 0 || less_than(v, min, type)) min = v;
+        if (r % block_records == 0 || less_than(max, v, type)) max = v;
+        if (r % block_records == block_records - 1 || r == num_records - 1) {
+            zones[r / block_records].min = min;
+            zones[r / block_records].max = max;
+        }
+    }
+}
+
+/**
+ * Bloom filters of the key at `key_offset` for each segment of `segment_records` records,
+ * run on the data in the p2p bo before it is P2P written. filters gets filter_bits bits
+ * per segment.
+ */
+void bloom_build_kernel(const unsigned char* in, unsigned int* filters, unsigned int record_size, unsigned int key_offset,
+                        unsigned int key_width, unsigned int num_records, unsigned int segment_records,
+                        unsigned int filter_bits, unsigned int num_hashes) {
+    unsigned int words = filter_bits / 32;
+    unsigned long long total_words = (unsigned long long)((num_records + segment_records - 1) / segment_records) * words;
+clear:
+    for (unsigned long long w = 0; w < total_words; w++) filters[w] = 0;
+
+records:
+    for (unsigned int r = 0; r < num_records; r++) {
+        unsigned long long h = bloom_hash(load_le(in + (unsigned long long)r * record_size + key_offset, key_width));
+        unsigned int h1 = h, h2 = (h >> 32) | 1;
+        unsigned int* filter = filters + (unsigned long long)(r / segment_records) * words;
+    set_bits:
+        for (unsigned int i = 0; i < num_hashes && i < BLOOM_MAX_HASHES; i++) {
+            unsigned int bit = bloom_bit(h1, h2, i, filter_bits);
+            filter[bit / 32] |= 1u << (bit % 32);
+        }
+    }
+}
+
+/**
+ * Line search over `size` bytes of the p2p bo. offsets gets the offsets of the first
+ * max_offsets matching lines starting at or before `limit` and count[0] their number.
+ * With skip_partial the bytes up to the first newline end a line of the previous chunk.
+ */
+void grep_kernel(const unsigned char* in, unsigned int* offsets, unsigned int* count, const GrepProgram* program,
+                 unsigned int size, unsigned int limit, unsigned int skip_partial, unsigned int max_offsets) {
+    GrepProgram local = *program;
+    bool anchor_end = local.flags & GREP_ANCHOR_END;
+    bool started = !skip_partial;
+    unsigned int line_start = 0;
+    bool reported = false;
+    unsigned long long state = 0;
+    unsigned int matches = 0;
+    unsigned int i = 0;
+bytes:
+    for (; i < size; i++) {
+        unsigned char c = in[i];
+        if (!started) {
+            started = c == '\n';
+            line_start = i + 1;
+            continue;
+        }
+        if (line_start > limit) break;
+        if (c == '\n') {
+            if (anchor_end && (state & local.accept) && !reported) {
+                if (matches < max_offsets) offsets[matches] = line_start;
+                matches++;
+            }
+            state = 0;
+            line_start = i + 1;
+            reported = false;
+            continue;
+        }
+        state = grep_step(&local, state, c, i == line_start);
+        if (!anchor_end && (state & local.accept) && !reported) {
+            if (matches < max_offsets) offsets[matches] = line_start;
+            matches++;
+            reported = true;
+        }
+    }
+    if (started && i == size && line_start < size && line_start <= limit && anchor_end && (state & local.accept) && !reported) {
+        if (matches < max_offsets) offsets[matches] = line_start;
+        matches++;
+    }
+    count[0] = matches;
+}
+
+/**
+ * Group-by of the records in the p2p bo into the hash table in device memory : count,
+ * sum, min and max of the value column per key. Once the table holds max_groups groups,
+ * records of new keys are counted in the overflow status. See aggregate_table.h for the flags.
+ */
+void aggregate_kernel(const unsigned char* in, AggEntry* table, unsigned int* status, unsigned int record_size,
+                      unsigned int key_offset, unsigned int key_type, unsigned int value_offset, unsigned int value_type,
+                      unsigned int num_records, unsigned int table_slots, unsigned int max_groups, unsigned int flags) {
+    if (flags & AGG_RESET) {
+    clear:
+        for (unsigned int s = 0; s < table_slots; s++) table[s].count = 0;
+        status[AGG_STATUS_GROUPS] = 0;
+        status[AGG_STATUS_OVERFLOW] = 0;
+    }
+    unsigned int groups = status[AGG_STATUS_GROUPS];
+    unsigned int overflow = status[AGG_STATUS_OVERFLOW];
+
+records:
+    for (unsigned int r = 0; r < num_records; r++) {
+        const unsigned char* record = in + (unsigned long long)r * record_size;
+        unsigned long long k = load_le(record + key_offset, key_type == FILTER_INT32 ? 4 : 8);
+        unsigned long long v = load_le(record + value_offset, value_type == FILTER_INT32 ? 4 : 8);
+        long long key = key_type == FILTER_INT32 ? (long long)(int)k : (long long)k;
+        long long value = value_type == FILTER_INT32 ? (long long)(int)v : (long long)v;
+
+        unsigned int slot = agg_slot(key, table_slots);
+        bool done = false;
+    probe:
+        for (unsigned int p = 0; p < table_slots; p++) {
+            AggEntry& entry = table[slot];
+            if (entry.count == 0) {
+                // New groups past max_groups are overflow, the table stays at most half full
+                if (groups < max_groups) {
+                    entry.key = key;
+                    entry.count = 1;
+                    entry.sum = entry.min = entry.max = value;
+                    groups++;
+                    done = true;
+                }
+                break;
+            }
+            if (entry.key == key) {
+                entry.count++;
+                entry.sum += value;
+                if (value < entry.min) entry.min = value;
+                if (value > entry.max) entry.max = value;
+                done = true;
+                break;
+            }
+            slot = (slot + 1) & (table_slots - 1);
+        }
+        if (!done) overflow++;
+    }
+    status[AGG_STATUS_GROUPS] = groups;
+    status[AGG_STATUS_OVERFLOW] = overflow;
+
+    if (flags & AGG_FINISH) {
+        unsigned int front = 0;
+    compact:
+        for (unsigned int s = 0; s < table_slots; s++) {
+            if (table[s].count != 0) table[front++] = table[s];
+        }
+    }
+}
+
+/**
+ * Sort the records of `in` by one column into `out` : a bitonic network sorts blocks of
+ * SORT_NETWORK (key, index) pairs, merge passes ping-pong them through `scratch` (two
+ * pairs per record), then the records are gathered in order. sort_model() in
+ * includes/extsort is the software model of this kernel.
+ */
+void sort_kernel(const unsigned char* in, unsigned char* out, SortPair* scratch, unsigned int record_size,
+                 unsigned int key_offset, unsigned int key_type, unsigned int num_records) {
+    SortPair* a = scratch;
+    SortPair* b = scratch + num_records;
+
+blocks:
+    for (unsigned int base = 0; base < num_records; base += SORT_NETWORK) {
+        SortPair local[SORT_NETWORK];
+    load:
+        for (unsigned int i = 0; i < SORT_NETWORK; i++) {
+            if (base + i < num_records) {
+                local[i].key = sort_key(in + (unsigned long long)(base + i) * record_size + key_offset, key_type);
+                local[i].index = base + i;
+            } else {
+                // Sentinels sort after every record
+                local[i].key = ~0ull;
+                local[i].index = ~0u;
+            }
+            local[i].reserved = 0;
+        }
+    stages:
+        for (unsigned int k = 2; k <= SORT_NETWORK; k <<= 1) {
+        steps:
+            for (unsigned int j = k >> 1; j > 0; j >>= 1) {
+            compare_exchange:
+                for (unsigned int i = 0; i < SORT_NETWORK; i++) {
+                    unsigned int l = i ^ j;
+                    if (l > i) {
+                        bool ascending = (i & k) == 0;
+                        if (ascending == (bool)sort_pair_less(&local[l], &local[i])) {
+                            SortPair t = local[i];
+                            local[i] = local[l];
+                            local[l] = t;
+                        }
+                    }
+                }
+            }
+        }
+    store:
+        for (unsigned int i = 0; i < SORT_NETWORK && base + i < num_records; i++) a[base + i] = local[i];
+    }
+
+passes:
+    for (unsigned int width = SORT_NETWORK; width < num_records; width *= 2) {
+    merges:
+        for (unsigned int lo = 0; lo < num_records; lo += 2 * width) {
+            unsigned int mid = lo + width < num_records ? lo + width : num_records;
+            unsigned int hi = lo + 2 * width < num_records ? lo + 2 * width : num_records;
+            unsigned int i = lo, j = mid;
+        merge:
+            for (unsigned int k = lo; k < hi; k++) {
+                if (j >= hi || (i < mid && !sort_pair_less(&a[j], &a[i]))) b[k] = a[i++];
+                else b[k] = a[j++];
+            }
+        }
+        SortPair* t = a;
+        a = b;
+        b = t;
+    }
+
+gather:
+    for (unsigned int r = 0; r < num_records; r++) {
+        const unsigned char* src = in + (unsigned long long)a[r].index * record_size;
+        unsigned char* dst = out + (unsigned long long)r * record_size;
+    copy:
+        for (unsigned int c = 0; c < record_size; c++) dst[c] = src[c];
+    }
+}
+
+/**
+ * Top `k` records of the chunk by one column, added to the heap in device memory. Rows are
+ * numbered from first_row, the heap holds min(first_row, k) entries from the earlier chunks.
+ */
+void topk_kernel(const unsigned char* in, TopKEntry* heap, unsigned int record_size, unsigned int key_offset,
+                 unsigned int key_type, unsigned int num_records, unsigned long long first_row, unsigned int k) {
+records:
+    for (unsigned int r = 0; r < num_records; r++) {
+        TopKEntry entry;
+        entry.key = sort_key(in + (unsigned long long)r * record_size + key_offset, key_type);
+        entry.row = first_row + r;
+        topk_push(heap, first_row + r, k, entry);
+    }
+}
+
+/**
+ * Quantile sketch of one column of the chunk, added to the sketch in device memory which
+ * is reset first when `reset` is set.
+ */
+void quantile_kernel(const unsigned char* in, KllSketch* sketch, unsigned int record_size, unsigned int key_offset,
+                     unsigned int key_type, unsigned int num_records, unsigned int reset) {
+    if (reset) kll_init(sketch, KLL_SEED);
+records:
+    for (unsigned int r = 0; r < num_records; r++) {
+        kll_insert(sketch, sort_key(in + (unsigned long long)r * record_size + key_offset, key_type));
+    }
+}
+
+/**
+ * Parse the CSV or JSON lines of in[start, size) into binary columns in `out`, laid out as
+ * a group of the columnar format for the rows parsed, which the host P2P writes as is. A
+ * line without its newline is only parsed in the `final` chunk, at most max_rows rows are
+ * parsed. See parse_spec.h for the status words.
+ */
+void parse_kernel(const char* in, unsigned char* out, unsigned int* status, const ParseSpec* spec_in,
+                  unsigned int start, unsigned int size, unsigned int max_rows, unsigned int final) {
+    ParseSpec spec = *spec_in;
+    ParseState state;
+    parse_begin(&spec, &state);
+    unsigned int field = start, consumed = start;
+    bool full = false;
+
+text:
+    for (unsigned int pos = start; pos < size && !full; pos++) {
+        char c = in[pos];
+        if (parse_is_separator(&spec, c)) {
+            if (parse_separator(&spec, &state, in, field, pos, c, out, max_rows)) {
+                consumed = pos + 1;
+                full = state.rows == max_rows;
+            }
+            field = pos + 1;
+        }
+    }
+    if (final && !full && consumed < size) {
+        parse_separator(&spec, &state, in, field, size, '\n', out, max_rows);
+        consumed = size;
+    }
+    parse_pack(&spec, out, max_rows, state.rows);
+
+    status[PARSE_STATUS_ROWS] = state.rows;
+    status[PARSE_STATUS_CONSUMED] = consumed;
+    status[PARSE_STATUS_BAD] = state.bad_lines;
+}
+
+/**
+ * Transpose `rows` row-major records of `in` from first_row into one chunk per column in
+ * `out`, laid out as a row group of the columnar format (see transpose_layout.h).
+ */
+void transpose_kernel(const unsigned char* in, unsigned char* out, const TransposeColumn* columns_in,
+                      unsigned int num_columns, unsigned int record_size, unsigned long long first_row,
+                      unsigned int rows) {
+    TransposeColumn columns[TRANSPOSE_MAX_COLUMNS];
+load:
+    for (unsigned int c = 0; c < num_columns && c < TRANSPOSE_MAX_COLUMNS; c++) columns[c] = columns_in[c];
+
+    const unsigned char* records = in + first_row * record_size;
+    unsigned long long start = 0;
+columns:
+    for (unsigned int c = 0; c < num_columns && c < TRANSPOSE_MAX_COLUMNS; c++) {
+        unsigned int width = columns[c].width;
+        unsigned long long end = transpose_column_offset(columns, rows, c + 1);
+    rows:
+        for (unsigned int r = 0; r < rows; r++) {
+            const unsigned char* field = records + (unsigned long long)r * record_size + columns[c].offset;
+            unsigned char* dst = out + start + (unsigned long long)r * width;
+        bytes:
+            for (unsigned int b = 0; b < width; b++) dst[b] = field[b];
+        }
+    padding:
+        for (unsigned long long i = start + (unsigned long long)rows * width; i < end; i++) out[i] = 0;
+        start = end;
+    }
+}
+
+/**
+ * Persistent kernel : started once, it serves the copies published in the command ring
+ * (see ring_layout.h) until a RING_STOP command, so a chunk costs a ring slot and no launch.
+ */
+void ring_kernel(volatile CommandRingLayout* ring, const unsigned char* in, unsigned char* out) {
+    ring_serve(ring, in, out);
+}
 }